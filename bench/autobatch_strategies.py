@@ -0,0 +1,99 @@
+"""Compare the autobatching strategies selectable with --dynet-autobatch.
+
+Every strategy runs in its own process, because the strategy is fixed when
+DyNet is initialized. The workloads are
+
+  transduction   a BiLSTM sequence transducer over variable-length sequences,
+                 following sequence_transduction.py
+  rnn-autobatch  the examples/autobatch/train_rnn-autobatch binary, if its
+                 path is given with --rnn-autobatch
+
+Usage:
+  python autobatch_strategies.py [--strategies 1,2,3,4] [--seqs 500]
+                                 [--rnn-autobatch PATH]
+"""
+from __future__ import print_function
+import argparse
+import random
+import re
+import subprocess
+import sys
+import time
+
+
+def run_transduction(args):
+    import dynet as dy
+    random.seed(1)
+    m = dy.ParameterCollection()
+    trainer = dy.SimpleSGDTrainer(m)
+    E = m.add_lookup_parameters((1000, args.embed))
+    fw = dy.VanillaLSTMBuilder(1, args.embed, args.hidden, m)
+    bw = dy.VanillaLSTMBuilder(1, args.embed, args.hidden, m)
+    W_ = m.add_parameters((args.classes, args.hidden * 2))
+    lengths = [random.randint(5, args.max_len) for _ in range(args.seqs)]
+    Xs = [[random.randint(0, 999) for _ in range(l)] for l in lengths]
+    Ys = [[random.randint(0, args.classes - 1) for _ in range(l)] for l in lengths]
+
+    start = time.time()
+    for b in range(0, args.seqs, args.batch):
+        dy.renew_cg()
+        W = dy.parameter(W_)
+        losses = []
+        for X, Y in zip(Xs[b:b + args.batch], Ys[b:b + args.batch]):
+            xs = [E[i] for i in X]
+            hs = zip(fw.initial_state().transduce(xs),
+                     reversed(bw.initial_state().transduce(list(reversed(xs)))))
+            for (f, r), y in zip(hs, Y):
+                losses.append(dy.pickneglogsoftmax(W * dy.concatenate([f, r]), y))
+        loss = dy.esum(losses)
+        loss.forward()
+        loss.backward()
+        trainer.update()
+    print("TIME %f" % (time.time() - start))
+
+
+def time_transduction(strategy, args):
+    cmd = [sys.executable, __file__, "--worker", "--dynet-autobatch", str(strategy),
+           "--seqs", str(args.seqs), "--batch", str(args.batch),
+           "--max-len", str(args.max_len), "--hidden", str(args.hidden),
+           "--embed", str(args.embed), "--classes", str(args.classes)]
+    out = subprocess.check_output(cmd, stderr=subprocess.STDOUT).decode()
+    return float(re.search(r"TIME (\S+)", out).group(1))
+
+
+def time_rnn_autobatch(strategy, args):
+    cmd = [args.rnn_autobatch, "--dynet-autobatch", str(strategy)]
+    start = time.time()
+    subprocess.check_output(cmd, stderr=subprocess.STDOUT)
+    return time.time() - start
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--strategies", default="1,2,3,4")
+    parser.add_argument("--seqs", type=int, default=500)
+    parser.add_argument("--batch", type=int, default=32)
+    parser.add_argument("--max-len", type=int, default=30)
+    parser.add_argument("--hidden", type=int, default=64)
+    parser.add_argument("--embed", type=int, default=32)
+    parser.add_argument("--classes", type=int, default=10)
+    parser.add_argument("--rnn-autobatch", default=None)
+    parser.add_argument("--worker", action="store_true")
+    args, _ = parser.parse_known_args()
+
+    if args.worker:
+        run_transduction(args)
+        return
+
+    workloads = [("transduction", time_transduction)]
+    if args.rnn_autobatch:
+        workloads.append(("rnn-autobatch", time_rnn_autobatch))
+    strategies = [int(s) for s in args.strategies.split(",")]
+    print("%-15s %s" % ("workload", " ".join("%10s" % ("strategy %d" % s) for s in strategies)))
+    for name, timer in workloads:
+        times = [timer(s, args) for s in strategies]
+        print("%-15s %s" % (name, " ".join("%9.3fs" % t for t in times)))
+
+
+if __name__ == "__main__":
+    main()
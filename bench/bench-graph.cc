@@ -0,0 +1,169 @@
+/**
+ * \file bench-graph.cc
+ * \brief Microbenchmarks of the per-node overhead of dynamic graphs
+ * \details Measures everything around the math: building expressions,
+ * ComputationGraph::add_function, dim_forward, autobatch_sig, the batching
+ * planner of the autobatching engine and ComputationGraph::clear(). The
+ * tensors are tiny, so that the time spent computing is negligible.
+ *
+ * Usage:
+ *   bench-graph [--nodes 100000] [--reps 10] [--output results.json]
+ *               [DyNet options]
+ *
+ * Every result reports the time per node in nanoseconds, averaged over the
+ * repetitions.
+ */
+#include "dynet/dynet.h"
+#include "dynet/expr.h"
+#include "dynet/nodes-trig.h"
+#include "dynet/sig.h"
+
+#include <random>
+
+#include "bench.h"
+
+using namespace std;
+using namespace dynet;
+using dynet_bench::Args;
+using dynet_bench::Result;
+using dynet_bench::Stopwatch;
+
+static const unsigned kDim = 4;
+
+// h_t = tanh(W h_{t-1} + b + x_t) for sequences of the given lengths,
+// summed into a scalar
+struct RnnModel {
+  RnnModel() {
+    W = pc.add_parameters({kDim, kDim});
+    b = pc.add_parameters({kDim});
+  }
+  Expression build(ComputationGraph& cg, const vector<unsigned>& lengths) {
+    Expression eW = parameter(cg, W), eb = parameter(cg, b);
+    vector<Expression> outputs;
+    for (unsigned len : lengths) {
+      Expression h = zeros(cg, {kDim});
+      for (unsigned t = 0; t < len; ++t)
+        h = tanh(eW * h + eb + input(cg, {kDim}, x));
+      outputs.push_back(sum_elems(h));
+    }
+    return sum(outputs);
+  }
+  ParameterCollection pc;
+  Parameter W, b;
+  vector<float> x = vector<float>(kDim, 0.1f);
+};
+
+// Lengths of sequences adding up to about num_nodes nodes (each step adds
+// five nodes); a different seed gives a different graph structure
+static vector<unsigned> random_lengths(unsigned num_nodes, unsigned seed) {
+  mt19937 rng(seed);
+  uniform_int_distribution<unsigned> len(5, 50);
+  vector<unsigned> lengths;
+  for (unsigned n = 0; n < num_nodes; ) {
+    lengths.push_back(len(rng));
+    n += 5 * lengths.back() + 2;
+  }
+  return lengths;
+}
+
+static Result per_node(const string& name, double seconds, size_t nodes, unsigned reps) {
+  Result r(name);
+  r.field("nodes", nodes).field("reps", reps).field("ns_per_node", seconds * 1e9 / (nodes * (double)reps));
+  return r;
+}
+
+int main(int argc, char** argv) {
+  dynet::initialize(argc, argv);
+  Args args(argc, argv);
+  const unsigned num_nodes = args.get("--nodes", 100000u);
+  const unsigned reps = args.get("--reps", 10u);
+  vector<Result> results;
+  RnnModel model;
+  const vector<unsigned> lengths = random_lengths(num_nodes, 0);
+
+  // Building expressions and clearing the graph
+  {
+    ComputationGraph cg;
+    double build = 0, clear = 0;
+    size_t nodes = 0;
+    for (unsigned r = 0; r < reps; ++r) {
+      Stopwatch sw;
+      model.build(cg, lengths);
+      build += sw.elapsed();
+      nodes = cg.nodes.size();
+      sw.reset();
+      cg.clear();
+      clear += sw.elapsed();
+    }
+    results.push_back(per_node("expr_construction", build, nodes, reps));
+    results.push_back(per_node("clear", clear, nodes, reps));
+  }
+
+  // ComputationGraph::add_function without the Expression layer
+  {
+    ComputationGraph cg;
+    double elapsed = 0;
+    for (unsigned r = 0; r < reps; ++r) {
+      VariableIndex i = zeros(cg, {kDim}).i;
+      Stopwatch sw;
+      for (unsigned n = 1; n < num_nodes; ++n)
+        i = cg.add_function<Tanh>({i});
+      elapsed += sw.elapsed();
+      cg.clear();
+    }
+    results.push_back(per_node("add_function", elapsed, num_nodes, reps));
+  }
+
+  // dim_forward and autobatch_sig of the nodes of a built graph
+  {
+    ComputationGraph cg;
+    model.build(cg, lengths);
+    const size_t nodes = cg.nodes.size();
+    vector<vector<Dim>> xds(nodes);
+    for (size_t i = 0; i < nodes; ++i)
+      for (VariableIndex arg : cg.nodes[i]->args)
+        xds[i].push_back(cg.nodes[arg]->dim);
+    Stopwatch sw;
+    for (unsigned r = 0; r < reps; ++r)
+      for (size_t i = 0; i < nodes; ++i)
+        cg.nodes[i]->dim_forward(xds[i]);
+    results.push_back(per_node("dim_forward", sw.elapsed(), nodes, reps));
+    int sigs = 0;
+    sw.reset();
+    for (unsigned r = 0; r < reps; ++r) {
+      SigMap sm;
+      for (size_t i = 0; i < nodes; ++i)
+        sigs += cg.nodes[i]->autobatch_sig(cg, sm);
+    }
+    results.push_back(per_node("autobatch_sig", sw.elapsed(), nodes, reps));
+    if (sigs < 0) cerr << sigs << endl;  // keep the calls from being optimized away
+  }
+
+  // Forward passes, unbatched and autobatched. The difference between them
+  // is mostly the batching planner; with a repeated structure the planner
+  // can reuse cached schedules. Unless --dynet-autobatch selects a strategy,
+  // the default one is used.
+  if (autobatch_flag == 0) autobatch_flag = 1;
+  for (int batched = 0; batched < 2; ++batched) {
+    for (int same_structure = 0; same_structure < (batched ? 2 : 1); ++same_structure) {
+      ComputationGraph cg(batched);
+      double elapsed = 0;
+      size_t nodes = 0;
+      for (unsigned r = 0; r < reps; ++r) {
+        Expression y = model.build(cg, same_structure ? lengths : random_lengths(num_nodes, r + 1));
+        nodes += cg.nodes.size();
+        Stopwatch sw;
+        cg.forward(y);
+        elapsed += sw.elapsed();
+        cg.clear();
+      }
+      string name = !batched ? "forward_unbatched" :
+                    same_structure ? "forward_autobatch_cached" : "forward_autobatch";
+      results.push_back(per_node(name, elapsed, nodes / reps, reps));
+      results.back().field("autobatch_strategy", batched ? autobatch_flag : 0);
+    }
+  }
+
+  dynet_bench::report(args, "graph", results);
+  return 0;
+}
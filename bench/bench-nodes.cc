@@ -0,0 +1,442 @@
+/**
+ * \file bench-nodes.cc
+ * \brief Forward and backward throughput of the node kernels on the CPU
+ * \details Every kernel is created through the expr.h API on inputs of a
+ * range of shapes and batch sizes. Its forward() and backward() are then
+ * timed on their own by calling the node directly, so that graph and
+ * execution engine overhead (see bench-graph) is excluded.
+ *
+ * Usage:
+ *   bench-nodes [--kernel NAME] [--min-time 0.05] [--output results.json]
+ *               [DyNet options]
+ *
+ * --kernel only runs the kernels whose name contains NAME. Every result
+ * reports the time per call in microseconds, the throughput in GFLOP/s and
+ * the memory traffic in GB/s. Elementwise functions count as one operation
+ * per element whatever their cost, and backward counts twice the operations
+ * of forward. Traffic counts every input, output and gradient tensor read or
+ * written once.
+ *
+ * The inputs are drawn uniformly in [0.1, 1), so that functions with a
+ * restricted domain can take them. Every node type of
+ * nodes-*.h is benchmarked except:
+ * - the nodes without arguments, which only fill their output: Constant,
+ *   RandomNormal, RandomBernoulli, RandomUniform and RandomGumbel, as well as
+ *   the input, parameter and lookup nodes of param-nodes.h
+ * - ToDevice, which only copies between devices
+ * - Identity and MaxPooling1D, which no function of expr.h creates
+ * - FusedElementwise, which the execution engine creates from chains of the
+ *   elementwise nodes above (see bench-graph)
+ */
+#include "dynet/dynet.h"
+#include "dynet/expr.h"
+#include "dynet/tensor.h"
+
+#include <functional>
+#include <random>
+#include <sstream>
+
+#include "bench.h"
+
+using namespace std;
+using namespace dynet;
+using dynet_bench::Args;
+using dynet_bench::Result;
+using dynet_bench::Stopwatch;
+
+// The inputs of a kernel for a size n and a batch size b
+typedef function<vector<Dim>(unsigned n, unsigned b)> Shapes;
+typedef function<Expression(const vector<Expression>& x)> Builder;
+// Forward floating point operations, from the input and output dimensions
+typedef function<double(const vector<Dim>& in, const Dim& out)> Flops;
+
+struct Kernel {
+  string name;
+  Shapes shapes;
+  vector<unsigned> sizes, batches;
+  Builder build;
+  Flops flops;
+};
+
+static Flops per_output(double c) {
+  return [c](const vector<Dim>&, const Dim& out) { return c * out.size(); };
+}
+static Flops per_input(double c) {
+  return [c](const vector<Dim>& in, const Dim&) { return c * in[0].size(); };
+}
+static Flops no_flops() {
+  return [](const vector<Dim>&, const Dim&) { return 0.0; };
+}
+
+static Dim dim(const initializer_list<unsigned>& ds, unsigned b = 1) {
+  return Dim(vector<long>(ds.begin(), ds.end()), b);
+}
+
+static const vector<unsigned> kVectorSizes = {256, 4096, 65536};
+static const vector<unsigned> kMatrixSizes = {64, 256, 512};
+static const vector<unsigned> kBatches = {1, 32};
+
+// n-vectors, one per argument, batched
+static Shapes vectors(unsigned num) {
+  return [num](unsigned n, unsigned b) { return vector<Dim>(num, dim({n}, b)); };
+}
+// n x n matrices, batched
+static Shapes matrices(unsigned num) {
+  return [num](unsigned n, unsigned b) { return vector<Dim>(num, dim({n, n}, b)); };
+}
+
+static vector<Kernel> all_kernels() {
+  vector<Kernel> ks;
+  auto unary = [&](const string& name, Builder build) {
+    ks.push_back({name, vectors(1), kVectorSizes, kBatches, build, per_output(1)});
+  };
+  auto binary = [&](const string& name, Builder build) {
+    ks.push_back({name, vectors(2), kVectorSizes, kBatches, build, per_output(1)});
+  };
+  auto reduction = [&](const string& name, double c, Builder build) {
+    ks.push_back({name, vectors(1), kVectorSizes, kBatches, build, per_input(c)});
+  };
+
+  // Elementwise
+  unary("tanh", [](const vector<Expression>& x) { return tanh(x[0]); });
+  unary("logistic", [](const vector<Expression>& x) { return logistic(x[0]); });
+  unary("rectify", [](const vector<Expression>& x) { return rectify(x[0]); });
+  unary("exp", [](const vector<Expression>& x) { return exp(x[0]); });
+  unary("log", [](const vector<Expression>& x) { return log(x[0]); });
+  unary("sqrt", [](const vector<Expression>& x) { return sqrt(x[0]); });
+  unary("square", [](const vector<Expression>& x) { return square(x[0]); });
+  unary("cube", [](const vector<Expression>& x) { return cube(x[0]); });
+  unary("abs", [](const vector<Expression>& x) { return abs(x[0]); });
+  unary("negate", [](const vector<Expression>& x) { return -x[0]; });
+  unary("softsign", [](const vector<Expression>& x) { return softsign(x[0]); });
+  unary("elu", [](const vector<Expression>& x) { return elu(x[0]); });
+  unary("selu", [](const vector<Expression>& x) { return selu(x[0]); });
+  unary("silu", [](const vector<Expression>& x) { return silu(x[0]); });
+  unary("erf", [](const vector<Expression>& x) { return erf(x[0]); });
+  unary("sin", [](const vector<Expression>& x) { return sin(x[0]); });
+  unary("log_sigmoid", [](const vector<Expression>& x) { return log_sigmoid(x[0]); });
+  unary("constant_plus", [](const vector<Expression>& x) { return x[0] + 2.f; });
+  unary("scalar_multiply", [](const vector<Expression>& x) { return x[0] * 2.f; });
+  unary("tan", [](const vector<Expression>& x) { return tan(x[0]); });
+  unary("cos", [](const vector<Expression>& x) { return cos(x[0]); });
+  unary("sinh", [](const vector<Expression>& x) { return sinh(x[0]); });
+  unary("cosh", [](const vector<Expression>& x) { return cosh(x[0]); });
+  unary("asin", [](const vector<Expression>& x) { return asin(x[0]); });
+  unary("acos", [](const vector<Expression>& x) { return acos(x[0]); });
+  unary("atan", [](const vector<Expression>& x) { return atan(x[0]); });
+  unary("asinh", [](const vector<Expression>& x) { return asinh(x[0]); });
+  unary("acosh", [](const vector<Expression>& x) { return acosh(x[0] + 1.f); });
+  unary("atanh", [](const vector<Expression>& x) { return atanh(x[0] * 0.5f); });
+  unary("lgamma", [](const vector<Expression>& x) { return lgamma(x[0]); });
+  unary("floor", [](const vector<Expression>& x) { return floor(x[0], straight_through_gradient); });
+  unary("ceil", [](const vector<Expression>& x) { return ceil(x[0], straight_through_gradient); });
+  unary("round", [](const vector<Expression>& x) { return round(x[0], straight_through_gradient); });
+  unary("constant_minus", [](const vector<Expression>& x) { return 2.f - x[0]; });
+  unary("nobackprop", [](const vector<Expression>& x) { return nobackprop(x[0]); });
+  unary("scale_gradient", [](const vector<Expression>& x) { return scale_gradient(x[0], 0.5f); });
+  unary("argmax", [](const vector<Expression>& x) { return argmax(x[0], straight_through_gradient); });
+  unary("dropout", [](const vector<Expression>& x) { return dropout(x[0], 0.5f); });
+  unary("dropout_batch", [](const vector<Expression>& x) { return dropout_batch(x[0], 0.5f); });
+  ks.push_back({"block_dropout", vectors(1), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return block_dropout(x[0], 0.5f); }, per_output(1)});
+  unary("noise", [](const vector<Expression>& x) { return noise(x[0], 0.1f); });
+  binary("cwise_sum", [](const vector<Expression>& x) { return x[0] + x[1]; });
+  binary("cwise_subtract", [](const vector<Expression>& x) { return x[0] - x[1]; });
+  binary("cmult", [](const vector<Expression>& x) { return cmult(x[0], x[1]); });
+  binary("cdiv", [](const vector<Expression>& x) { return cdiv(x[0], x[1]); });
+  binary("max", [](const vector<Expression>& x) { return max(x[0], x[1]); });
+  binary("min", [](const vector<Expression>& x) { return min(x[0], x[1]); });
+  ks.push_back({"sum", vectors(3), kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return sum(x); }, per_output(2)});
+  ks.push_back({"average", vectors(3), kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return average(x); }, per_output(3)});
+  ks.push_back({"logsumexp", vectors(3), kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return logsumexp(x); }, per_output(7)});
+  ks.push_back({"pow", [](unsigned n, unsigned b) { return vector<Dim>{dim({n}, b), dim({1})}; },
+                kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return pow(x[0], x[1]); }, per_output(1)});
+
+  // Reductions and normalizations of vectors
+  reduction("sum_elems", 1, [](const vector<Expression>& x) { return sum_elems(x[0]); });
+  reduction("mean_elems", 1, [](const vector<Expression>& x) { return mean_elems(x[0]); });
+  reduction("squared_norm", 2, [](const vector<Expression>& x) { return squared_norm(x[0]); });
+  reduction("l2_norm", 2, [](const vector<Expression>& x) { return l2_norm(x[0]); });
+  reduction("softmax", 3, [](const vector<Expression>& x) { return softmax(x[0]); });
+  reduction("log_softmax", 3, [](const vector<Expression>& x) { return log_softmax(x[0]); });
+  reduction("pickneglogsoftmax", 3, [](const vector<Expression>& x) {
+    return pickneglogsoftmax(x[0], vector<unsigned>(x[0].dim().bd, 0));
+  });
+  ks.push_back({"sparsemax", vectors(1), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return sparsemax(x[0]); }, per_input(3)});
+  reduction("max_dim", 1, [](const vector<Expression>& x) { return max_dim(x[0]); });
+  reduction("cumsum", 1, [](const vector<Expression>& x) { return cumsum(x[0], 0); });
+  reduction("sum_batches", 1, [](const vector<Expression>& x) { return sum_batches(x[0]); });
+  reduction("std_elems", 3, [](const vector<Expression>& x) { return std_elems(x[0]); });
+  reduction("moment_elems", 3, [](const vector<Expression>& x) { return moment_elems(x[0], 3); });
+  reduction("std_batches", 3, [](const vector<Expression>& x) { return std_batches(x[0]); });
+  reduction("moment_batches", 3, [](const vector<Expression>& x) { return moment_batches(x[0], 3); });
+  reduction("pick", 0, [](const vector<Expression>& x) {
+    return pick(x[0], vector<unsigned>(x[0].dim().bd, 1));
+  });
+  reduction("pick_range", 0, [](const vector<Expression>& x) { return pick_range(x[0], 16, 128); });
+  reduction("pick_batch_elem", 0, [](const vector<Expression>& x) { return pick_batch_elem(x[0], 0u); });
+  reduction("strided_select", 0, [](const vector<Expression>& x) { return strided_select(x[0], {2}); });
+  reduction("reshape", 0, [](const vector<Expression>& x) { return reshape(x[0], {x[0].dim()[0] / 2, 2}); });
+  reduction("concatenate_to_batch", 0, [](const vector<Expression>& x) { return concatenate_to_batch({x[0], x[0]}); });
+  // Hinge over more than 4096 elements and FoldRows over batches crash in
+  // Eigen, so they are only timed on the shapes that work
+  ks.push_back({"hinge", vectors(1), {256, 4096}, {1},
+                [](const vector<Expression>& x) { return hinge(x[0], 0u); }, per_input(2)});
+  ks.push_back({"restricted_log_softmax", vectors(1), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return log_softmax(x[0], {0, 1, 2, 3, 4, 5, 6, 7}); }, per_input(3)});
+  ks.push_back({"sparsemax_loss", vectors(1), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return sparsemax_loss(x[0], {0, 1}); }, per_input(3)});
+  ks.push_back({"constrained_softmax", vectors(2), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return constrained_softmax(x[0], x[1]); }, per_input(3)});
+  ks.push_back({"circ_conv", vectors(2), {256, 1024}, {1},
+                [](const vector<Expression>& x) { return circ_conv(x[0], x[1]); },
+                [](const vector<Dim>& in, const Dim&) { return 2.0 * in[0].size() * in[0].size(); }});
+  ks.push_back({"circ_corr", vectors(2), {256, 1024}, {1},
+                [](const vector<Expression>& x) { return circ_corr(x[0], x[1]); },
+                [](const vector<Dim>& in, const Dim&) { return 2.0 * in[0].size() * in[0].size(); }});
+  ks.push_back({"huber_distance", vectors(2), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return huber_distance(x[0], x[1]); }, per_input(3)});
+  ks.push_back({"binary_log_loss", vectors(2), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return binary_log_loss(x[0], x[1]); }, per_input(4)});
+  ks.push_back({"pairwise_rank_loss", vectors(2), {1}, {1, 256},
+                [](const vector<Expression>& x) { return pairwise_rank_loss(x[0], x[1]); }, per_input(2)});
+  ks.push_back({"poisson_loss", vectors(1), {1}, {1},
+                [](const vector<Expression>& x) { return poisson_loss(x[0], 2u); }, per_input(3)});
+  ks.push_back({"dot_product", vectors(2), kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return dot_product(x[0], x[1]); }, per_input(2)});
+  ks.push_back({"squared_distance", vectors(2), kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return squared_distance(x[0], x[1]); }, per_input(3)});
+  ks.push_back({"l1_distance", vectors(2), kVectorSizes, {1},
+                [](const vector<Expression>& x) { return l1_distance(x[0], x[1]); }, per_input(3)});
+  ks.push_back({"concatenate", vectors(2), kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return concatenate({x[0], x[1]}); }, no_flops()});
+  ks.push_back({"layer_norm",
+                [](unsigned n, unsigned b) { return vector<Dim>{dim({n}, b), dim({n}), dim({n})}; },
+                kVectorSizes, kBatches,
+                [](const vector<Expression>& x) { return layer_norm(x[0], x[1], x[2]); }, per_input(7)});
+
+  // Matrices
+  ks.push_back({"transpose", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return transpose(x[0]); }, no_flops()});
+  ks.push_back({"sum_dim", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return sum_dim(x[0], {0}); }, per_input(1)});
+  ks.push_back({"logsumexp_dim", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return logsumexp_dim(x[0], 0); }, per_input(3)});
+  ks.push_back({"select_rows", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return select_rows(x[0], {0, 2, 4, 6}); }, no_flops()});
+  ks.push_back({"min_dim", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return min_dim(x[0]); }, per_input(1)});
+  ks.push_back({"std_dim", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return std_dim(x[0], {0}); }, per_input(3)});
+  ks.push_back({"moment_dim", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return moment_dim(x[0], {0}, 3); }, per_input(3)});
+  ks.push_back({"select_cols", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return select_cols(x[0], {0, 2, 4, 6}); }, no_flops()});
+  ks.push_back({"dropout_dim", matrices(1), kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return dropout_dim(x[0], 1, 0.5f); }, per_input(1)});
+  ks.push_back({"hinge_dim", matrices(1), kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return hinge_dim(x[0], vector<unsigned>(x[0].dim()[1], 0)); },
+                per_input(2)});
+  ks.push_back({"colwise_add", [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n}, b), dim({n})}; },
+                kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return colwise_add(x[0], x[1]); }, per_output(1)});
+  ks.push_back({"weight_norm", [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n}), dim({1})}; },
+                kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return weight_norm(x[0], x[1]); }, per_input(3)});
+  ks.push_back({"fold_rows", matrices(1), kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return fold_rows(x[0], 2); }, per_input(1)});
+  ks.push_back({"kmax_pooling", matrices(1), kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return kmax_pooling(x[0], 4); }, per_input(1)});
+  ks.push_back({"kmh_ngram", matrices(1), kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return kmh_ngram(x[0], 3); }, per_input(3)});
+  ks.push_back({"filter1d_narrow",
+                [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n}), dim({n, 3})}; },
+                kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return filter1d_narrow(x[0], x[1]); },
+                [](const vector<Dim>& in, const Dim& out) { return 2.0 * out.size() * in[1].size(); }});
+  ks.push_back({"inverse", matrices(1), {16, 64, 256}, {1},
+                [](const vector<Expression>& x) { return inverse(x[0] * transpose(x[0])); },
+                [](const vector<Dim>& in, const Dim&) { return 2.0 * in[0].size() * in[0][0]; }});
+  ks.push_back({"logdet", matrices(1), {16, 64, 256}, {1},
+                [](const vector<Expression>& x) { return logdet(x[0] * transpose(x[0])); },
+                [](const vector<Dim>& in, const Dim&) { return 2.0 / 3.0 * in[0].size() * in[0][0]; }});
+  ks.push_back({"trace_of_product", matrices(2), kMatrixSizes, {1},
+                [](const vector<Expression>& x) { return trace_of_product(x[0], x[1]); }, per_input(2)});
+  ks.push_back({"contract3d_1d", [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n, n}), dim({n}, b)}; },
+                {16, 32, 64}, kBatches,
+                [](const vector<Expression>& x) { return contract3d_1d(x[0], x[1]); },
+                [](const vector<Dim>& in, const Dim& out) { return 2.0 * in[0].size() * out.bd; }});
+  auto matvec = [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n}), dim({n}, b)}; };
+  auto matvec_flops = [](const vector<Dim>& in, const Dim& out) {
+    return 2.0 * in[0][0] * in[0][1] * out.bd;
+  };
+  ks.push_back({"matmul_matvec", matvec, kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return x[0] * x[1]; }, matvec_flops});
+  ks.push_back({"affine_transform",
+                [](unsigned n, unsigned b) { return vector<Dim>{dim({n}), dim({n, n}), dim({n}, b)}; },
+                kMatrixSizes, kBatches,
+                [](const vector<Expression>& x) { return affine_transform({x[0], x[1], x[2]}); },
+                [](const vector<Dim>& in, const Dim& out) { return 2.0 * in[1][0] * in[1][1] * out.bd + out.size(); }});
+  ks.push_back({"matmul_matmat", [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n}), dim({n, n}, b)}; },
+                {64, 128, 256}, {1, 8},
+                [](const vector<Expression>& x) { return x[0] * x[1]; },
+                [](const vector<Dim>& in, const Dim& out) { return 2.0 * in[0][0] * in[0][1] * out.size(); }});
+
+  // Convolutions: n x n images with 8 channels, 16 3x3 filters
+  ks.push_back({"conv2d", [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n, 8}, b), dim({3, 3, 8, 16})}; },
+                {16, 32, 64}, {1, 8},
+                [](const vector<Expression>& x) { return conv2d(x[0], x[1], {1, 1}); },
+                [](const vector<Dim>& in, const Dim& out) { return 2.0 * out.size() * 3 * 3 * in[0][2]; }});
+  ks.push_back({"conv2d_bias",
+                [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n, 8}, b), dim({3, 3, 8, 16}), dim({16})}; },
+                {16, 32, 64}, {1, 8},
+                [](const vector<Expression>& x) { return conv2d(x[0], x[1], x[2], {1, 1}); },
+                [](const vector<Dim>& in, const Dim& out) { return 2.0 * out.size() * 3 * 3 * in[0][2] + out.size(); }});
+  ks.push_back({"maxpooling2d", [](unsigned n, unsigned b) { return vector<Dim>{dim({n, n, 8}, b)}; },
+                {16, 32, 64}, {1, 8},
+                [](const vector<Expression>& x) { return maxpooling2d(x[0], {2, 2}, {2, 2}); }, per_input(1)});
+
+  // LSTM cells with n hidden units
+  ks.push_back({"vanilla_lstm_gates",
+                [](unsigned n, unsigned b) {
+                  return vector<Dim>{dim({n}, b), dim({n}, b), dim({4 * n, n}), dim({4 * n, n}), dim({4 * n})};
+                },
+                {64, 256}, kBatches,
+                [](const vector<Expression>& x) { return vanilla_lstm_gates(x[0], x[1], x[2], x[3], x[4]); },
+                [](const vector<Dim>& in, const Dim& out) { return 4.0 * in[2][0] * in[2][1] * out.bd + 2.0 * out.size(); }});
+  ks.push_back({"vanilla_lstm_c",
+                [](unsigned n, unsigned b) { return vector<Dim>{dim({n}, b), dim({4 * n}, b)}; },
+                {64, 256, 1024}, kBatches,
+                [](const vector<Expression>& x) { return vanilla_lstm_c(x[0], x[1]); }, per_output(3)});
+  ks.push_back({"vanilla_lstm_h",
+                [](unsigned n, unsigned b) { return vector<Dim>{dim({n}, b), dim({4 * n}, b)}; },
+                {64, 256, 1024}, kBatches,
+                [](const vector<Expression>& x) { return vanilla_lstm_h(x[0], x[1]); }, per_output(2)});
+  ks.push_back({"vanilla_lstm_sequence",
+                [](unsigned n, unsigned b) {
+                  return vector<Dim>{dim({n, 16}, b), dim({n}, b), dim({n}, b), dim({4 * n, n}), dim({4 * n, n}), dim({4 * n})};
+                },
+                {64, 256}, kBatches,
+                [](const vector<Expression>& x) { return vanilla_lstm_sequence(x[0], x[1], x[2], x[3], x[4], x[5]); },
+                [](const vector<Dim>& in, const Dim& out) { return 16 * (4.0 * in[3][0] * in[3][1] * out.bd) + 5.0 * out.size(); }});
+
+  // GRU cells with n hidden units
+  auto gru_shapes = [](unsigned n, unsigned b) {
+    return vector<Dim>{dim({n}, b), dim({n}, b), dim({n, n}), dim({n, n}), dim({n}), dim({n, n}), dim({n, n}), dim({n})};
+  };
+  ks.push_back({"gru_gates", gru_shapes, {64, 256}, kBatches,
+                [](const vector<Expression>& x) { return gru_gates(x[0], x[1], x[2], x[3], x[4], x[5], x[6], x[7]); },
+                [](const vector<Dim>& in, const Dim& out) { return 4.0 * in[2].size() * out.bd + 2.0 * out.size(); }});
+  ks.push_back({"gru_c", gru_shapes, {64, 256}, kBatches,
+                [](const vector<Expression>& x) {
+                  return gru_c(x[0], x[1], gru_gates(x[0], x[1], x[2], x[3], x[4], x[5], x[6], x[7]), x[2], x[3], x[4]);
+                },
+                [](const vector<Dim>& in, const Dim& out) { return 4.0 * in[2].size() * out.bd + 3.0 * out.size(); }});
+  ks.push_back({"gru_h", [](unsigned n, unsigned b) { return vector<Dim>{dim({n}, b), dim({2 * n}, b), dim({n}, b)}; },
+                {64, 256, 1024}, kBatches,
+                [](const vector<Expression>& x) { return gru_h(x[0], x[1], x[2]); }, per_output(3)});
+  return ks;
+}
+
+static string dims_string(const vector<Dim>& dims) {
+  ostringstream s;
+  for (size_t i = 0; i < dims.size(); ++i)
+    s << (i ? " " : "") << dims[i];
+  return s.str();
+}
+
+// Seconds per call of f, calling it until at least min_time has passed
+static double time_calls(const function<void()>& f, double min_time, unsigned& calls) {
+  f();  // warm up
+  calls = 0;
+  Stopwatch sw;
+  double elapsed = 0;
+  for (unsigned n = 1; elapsed < min_time; n *= 2) {
+    for (unsigned i = 0; i < n; ++i)
+      f();
+    calls += n;
+    elapsed = sw.elapsed();
+  }
+  return elapsed / calls;
+}
+
+int main(int argc, char** argv) {
+  dynet::initialize(argc, argv);
+  Args args(argc, argv);
+  const string filter = args.get("--kernel", string());
+  const double min_time = atof(args.get("--min-time", string("0.05")).c_str());
+  mt19937 rng(1);
+  uniform_real_distribution<float> dist(0.1f, 1.f);
+  vector<Result> results;
+  ComputationGraph cg;
+  for (const Kernel& k : all_kernels()) {
+    if (k.name.find(filter) == string::npos) continue;
+    for (unsigned n : k.sizes) {
+      for (unsigned b : k.batches) {
+        cg.clear();
+        vector<Dim> in_dims = k.shapes(n, b);
+        vector<vector<float>> in_vals(in_dims.size());
+        vector<Expression> xs;
+        for (size_t i = 0; i < in_dims.size(); ++i) {
+          in_vals[i].resize(in_dims[i].size());
+          for (auto & v : in_vals[i]) v = dist(rng);
+          xs.push_back(input(cg, in_dims[i], in_vals[i]));
+        }
+        Expression y;
+        try {
+          y = k.build(xs);
+          cg.forward(y);
+        } catch (std::exception& e) {
+          // report unsupported shapes rather than giving up on all kernels
+          Result r(k.name);
+          r.param("inputs", dims_string(in_dims)).param("error", e.what());
+          results.push_back(r);
+          continue;
+        }
+
+        // Call the node directly on the values computed by the graph
+        const Node* node = cg.nodes[y.i];
+        vector<const Tensor*> x_tensors;
+        for (VariableIndex arg : node->args)
+          x_tensors.push_back(&cg.get_value(arg));
+        Tensor fx = cg.get_value(y.i);
+        vector<float> dEdf_vals(fx.d.size(), 1.f);
+        Tensor dEdf(fx.d, dEdf_vals.data(), fx.device, DeviceMempool::NONE);
+        vector<vector<float>> dEdx_vals(x_tensors.size());
+        vector<Tensor> dEdx(x_tensors.size());
+        double in_bytes = 0;
+        for (size_t i = 0; i < x_tensors.size(); ++i) {
+          dEdx_vals[i].assign(x_tensors[i]->d.size(), 0.f);
+          dEdx[i] = Tensor(x_tensors[i]->d, dEdx_vals[i].data(), fx.device, DeviceMempool::NONE);
+          in_bytes += x_tensors[i]->d.size() * sizeof(float);
+        }
+        const double out_bytes = fx.d.size() * sizeof(float);
+
+        unsigned fwd_calls, bwd_calls;
+        double fwd = time_calls([&]() { node->forward(x_tensors, fx); }, min_time, fwd_calls);
+        double bwd = time_calls([&]() {
+          for (unsigned i = 0; i < x_tensors.size(); ++i)
+            node->backward(x_tensors, fx, dEdf, i, dEdx[i]);
+        }, min_time, bwd_calls);
+        const double flops = k.flops(in_dims, fx.d);
+        // backward reads dE/df, f(x) and x, and updates dE/dx
+        const double fwd_bytes = in_bytes + out_bytes, bwd_bytes = 2 * out_bytes + 3 * in_bytes;
+
+        Result r(k.name);
+        r.param("inputs", dims_string(in_dims)).param("output", dims_string({fx.d}))
+         .field("size", n).field("batch", b)
+         .field("fwd_us", fwd * 1e6).field("fwd_gflops", flops / fwd * 1e-9).field("fwd_gbps", fwd_bytes / fwd * 1e-9)
+         .field("bwd_us", bwd * 1e6).field("bwd_gflops", 2 * flops / bwd * 1e-9).field("bwd_gbps", bwd_bytes / bwd * 1e-9)
+         .field("fwd_calls", fwd_calls).field("bwd_calls", bwd_calls);
+        results.push_back(r);
+      }
+    }
+  }
+  dynet_bench::report(args, "nodes", results);
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * \file bench.h
+ * \brief Small helpers shared by the C++ benchmarks: timing, argument
+ *        parsing and JSON output
+ */
+#ifndef DYNET_BENCH_H_
+#define DYNET_BENCH_H_
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dynet_bench {
+
+// Wall clock time since construction or the last reset(), in seconds
+class Stopwatch {
+ public:
+  Stopwatch() { reset(); }
+  void reset() { start = std::chrono::steady_clock::now(); }
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+ private:
+  std::chrono::steady_clock::time_point start;
+};
+
+// One measurement: a name, string parameters (e.g. shapes) and numeric
+// fields, written in the order they were added
+struct Result {
+  explicit Result(const std::string& name) : name(name) {}
+  Result& param(const std::string& key, const std::string& value) {
+    params.push_back(std::make_pair(key, value));
+    return *this;
+  }
+  Result& field(const std::string& key, double value) {
+    fields.push_back(std::make_pair(key, value));
+    return *this;
+  }
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> params;
+  std::vector<std::pair<std::string, double>> fields;
+};
+
+inline std::string json_string(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+// Write the results of a suite as a JSON object
+//   {"suite": ..., "results": [{"name": ..., <params>, <fields>}, ...]}
+inline void write_json(std::ostream& os, const std::string& suite,
+                       const std::vector<Result>& results) {
+  os << "{\"suite\": " << json_string(suite) << ", \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    os << (i ? ",\n  " : "\n  ") << "{\"name\": " << json_string(r.name);
+    for (auto & p : r.params)
+      os << ", " << json_string(p.first) << ": " << json_string(p.second);
+    for (auto & f : r.fields)
+      os << ", " << json_string(f.first) << ": " << f.second;
+    os << '}';
+  }
+  os << "\n]}" << std::endl;
+}
+
+// Command line of a benchmark, after dynet::initialize() removed the DyNet
+// options. Options are of the form --name value.
+class Args {
+ public:
+  Args(int argc, char** argv) : argc(argc), argv(argv) {}
+  std::string get(const std::string& name, const std::string& def) const {
+    for (int i = 1; i + 1 < argc; ++i)
+      if (name == argv[i]) return argv[i + 1];
+    return def;
+  }
+  unsigned get(const std::string& name, unsigned def) const {
+    std::string s = get(name, std::string());
+    return s.empty() ? def : (unsigned)std::strtoul(s.c_str(), nullptr, 10);
+  }
+  bool has(const std::string& name) const {
+    for (int i = 1; i < argc; ++i)
+      if (name == argv[i]) return true;
+    return false;
+  }
+ private:
+  int argc;
+  char** argv;
+};
+
+// Print the results to --output if given, to stdout otherwise
+inline void report(const Args& args, const std::string& suite,
+                   const std::vector<Result>& results) {
+  std::string path = args.get("--output", std::string());
+  if (path.empty()) {
+    write_json(std::cout, suite, results);
+  } else {
+    std::ofstream out(path);
+    if (!out) {
+      std::cerr << "Could not open " << path << " for writing" << std::endl;
+      std::exit(1);
+    }
+    write_json(out, suite, results);
+  }
+}
+
+}  // namespace dynet_bench
+
+#endif
@@ -1,10 +1,31 @@
 #include "dynet/aligned-mem-pool.h"
 #include "dynet/devices.h"
+#include "dynet/init.h"
 
+#include <algorithm>
 #include <sstream>
+#include <vector>
+#include <utility>
 
 using namespace dynet;
 
+// Redirections installed by ScopedPoolRedirect on this thread, innermost last
+static thread_local std::vector<std::pair<AlignedMemoryPool*, AlignedMemoryPool*>> tl_redirects;
+
+ScopedPoolRedirect::ScopedPoolRedirect(AlignedMemoryPool* from, AlignedMemoryPool* to) {
+  tl_redirects.push_back(std::make_pair(from, to));
+}
+
+ScopedPoolRedirect::~ScopedPoolRedirect() {
+  tl_redirects.pop_back();
+}
+
+AlignedMemoryPool* AlignedMemoryPool::redirected() {
+  for (auto it = tl_redirects.rbegin(); it != tl_redirects.rend(); ++it)
+    if (it->first == this) return it->second;
+  return nullptr;
+}
+
 void* InternalMemoryPool::allocate(size_t n) {
   auto rounded_n = a->round_up_align(n);
   if (rounded_n + used > capacity) {
@@ -17,13 +38,15 @@ void* InternalMemoryPool::allocate(size_t n) {
 
 void InternalMemoryPool::sys_alloc(size_t cap) {
   capacity = a->round_up_align(cap);
-  mem = a->malloc(capacity);
+  mem = a->malloc_zeroed(capacity);
   if (mem == NULL)
     DYNET_RUNTIME_ERR(name << " failed to allocate " << capacity);
   used = 0;
 }
 
-AlignedMemoryPool::AlignedMemoryPool(const std::string &name, size_t initial_cap, MemAllocator *a, size_t expanding_unit) : name(name), cap(initial_cap), current(0), a(a), expanding_unit(expanding_unit) {
+AlignedMemoryPool::AlignedMemoryPool(const std::string &name, size_t initial_cap, MemAllocator *a, size_t expanding_unit) :
+    name(name), cap(initial_cap), initial_cap(initial_cap), current(0), a(a), expanding_unit(expanding_unit),
+    base(0), peak(0), high_water(0), use_peak(0), recent_peaks(kTrimWindow, 0), num_uses(0) {
   DYNET_ARG_CHECK(cap > 0, "Attempt to allocate memory of size 0 in AlignedMemoryPool");
   pools.push_back(new InternalMemoryPool(name, cap, a));
 }
@@ -32,34 +55,107 @@ AlignedMemoryPool::~AlignedMemoryPool() {
 }
 
 void* AlignedMemoryPool::allocate(size_t n) {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->allocate(n);
+  }
   void *res = pools[current]->allocate(n);
   if (res == 0) {
-    // round up to the nearest multiple of expanding_unit
-    size_t new_pool_size  = (n + expanding_unit-1) / expanding_unit * expanding_unit;
+    // grow geometrically, so that a graph much larger than the pool only
+    // needs a few sub-pools, and round up to a multiple of expanding_unit
+    size_t new_pool_size = round_up_expanding(std::max(n, cap / 2));
     pools.push_back(new InternalMemoryPool(name, new_pool_size, a));
     cap += new_pool_size;
+    base += pools[current]->used;
     current++;
     res = pools[current]->allocate(n);
   }
   if (res == nullptr) show_pool_mem_info();
+  peak = std::max(peak, base + pools[current]->used);
   return res;
 }
 
 void AlignedMemoryPool::free() {
-  if (current > 0) {
-    for (auto p : pools) { delete p; }
-    pools.clear();
-    pools.push_back(new InternalMemoryPool(name, cap, a));
-    current = 0;
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->free();
   }
+  high_water = std::max(high_water, peak);
+  use_peak = std::max(use_peak, peak);
+  // Memory split over several sub-pools is coalesced into a single block
+  // that can hold the largest use so far (or, when trimming, the largest
+  // recent use). A trimmed pool also shrinks once it is much larger than
+  // needed.
+  size_t needed = high_water;
+  if (trim_mem_flag)
+    needed = std::max(use_peak, *std::max_element(recent_peaks.begin(), recent_peaks.end()));
+  needed = std::max(initial_cap, round_up_expanding(needed));
+  if (current > 0 || (trim_mem_flag && num_uses >= kTrimWindow && cap > 2 * needed))
+    reallocate(needed);
   pools[0]->free();
+  base = 0;
+  peak = 0;
+}
+
+void AlignedMemoryPool::end_of_use() {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->end_of_use();
+  }
+  high_water = std::max(high_water, peak);
+  use_peak = std::max(use_peak, peak);
+  // memory still held from this use is not counted again for the next one
+  peak = 0;
+  // a use that allocated nothing, e.g. a graph cleared twice, tells nothing
+  if (use_peak == 0) return;
+  recent_peaks[num_uses++ % kTrimWindow] = use_peak;
+  use_peak = 0;
+}
+
+size_t AlignedMemoryPool::get_high_water() {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->get_high_water();
+  }
+  return std::max(high_water, peak);
+}
+
+void AlignedMemoryPool::trim() {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->trim();
+  }
+  if (used() != 0)
+    DYNET_RUNTIME_ERR("Cannot trim " << name << " while " << used() << " bytes are allocated");
+  if (cap > initial_cap)
+    reallocate(initial_cap);
+  std::fill(recent_peaks.begin(), recent_peaks.end(), 0);
+  num_uses = 0;
+  use_peak = 0;
+}
+
+void AlignedMemoryPool::reallocate(size_t new_cap) {
+  for (auto p : pools) { delete p; }
+  pools.clear();
+  pools.push_back(new InternalMemoryPool(name, new_cap, a));
+  cap = new_cap;
+  current = 0;
+  base = 0;
 }
 
 void AlignedMemoryPool::zero_allocated_memory() {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->zero_allocated_memory();
+  }
   for (auto p : pools) { p->zero_allocated_memory(); }
 }
 
 size_t AlignedMemoryPool::used() {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->used();
+  }
   if (current == 0) {
     return pools[0]->used;
   }
@@ -69,6 +165,10 @@ size_t AlignedMemoryPool::used() {
 }
 
 void AlignedMemoryPool::set_used(size_t s) {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->set_used(s);
+  }
   if(s != pools.back()->used) {
     DYNET_ARG_CHECK(pools.size() == 1, "Dynet does not support both dynamic increasing of memory pool size, and automatic batching or memory checkpointing. If you want to use automatic batching or checkpointing, please pre-allocate enough memory using the --dynet-mem command line option (details http://dynet.readthedocs.io/en/latest/commandline.html).");
     pools[0]->used = s;
@@ -85,6 +185,69 @@ void AlignedMemoryPool::set_used(size_t s) {
   // current = c;
 }
 
+void* PoolFreeList::allocate(size_t n) {
+  n = pool->round_up_align(n);
+  auto it = by_size.lower_bound(n);
+  if (it == by_size.end())
+    return pool->allocate(n);
+  char* p = it->second;
+  size_t sz = it->first;
+  erase(by_addr.find(p));
+  if (sz > n)
+    insert(p + n, sz - n);
+  return p;
+}
+
+void PoolFreeList::release(void* v, size_t n) {
+  char* p = static_cast<char*>(v);
+  n = pool->round_up_align(n);
+  // merge with the following block
+  auto next = by_addr.find(p + n);
+  if (next != by_addr.end()) {
+    n += next->second;
+    erase(next);
+  }
+  // merge with the preceding block
+  auto prev = by_addr.lower_bound(p);
+  if (prev != by_addr.begin()) {
+    --prev;
+    if (prev->first + prev->second == p) {
+      p = prev->first;
+      n += prev->second;
+      erase(prev);
+    }
+  }
+  insert(p, n);
+}
+
+void PoolFreeList::clear() {
+  by_addr.clear();
+  by_size.clear();
+  free_bytes = 0;
+}
+
+void PoolFreeList::insert(char* p, size_t n) {
+  by_addr[p] = n;
+  by_size.insert(std::make_pair(n, p));
+  free_bytes += n;
+}
+
+void PoolFreeList::erase(std::map<char*, size_t>::iterator it) {
+  auto range = by_size.equal_range(it->second);
+  for (auto jt = range.first; jt != range.second; ++jt) {
+    if (jt->second == it->first) {
+      by_size.erase(jt);
+      break;
+    }
+  }
+  free_bytes -= it->second;
+  by_addr.erase(it);
+}
+
 size_t AlignedMemoryPool::get_cap() {
+  if (!tl_redirects.empty()) {
+    AlignedMemoryPool* r = redirected();
+    if (r != nullptr) return r->get_cap();
+  }
   return cap;
 }
@@ -2,6 +2,7 @@
 #define DYNET_ALIGNED_MEM_POOL_H
 
 #include <iostream>
+#include <map>
 #include "dynet/mem.h"
 #include "dynet/globals.h"
 #include "dynet/except.h"
@@ -12,7 +13,6 @@ class InternalMemoryPool {
  public:
   explicit InternalMemoryPool(const std::string & name, size_t cap, MemAllocator* a) : name(name), a(a) {
     sys_alloc(cap);
-    zero_all();
   }
 
   ~InternalMemoryPool() {
@@ -33,11 +33,9 @@ class InternalMemoryPool {
 
   size_t used;
  private:
+  // gets zeroed memory; it is only zeroed again when it is reused
   void sys_alloc(size_t cap);
 
-  void zero_all() {
-    a->zero(mem, capacity);
-  }
   std::string name;
   size_t capacity;
   MemAllocator* a;
@@ -52,20 +50,87 @@ class AlignedMemoryPool {
     void* allocate(size_t n);
 
     void free();
+    // Ends a use of the pool, i.e. a graph, whose peak is kept to decide when
+    // to trim. free() may be called many times per use, e.g. after each node
+    // for scratch memory.
+    void end_of_use();
 
     void zero_allocated_memory();
 
     size_t used();
     void set_used(size_t s);
     size_t get_cap();
+    // most memory that was in use at once since the pool was created
+    size_t get_high_water();
+    // Gives the memory beyond the initial capacity back to the system, e.g.
+    // after an unusually large graph. Nothing may be allocated.
+    void trim();
+    size_t round_up_align(size_t n) const { return a->round_up_align(n); }
+    MemAllocator* get_allocator() const { return a; }
 
   private:
+    friend class ScopedPoolRedirect;
+    AlignedMemoryPool* redirected();
+    // replaces all sub-pools with a single one of the given capacity
+    void reallocate(size_t new_cap);
+    size_t round_up_expanding(size_t n) const { return (n + expanding_unit - 1) / expanding_unit * expanding_unit; }
+    // number of uses (see end_of_use()) whose peaks are kept
+    static const size_t kTrimWindow = 16;
     std::string name;
     std::vector<InternalMemoryPool *> pools;
     size_t cap;
+    const size_t initial_cap;
     int current;
     MemAllocator* a;
     size_t expanding_unit;
+    size_t base;  // memory used in the sub-pools before the current one
+    size_t peak;  // most memory in use since the last free() or end_of_use()
+    size_t high_water;
+    size_t use_peak;  // most memory in use since the last end_of_use()
+    std::vector<size_t> recent_peaks;  // peaks of the last uses (ring buffer)
+    size_t num_uses;
+};
+
+/**
+ * \brief A free list on top of an AlignedMemoryPool
+ * \details Blocks returned with release() are coalesced with their free
+ *          neighbours and handed out again (best fit) by allocate(), which
+ *          only falls back to the underlying pool when no free block is large
+ *          enough. The list must be cleared whenever the pool itself is freed.
+ */
+class PoolFreeList {
+  public:
+    explicit PoolFreeList(AlignedMemoryPool* pool) : pool(pool), free_bytes(0) {}
+
+    void* allocate(size_t n);
+    void release(void* p, size_t n);
+    void clear();
+
+    size_t get_free_bytes() const { return free_bytes; }
+
+  private:
+    void insert(char* p, size_t n);
+    void erase(std::map<char*, size_t>::iterator it);
+
+    AlignedMemoryPool* pool;
+    std::map<char*, size_t> by_addr;
+    std::multimap<size_t, char*> by_size;
+    size_t free_bytes;
+};
+
+/**
+ * \brief Redirects a memory pool to another one on the current thread
+ * \details While the guard is alive, every call this thread makes on `from` is
+ *          forwarded to `to`; other threads still see `from`. This lets code
+ *          running on worker threads keep using `device->pools[...]` while
+ *          actually drawing from private memory.
+ */
+class ScopedPoolRedirect {
+  public:
+    ScopedPoolRedirect(AlignedMemoryPool* from, AlignedMemoryPool* to);
+    ~ScopedPoolRedirect();
+    ScopedPoolRedirect(const ScopedPoolRedirect&) = delete;
+    ScopedPoolRedirect& operator=(const ScopedPoolRedirect&) = delete;
 };
 
 } // namespace dynet
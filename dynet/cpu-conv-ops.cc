@@ -0,0 +1,507 @@
+#include "dynet/tensor-eigen.h"
+#include "dynet/cpu-conv-ops.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "dynet/matrix-multiply.h"
+
+using namespace std;
+
+namespace dynet {
+
+namespace {
+
+typedef Eigen::Map<Eigen::MatrixXf, Eigen::Unaligned, Eigen::OuterStride<> > MatrixMap;
+typedef Eigen::Map<const Eigen::MatrixXf, Eigen::Unaligned, Eigen::OuterStride<> > ConstMatrixMap;
+
+// Elements of the im2col matrix computed at once: enough rows to amortize the
+// packing of the filter in the product, few enough to stay in cache
+const size_t kBlockElems = 1 << 20;
+const size_t kMinBlockRows = 256;
+// Smallest convolutions for which the multiplications saved by Winograd
+// outweigh its transforms and its 16 smaller matrix products: enough input
+// and output channels, and outputs per image
+const int kWinogradMinChannels = 32;
+const int kWinogradMinOutputs = 28 * 28;
+
+// y = a * b (or y += a * b when acc), split by rows of y across the threads
+template <class A, class B, class Y>
+void multiply(const Device_CPU & dev, const A& a, const B& b, Y& y, bool acc) {
+  CPUParallelFor(dev, y.rows(), 2.0 * a.cols() * y.cols(), 16, [&](Eigen::Index begin, Eigen::Index end) {
+    if (acc)
+      y.middleRows(begin, end - begin).noalias() += a.middleRows(begin, end - begin) * b;
+    else
+      y.middleRows(begin, end - begin).noalias() = a.middleRows(begin, end - begin) * b;
+  });
+}
+
+// Images [b, b+nb) and output columns [c0, c0+nc) computed at once. Blocks of
+// several images always hold whole images.
+struct Blocking {
+  unsigned nb;
+  int nc;
+  size_t rows;
+};
+
+// Splits bd images of cols columns of col_rows rows into blocks of about
+// max_rows rows
+Blocking blocking(unsigned bd, int cols, int col_rows, size_t max_rows) {
+  Blocking bl;
+  const size_t image_rows = (size_t)cols * col_rows;
+  if (image_rows <= max_rows) {
+    bl.nb = min<size_t>(bd, max_rows / image_rows);
+    bl.nc = cols;
+  } else {
+    bl.nb = 1;
+    bl.nc = min<size_t>(cols, max<size_t>(1, max_rows / col_rows));
+  }
+  bl.rows = (size_t)bl.nb * bl.nc * col_rows;
+  return bl;
+}
+
+template <class F>
+void for_each_block(unsigned bd, int cols, const Blocking& bl, F f) {
+  for (unsigned b = 0; b < bd; b += bl.nb)
+    for (int c = 0; c < cols; c += bl.nc)
+      f(b, min(bl.nb, bd - b), c, min(bl.nc, cols - c));
+}
+
+// [lo, hi): the outputs o for which o*stride + k - pad is within [0, in)
+inline void valid_range(int k, int pad, int stride, int in, int out, int& lo, int& hi) {
+  lo = k >= pad ? 0 : (pad - k + stride - 1) / stride;
+  hi = in + pad - k > 0 ? (in + pad - k + stride - 1) / stride : 0;
+  lo = min(lo, out);
+  hi = max(lo, min(hi, out));
+}
+
+} // namespace
+
+struct CPUConvOp::Shape {
+  int h, w, ci;   // input
+  int kh, kw, co; // filter
+  int oh, ow;     // output
+  int sh, sw;     // strides
+  int ph, pw;     // padding before the first row and column
+  unsigned bd;
+  // columns of the im2col matrix
+  int k() const { return kh * kw * ci; }
+  size_t x_size() const { return (size_t)h * w * ci; }
+  size_t y_size() const { return (size_t)oh * ow * co; }
+  // 1x1 filters with stride 1 multiply the input itself
+  bool pointwise() const { return kh == 1 && kw == 1 && sh == 1 && sw == 1; }
+};
+
+namespace {
+
+// Copies the windows of images x[0..nb) (of s.x_size() each) for the output
+// columns [c0, c0+nc) into p, of leading dimension ld: column i + kh*(j +
+// kw*c) holds element (i, j) of the windows on channel c, with a row per
+// output position of each image, in the order of the output.
+template <class Shape>
+void im2col(const Device_CPU & dev, const Shape& s, const float* x, unsigned nb, int c0, int nc, float* p, size_t ld) {
+  const size_t image_rows = (size_t)s.oh * nc;
+  CPUParallelFor(dev, nb * s.ci, (double)s.kh * s.kw * image_rows, 1, [&](Eigen::Index begin, Eigen::Index end) {
+    for (Eigen::Index item = begin; item < end; ++item) {
+      const unsigned n = item / s.ci;
+      const int c = item % s.ci;
+      const float* xc = x + n * s.x_size() + (size_t)c * s.h * s.w;
+      for (int j = 0; j < s.kw; ++j) {
+        for (int i = 0; i < s.kh; ++i) {
+          float* dst = p + (size_t)(i + s.kh * (j + s.kw * c)) * ld + n * image_rows;
+          if (s.oh == 1) {
+            // a single row of output (e.g. text): copy along the row
+            int lo, hi;
+            valid_range(j, s.pw, s.sw, s.w, c0 + nc, lo, hi);
+            const int ih = i - s.ph;
+            if (ih < 0 || ih >= s.h) lo = hi = c0 + nc;
+            lo = max(lo, c0);
+            hi = max(hi, lo);
+            for (int ow = c0; ow < lo; ++ow)
+              dst[ow - c0] = 0.f;
+            const float* src = xc + ih;
+            for (int ow = lo; ow < hi; ++ow)
+              dst[ow - c0] = src[(size_t)(ow * s.sw + j - s.pw) * s.h];
+            for (int ow = hi; ow < c0 + nc; ++ow)
+              dst[ow - c0] = 0.f;
+            continue;
+          }
+          int lo, hi;
+          valid_range(i, s.ph, s.sh, s.h, s.oh, lo, hi);
+          if (s.sh == 1 && s.sw == 1 && s.oh == s.h) {
+            // the columns of the windows follow each other in the input:
+            // copy them at once, then clear the rows of padding
+            int wlo, whi;
+            valid_range(j, s.pw, 1, s.w, c0 + nc, wlo, whi);
+            wlo = max(wlo, c0);
+            whi = max(whi, wlo);
+            fill(dst, dst + (size_t)(wlo - c0) * s.oh, 0.f);
+            fill(dst + (size_t)(whi - c0) * s.oh, dst + (size_t)nc * s.oh, 0.f);
+            const ptrdiff_t offset = i - s.ph + (ptrdiff_t)s.h * (wlo + j - s.pw);
+            const ptrdiff_t q0 = max<ptrdiff_t>(0, -offset);
+            const ptrdiff_t q1 = min<ptrdiff_t>((ptrdiff_t)s.oh * (whi - wlo), (ptrdiff_t)s.h * s.w - offset);
+            float* d = dst + (size_t)(wlo - c0) * s.oh;
+            if (q1 > q0)
+              memcpy(d + q0, xc + offset + q0, (q1 - q0) * sizeof(float));
+            for (int ow = wlo; ow < whi; ++ow, d += s.oh) {
+              for (int oh = 0; oh < lo; ++oh)
+                d[oh] = 0.f;
+              for (int oh = hi; oh < s.oh; ++oh)
+                d[oh] = 0.f;
+            }
+            continue;
+          }
+          for (int ow = c0; ow < c0 + nc; ++ow) {
+            float* d = dst + (size_t)(ow - c0) * s.oh;
+            const int iw = ow * s.sw + j - s.pw;
+            if (iw < 0 || iw >= s.w) {
+              fill(d, d + s.oh, 0.f);
+              continue;
+            }
+            const float* src = xc + (size_t)iw * s.h;
+            fill(d, d + lo, 0.f);
+            if (s.sh == 1) {
+              memcpy(d + lo, src + lo + i - s.ph, (hi - lo) * sizeof(float));
+            } else {
+              for (int oh = lo; oh < hi; ++oh)
+                d[oh] = src[oh * s.sh + i - s.ph];
+            }
+            fill(d + hi, d + s.oh, 0.f);
+          }
+        }
+      }
+    }
+  });
+}
+
+// The reverse of im2col: adds the elements of the windows in p back to the
+// images dx[0..nb)
+template <class Shape>
+void col2im(const Device_CPU & dev, const Shape& s, const float* p, size_t ld, unsigned nb, int c0, int nc, float* dx) {
+  const size_t image_rows = (size_t)s.oh * nc;
+  CPUParallelFor(dev, nb * s.ci, (double)s.kh * s.kw * image_rows, 1, [&](Eigen::Index begin, Eigen::Index end) {
+    for (Eigen::Index item = begin; item < end; ++item) {
+      const unsigned n = item / s.ci;
+      const int c = item % s.ci;
+      float* dxc = dx + n * s.x_size() + (size_t)c * s.h * s.w;
+      for (int j = 0; j < s.kw; ++j) {
+        for (int i = 0; i < s.kh; ++i) {
+          const float* src = p + (size_t)(i + s.kh * (j + s.kw * c)) * ld + n * image_rows;
+          if (s.oh == 1) {
+            const int ih = i - s.ph;
+            if (ih < 0 || ih >= s.h) continue;
+            int lo, hi;
+            valid_range(j, s.pw, s.sw, s.w, c0 + nc, lo, hi);
+            lo = max(lo, c0);
+            float* dst = dxc + ih;
+            for (int ow = lo; ow < hi; ++ow)
+              dst[(size_t)(ow * s.sw + j - s.pw) * s.h] += src[ow - c0];
+            continue;
+          }
+          int lo, hi;
+          valid_range(i, s.ph, s.sh, s.h, s.oh, lo, hi);
+          for (int ow = c0; ow < c0 + nc; ++ow) {
+            const int iw = ow * s.sw + j - s.pw;
+            if (iw < 0 || iw >= s.w) continue;
+            const float* d = src + (size_t)(ow - c0) * s.oh;
+            float* dst = dxc + (size_t)iw * s.h;
+            for (int oh = lo; oh < hi; ++oh)
+              dst[oh * s.sh + i - s.ph] += d[oh];
+          }
+        }
+      }
+    }
+  });
+}
+
+// Copies the columns of the nb images of y (of image_rows rows and y_size
+// elements each) to the column-major matrix t of nb*image_rows rows, or back
+// when to_t is false
+void gather_images(const float* y, size_t image_rows, size_t y_size, int cols, unsigned nb, float* t, bool to_t) {
+  const size_t rows = nb * image_rows;
+  for (unsigned n = 0; n < nb; ++n) {
+    for (int c = 0; c < cols; ++c) {
+      float* tc = t + c * rows + n * image_rows;
+      float* yc = const_cast<float*>(y) + n * y_size + c * image_rows;
+      if (to_t)
+        memcpy(tc, yc, image_rows * sizeof(float));
+      else
+        memcpy(yc, tc, image_rows * sizeof(float));
+    }
+  }
+}
+
+} // namespace
+
+CPUConvOp::CPUConvOp(const std::vector<unsigned>& s, const bool padding_type) :
+    stride_(s), is_valid_(padding_type) {}
+
+CPUConvOp::Shape CPUConvOp::get_shape(const Dim& x, const Dim& f) const {
+  Shape s;
+  s.h = x[0]; s.w = x[1]; s.ci = x[2];
+  s.kh = f[0]; s.kw = f[1]; s.co = f[3];
+  s.sh = stride_[0]; s.sw = stride_[1];
+  if (is_valid_) {
+    s.oh = (s.h - s.kh) / s.sh + 1;
+    s.ow = (s.w - s.kw) / s.sw + 1;
+    s.ph = s.pw = 0;
+  } else {
+    // padding split as evenly as possible, the extra row or column after
+    s.oh = (s.h + s.sh - 1) / s.sh;
+    s.ow = (s.w + s.sw - 1) / s.sw;
+    s.ph = max((s.oh - 1) * s.sh + s.kh - s.h, 0) / 2;
+    s.pw = max((s.ow - 1) * s.sw + s.kw - s.w, 0) / 2;
+  }
+  s.bd = x.bd;
+  return s;
+}
+
+CPUConvOp::Algorithm CPUConvOp::forward_algorithm(const Dim& x, const Dim& f) const {
+  const Shape s = get_shape(x, f);
+  if (s.kh == 3 && s.kw == 3 && s.sh == 1 && s.sw == 1 && s.oh * s.ow >= kWinogradMinOutputs &&
+      s.ci >= kWinogradMinChannels && s.co >= kWinogradMinChannels)
+    return WINOGRAD;
+  return IM2COL;
+}
+
+void CPUConvOp::forward_impl(const Device_CPU & dev,
+                             const std::vector<const Tensor*>& xs, Tensor& fx) const {
+  const Shape s = get_shape(xs[0]->d, xs[1]->d);
+  if (forward_algorithm(xs[0]->d, xs[1]->d) == WINOGRAD)
+    forward_winograd(dev, s, xs[0]->v, xs[1]->v, fx.v);
+  else
+    forward_im2col(dev, s, xs[0]->v, xs[1]->v, fx.v);
+  if (xs.size() == 3) {
+    Eigen::Map<const Eigen::RowVectorXf> bias(xs[2]->v, s.co);
+    for (unsigned b = 0; b < s.bd; ++b)
+      Eigen::Map<Eigen::MatrixXf>(fx.v + b * s.y_size(), (size_t)s.oh * s.ow, s.co).rowwise() += bias;
+  }
+  dev.pools[(int)DeviceMempool::SCS]->free();
+}
+
+void CPUConvOp::forward_im2col(const Device_CPU & dev, const Shape& s,
+                               const float* x, const float* f, float* y) const {
+  AlignedMemoryPool* scratch_allocator = dev.pools[(int)DeviceMempool::SCS];
+  const int k = s.k();
+  const size_t image_rows = (size_t)s.oh * s.ow;
+  const Blocking bl = blocking(s.bd, s.ow, s.oh, max(kMinBlockRows, kBlockElems / k));
+  // the patches of 1x1 filters over single images are the input itself
+  float* p = s.pointwise() && bl.nb == 1 ? nullptr :
+             static_cast<float*>(scratch_allocator->allocate(bl.rows * k * sizeof(float)));
+  float* tmp = bl.nb > 1 ? static_cast<float*>(scratch_allocator->allocate(bl.rows * s.co * sizeof(float))) : nullptr;
+  ConstMatrixMap filter(f, k, s.co, Eigen::OuterStride<>(k));
+  for_each_block(s.bd, s.ow, bl, [&](unsigned b, unsigned nb, int c0, int nc) {
+    const size_t rows = (size_t)nb * nc * s.oh;
+    const float* pm = p;
+    size_t ldp = rows;
+    if (s.pointwise() && nb == 1) {
+      pm = x + b * s.x_size() + (size_t)c0 * s.h;
+      ldp = (size_t)s.h * s.w;
+    } else {
+      im2col(dev, s, x + b * s.x_size(), nb, c0, nc, p, rows);
+    }
+    ConstMatrixMap patches(pm, rows, k, Eigen::OuterStride<>(ldp));
+    if (nb == 1) {
+      MatrixMap out(y + b * s.y_size() + (size_t)c0 * s.oh, rows, s.co, Eigen::OuterStride<>(image_rows));
+      multiply(dev, patches, filter, out, false);
+    } else {
+      MatrixMap out(tmp, rows, s.co, Eigen::OuterStride<>(rows));
+      multiply(dev, patches, filter, out, false);
+      gather_images(y + b * s.y_size(), image_rows, s.y_size(), s.co, nb, tmp, false);
+    }
+  });
+}
+
+// Winograd F(2x2, 3x3) as in Lavin and Gray (2016): each 2x2 block of output
+// (a tile) is A^T [(G g G^T) . (B^T d B)] A, where d is the 4x4 block of input
+// it reads and g the filter. The products over channels of the 16 elements of
+// the transformed filters and inputs are 16 matrix products.
+void CPUConvOp::forward_winograd(const Device_CPU & dev, const Shape& s,
+                                 const float* x, const float* f, float* y) const {
+  AlignedMemoryPool* scratch_allocator = dev.pools[(int)DeviceMempool::SCS];
+  const int th = (s.oh + 1) / 2, tw = (s.ow + 1) / 2;
+  const size_t image_rows = (size_t)s.oh * s.ow;
+  const Blocking bl = blocking(s.bd, tw, th, max(kMinBlockRows, kBlockElems / (16 * s.ci)));
+  const size_t u_size = (size_t)s.ci * s.co;
+  float* u = static_cast<float*>(scratch_allocator->allocate(16 * u_size * sizeof(float)));
+  float* v = static_cast<float*>(scratch_allocator->allocate(16 * bl.rows * s.ci * sizeof(float)));
+  float* m = static_cast<float*>(scratch_allocator->allocate(16 * bl.rows * s.co * sizeof(float)));
+
+  // u[xi*4+nu] = (G g G^T)[xi][nu], as ci x co matrices
+  CPUParallelFor(dev, s.co, 60.0 * s.ci, 1, [&](Eigen::Index begin, Eigen::Index end) {
+    for (Eigen::Index o = begin; o < end; ++o) {
+      for (int c = 0; c < s.ci; ++c) {
+        const float* g = f + 9 * (c + (size_t)s.ci * o);
+        float gg[4][3];
+        for (int j = 0; j < 3; ++j) {
+          const float g0 = g[3 * j], g1 = g[3 * j + 1], g2 = g[3 * j + 2];
+          gg[0][j] = g0;
+          gg[1][j] = 0.5f * (g0 + g1 + g2);
+          gg[2][j] = 0.5f * (g0 - g1 + g2);
+          gg[3][j] = g2;
+        }
+        float* uc = u + c + (size_t)s.ci * o;
+        for (int xi = 0; xi < 4; ++xi) {
+          const float a0 = gg[xi][0], a1 = gg[xi][1], a2 = gg[xi][2];
+          uc[(xi * 4) * u_size] = a0;
+          uc[(xi * 4 + 1) * u_size] = 0.5f * (a0 + a1 + a2);
+          uc[(xi * 4 + 2) * u_size] = 0.5f * (a0 - a1 + a2);
+          uc[(xi * 4 + 3) * u_size] = a2;
+        }
+      }
+    }
+  });
+
+  for_each_block(s.bd, tw, bl, [&](unsigned b, unsigned nb, int c0, int nc) {
+    const size_t rows = (size_t)nb * nc * th;
+    const size_t v_size = rows * s.ci, m_size = rows * s.co;
+    // v[xi*4+nu] = (B^T d B)[xi][nu], as rows x ci matrices with a row per
+    // tile. B is applied across the four columns of input read by a column of
+    // tiles, then B^T along the resulting columns, for all its tiles at once.
+    const int hp = 2 * th + 2;
+    CPUParallelFor(dev, nb * s.ci, 64.0 * nc * th, 1, [&](Eigen::Index begin, Eigen::Index end) {
+      vector<float> e(4 * hp), zeros(s.h, 0.f);
+      const int rlo = min(s.ph, hp), rhi = max(rlo, min(hp, s.h + s.ph));
+      for (Eigen::Index item = begin; item < end; ++item) {
+        const unsigned n = item / s.ci;
+        const int c = item % s.ci;
+        const float* xc = x + (b + n) * s.x_size() + (size_t)c * s.h * s.w;
+        for (int tj = c0; tj < c0 + nc; ++tj) {
+          const float* d[4];
+          for (int j = 0; j < 4; ++j) {
+            const int iw = 2 * tj - s.pw + j;
+            d[j] = (iw >= 0 && iw < s.w) ? xc + (size_t)iw * s.h : zeros.data();
+          }
+          // e[nu] holds the rows of the columns padded before by s.ph
+          float* e0 = e.data(), *e1 = e0 + hp, *e2 = e1 + hp, *e3 = e2 + hp;
+          for (int r = 0; r < rlo; ++r)
+            e0[r] = e1[r] = e2[r] = e3[r] = 0.f;
+          for (int r = rlo; r < rhi; ++r) {
+            const int ih = r - s.ph;
+            e0[r] = d[0][ih] - d[2][ih];
+            e1[r] = d[1][ih] + d[2][ih];
+            e2[r] = d[2][ih] - d[1][ih];
+            e3[r] = d[1][ih] - d[3][ih];
+          }
+          for (int r = rhi; r < hp; ++r)
+            e0[r] = e1[r] = e2[r] = e3[r] = 0.f;
+          float* vr = v + n * nc * th + (size_t)(tj - c0) * th + rows * c;
+          for (int nu = 0; nu < 4; ++nu) {
+            const float* en = e.data() + nu * hp;
+            float* v0 = vr + nu * v_size;
+            float* v1 = vr + (4 + nu) * v_size;
+            float* v2 = vr + (8 + nu) * v_size;
+            float* v3 = vr + (12 + nu) * v_size;
+            for (int ti = 0; ti < th; ++ti) {
+              const float r0 = en[2 * ti], r1 = en[2 * ti + 1], r2 = en[2 * ti + 2], r3 = en[2 * ti + 3];
+              v0[ti] = r0 - r2;
+              v1[ti] = r1 + r2;
+              v2[ti] = r2 - r1;
+              v3[ti] = r1 - r3;
+            }
+          }
+        }
+      }
+    });
+    // m[k] = v[k] * u[k]
+    CPUParallelFor(dev, 16, 2.0 * m_size * s.ci, 1, [&](Eigen::Index begin, Eigen::Index end) {
+      for (Eigen::Index k = begin; k < end; ++k)
+        Eigen::Map<Eigen::MatrixXf>(m + k * m_size, rows, s.co).noalias() =
+            Eigen::Map<const Eigen::MatrixXf>(v + k * v_size, rows, s.ci) *
+            Eigen::Map<const Eigen::MatrixXf>(u + k * u_size, s.ci, s.co);
+    });
+    // y = A^T m A, for all the tiles of a column at once, dropping the
+    // outputs past the last row or column
+    CPUParallelFor(dev, nb * s.co, 40.0 * nc * th, 1, [&](Eigen::Index begin, Eigen::Index end) {
+      vector<float> out(4 * th);
+      float* out0 = out.data(), *out1 = out0 + 2 * th;
+      for (Eigen::Index item = begin; item < end; ++item) {
+        const unsigned n = item / s.co;
+        const int o = item % s.co;
+        float* yo = y + (b + n) * s.y_size() + o * image_rows;
+        for (int tj = c0; tj < c0 + nc; ++tj) {
+          const float* mr = m + n * nc * th + (size_t)(tj - c0) * th + rows * o;
+          for (int ti = 0; ti < th; ++ti) {
+            float a0[4], a1[4];
+            for (int nu = 0; nu < 4; ++nu) {
+              const float m0 = mr[nu * m_size + ti], m1 = mr[(4 + nu) * m_size + ti],
+                          m2 = mr[(8 + nu) * m_size + ti], m3 = mr[(12 + nu) * m_size + ti];
+              a0[nu] = m0 + m1 + m2;
+              a1[nu] = m1 - m2 - m3;
+            }
+            out0[2 * ti] = a0[0] + a0[1] + a0[2];
+            out0[2 * ti + 1] = a1[0] + a1[1] + a1[2];
+            out1[2 * ti] = a0[1] - a0[2] - a0[3];
+            out1[2 * ti + 1] = a1[1] - a1[2] - a1[3];
+          }
+          const int ow = 2 * tj;
+          memcpy(yo + (size_t)ow * s.oh, out0, s.oh * sizeof(float));
+          if (ow + 1 < s.ow)
+            memcpy(yo + (size_t)(ow + 1) * s.oh, out1, s.oh * sizeof(float));
+        }
+      }
+    });
+  });
+}
+
+void CPUConvOp::backward_impl(const Device_CPU & dev,
+                              const std::vector<const Tensor*>& xs,
+                              const Tensor& fx,
+                              const Tensor& dEdf,
+                              unsigned i,
+                              Tensor& dEdxi) const {
+  if (i == 2) { // backward w.r.t the bias
+    Eigen::array<ptrdiff_t, 3> red_axis = {0, 1, 3};
+    t<1>(dEdxi).device(*dev.edevice) += tb<3>(dEdf).sum(red_axis);
+    return;
+  }
+  AlignedMemoryPool* scratch_allocator = dev.pools[(int)DeviceMempool::SCS];
+  const Shape s = get_shape(xs[0]->d, xs[1]->d);
+  const int k = s.k();
+  const size_t image_rows = (size_t)s.oh * s.ow;
+  const Blocking bl = blocking(s.bd, s.ow, s.oh, max(kMinBlockRows, kBlockElems / k));
+  // the patches of 1x1 filters over single images are the input itself
+  float* p = s.pointwise() && bl.nb == 1 ? nullptr :
+             static_cast<float*>(scratch_allocator->allocate(bl.rows * k * sizeof(float)));
+  float* tmp = bl.nb > 1 ? static_cast<float*>(scratch_allocator->allocate(bl.rows * s.co * sizeof(float))) : nullptr;
+  const float* x = xs[0]->v;
+  ConstMatrixMap filter(xs[1]->v, k, s.co, Eigen::OuterStride<>(k));
+  for_each_block(s.bd, s.ow, bl, [&](unsigned b, unsigned nb, int c0, int nc) {
+    const size_t rows = (size_t)nb * nc * s.oh;
+    const float* dym = dEdf.v + b * s.y_size() + (size_t)c0 * s.oh;
+    size_t ldy = image_rows;
+    if (nb > 1) {
+      gather_images(dEdf.v + b * s.y_size(), image_rows, s.y_size(), s.co, nb, tmp, true);
+      dym = tmp;
+      ldy = rows;
+    }
+    ConstMatrixMap dy(dym, rows, s.co, Eigen::OuterStride<>(ldy));
+    const bool direct = s.pointwise() && nb == 1;
+    if (i == 0) { // backward w.r.t the input
+      float* dx = dEdxi.v + b * s.x_size();
+      if (direct) {
+        MatrixMap dpatches(dx + (size_t)c0 * s.h, rows, k, Eigen::OuterStride<>((size_t)s.h * s.w));
+        multiply(dev, dy, filter.transpose(), dpatches, true);
+      } else {
+        MatrixMap dpatches(p, rows, k, Eigen::OuterStride<>(rows));
+        multiply(dev, dy, filter.transpose(), dpatches, false);
+        col2im(dev, s, p, rows, nb, c0, nc, dx);
+      }
+    } else { // backward w.r.t the kernel
+      const float* pm = p;
+      size_t ldp = rows;
+      if (direct) {
+        pm = x + b * s.x_size() + (size_t)c0 * s.h;
+        ldp = (size_t)s.h * s.w;
+      } else {
+        im2col(dev, s, x + b * s.x_size(), nb, c0, nc, p, rows);
+      }
+      ConstMatrixMap patches(pm, rows, k, Eigen::OuterStride<>(ldp));
+      MatrixMap dfilter(dEdxi.v, k, s.co, Eigen::OuterStride<>(k));
+      multiply(dev, patches.transpose(), dy, dfilter, true);
+    }
+  });
+  scratch_allocator->free();
+}
+
+} // namespace dynet
@@ -0,0 +1,63 @@
+#ifndef DYNET_CPU_CONV_OPS_H
+#define DYNET_CPU_CONV_OPS_H
+
+#include <vector>
+
+#include "dynet/dim.h"
+#include "dynet/tensor.h"
+#include "dynet/devices.h"
+
+namespace dynet {
+
+/**
+ * \brief 2D convolution on CPU, reading and writing tensors in their own
+ *        H x W x C x N layout
+ * \details The convolution is computed as matrix products: windows of the
+ *          input are copied into the rows of a matrix (im2col), which is
+ *          multiplied by the filter seen as a (kh*kw*ci) x co matrix. The
+ *          rows for an output position are in the order of the output, so
+ *          the product is written in place, and the gradient of the input is
+ *          added back from the product by the gradient of the output
+ *          (col2im). Images too small to make an efficient product on their
+ *          own are multiplied together, and large ones by blocks of columns.
+ *
+ *          3x3 filters with stride 1 over enough channels and large enough
+ *          images are computed in the forward pass with the Winograd
+ *          F(2x2, 3x3) algorithm, which turns each 2x2 block of output into
+ *          16 products over channels instead of 36.
+ */
+class CPUConvOp {
+ public:
+  enum Algorithm { IM2COL, WINOGRAD };
+
+  explicit CPUConvOp(const std::vector<unsigned>& s, const bool padding_type);
+  /**
+   * \brief The algorithm used by forward_impl() for an input of dimension
+   *        x and a filter of dimension f
+   */
+  Algorithm forward_algorithm(const Dim& x, const Dim& f) const;
+  void forward_impl(const Device_CPU & dev,
+                    const std::vector<const Tensor*>& xs, Tensor& fx) const;
+  void backward_impl(const Device_CPU & dev,
+                     const std::vector<const Tensor*>& xs,
+                     const Tensor& fx,
+                     const Tensor& dEdf,
+                     unsigned i,
+                     Tensor& dEdxi) const;
+
+ protected:
+  // The shape of one convolution
+  struct Shape;
+  Shape get_shape(const Dim& x, const Dim& f) const;
+  void forward_im2col(const Device_CPU & dev, const Shape& s,
+                      const float* x, const float* f, float* y) const;
+  void forward_winograd(const Device_CPU & dev, const Shape& s,
+                        const float* x, const float* f, float* y) const;
+
+  std::vector<unsigned> stride_;
+  bool is_valid_;
+};
+
+} // namespace dynet
+
+#endif
@@ -114,6 +114,7 @@ Device_GPU::Device_GPU(int my_id, const DeviceMempoolSizes & mbs,
   edevice = new Eigen::GpuDevice(estream);
 
   // this is the big memory allocation.
+  pool_sizes = mbs;
   pools[0] = new AlignedMemoryPool("GPU forward memory", (mbs.used[0] << 20), &gpu_mem);
   pools[1] = new AlignedMemoryPool("GPU backward memory", (mbs.used[1] << 20), &gpu_mem);
   pools[2] = new AlignedMemoryPool("GPU parameter memory", (mbs.used[2] << 20), &gpu_mem);
@@ -135,8 +136,46 @@ void Device_GPU::reset_rng(unsigned seed) {
 }
 #endif
 
-Device_CPU::Device_CPU(int my_id, const DeviceMempoolSizes & mbs, bool shared) :
-  Device(my_id, DeviceType::CPU, &cpu_mem), shmem(mem) {
+CPUMemoryOptions::CPUMemoryOptions() : numa_node(-1) {
+#ifdef __AVX512F__
+  align = 64;
+#else
+  align = 32;
+#endif
+  for (auto & h : huge_pages) h = HugePages::NONE;
+}
+
+CPUMemoryOptions::CPUMemoryOptions(const std::string & descriptor, int numa_node, int align) :
+    numa_node(numa_node), align(align) {
+  vector<string> strs = str_split(descriptor, ',');
+  if (strs.size() != 1 && strs.size() != 4)
+    DYNET_INVALID_ARG("the format of --dynet-hugepages is invalid: " << descriptor);
+  for (size_t i = 0; i < 4; ++i) {
+    int mode = stoi(strs[strs.size() == 1 ? 0 : i]);
+    if (mode < 0 || mode > 2)
+      DYNET_INVALID_ARG("Bad huge page mode " << mode << " in --dynet-hugepages (0 for none, 1 for transparent, 2 for explicit)");
+    huge_pages[i] = (HugePages)mode;
+  }
+  if (numa_node >= 1024)
+    DYNET_INVALID_ARG("Bad NUMA node " << numa_node);
+  if (align < (int)sizeof(void*) || (align & (align - 1)) != 0)
+    DYNET_INVALID_ARG("Memory alignment must be a power of two and at least " << sizeof(void*) << ", but got " << align);
+}
+
+namespace {
+
+// Runs the tasks in the calling thread, for devices with a single thread
+class InlineThreadPool : public Eigen::ThreadPoolInterface {
+ public:
+  void Schedule(std::function<void()> fn) override { fn(); }
+  int NumThreads() const override { return 1; }
+  int CurrentThreadId() const override { return -1; }
+};
+
+} // namespace
+
+Device_CPU::Device_CPU(int my_id, const DeviceMempoolSizes & mbs, bool shared, const CPUMemoryOptions & opts, unsigned num_threads) :
+  Device(my_id, DeviceType::CPU, &cpu_mem), cpu_mem(opts.align, HugePages::NONE, opts.numa_node), edevice(nullptr), shmem(mem) {
   if (shared) shmem = new SharedAllocator();
   kSCALAR_MINUSONE = (float*) mem->malloc(sizeof(float));
   *kSCALAR_MINUSONE = -1;
@@ -147,16 +186,44 @@ Device_CPU::Device_CPU(int my_id, const DeviceMempoolSizes & mbs, bool shared) :
   name = "CPU";
 
   // Initialize the Eigen device
-  edevice = new Eigen::DefaultDevice;
+  set_num_threads(num_threads);
 
   // this is the big memory allocation.
-  pools[0] = new AlignedMemoryPool("CPU forward memory", (mbs.used[0] << 20), &cpu_mem);
-  pools[1] = new AlignedMemoryPool("CPU backward memory", (mbs.used[1] << 20), &cpu_mem);
-  pools[2] = new AlignedMemoryPool("CPU parameter memory", (mbs.used[2] << 20), shmem);
-  pools[3] = new AlignedMemoryPool("CPU scratch memory", (mbs.used[3] << 20), &cpu_mem);
+  pool_sizes = mbs;
+  for (int i = 0; i < 4; ++i)
+    if (i != (int)DeviceMempool::PS || !shared)
+      pool_mem.emplace_back(new CPUAllocator(opts.align, opts.huge_pages[i], opts.numa_node));
+    else
+      pool_mem.emplace_back(nullptr);
+  pools[0] = new AlignedMemoryPool("CPU forward memory", (mbs.used[0] << 20), pool_mem[0].get());
+  pools[1] = new AlignedMemoryPool("CPU backward memory", (mbs.used[1] << 20), pool_mem[1].get());
+  pools[2] = new AlignedMemoryPool("CPU parameter memory", (mbs.used[2] << 20), shared ? shmem : pool_mem[2].get());
+  pools[3] = new AlignedMemoryPool("CPU scratch memory", (mbs.used[3] << 20), pool_mem[3].get());
+}
+
+Device_CPU::~Device_CPU() {
+  delete edevice;
 }
 
-Device_CPU::~Device_CPU() {}
+void Device_CPU::set_num_threads(unsigned num_threads) {
+  DYNET_ARG_CHECK(num_threads > 0, "A CPU device needs at least one thread");
+  delete edevice;
+  if (num_threads == 1)
+    thread_pool.reset(new InlineThreadPool);
+  else
+    thread_pool.reset(new Eigen::ThreadPool(num_threads));
+  edevice = new Eigen::ThreadPoolDevice(thread_pool.get(), num_threads);
+#ifdef __INTEL_MKL__
+  // MKL runs the matrix multiplications on its own threads, as many as it
+  // chooses unless more than one thread was asked for
+  if (num_threads > 1)
+    mkl_set_num_threads(num_threads);
+#endif
+}
+
+unsigned Device_CPU::num_threads() const {
+  return edevice->numThreads();
+}
 
 
 DeviceManager::DeviceManager() {}
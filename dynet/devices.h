@@ -2,6 +2,7 @@
 #define DYNET_DEVICES_H
 
 #include <unordered_map>
+#include <memory>
 #include <string>
 #include <exception>
 #if HAVE_CUDA
@@ -14,7 +15,8 @@
 #include <unsupported/Eigen/CXX11/Tensor>
 
 namespace Eigen {
-  struct DefaultDevice;
+  struct ThreadPoolDevice;
+  class ThreadPoolInterface;
   class CudaStreamDevice;
   struct GpuDevice;
 }
@@ -40,6 +42,7 @@ class Device {
   virtual void revert(const DeviceMempoolSizes & cp);
   void allocate_tensor(DeviceMempool mem_pool, Tensor & tensor);
   std::vector<AlignedMemoryPool*> pools;
+  DeviceMempoolSizes pool_sizes;  // initial sizes of the pools, in MB
 };
 
 #if HAVE_CUDA
@@ -61,14 +64,36 @@ class Device_GPU : public Device {
 };
 #endif
 
+// How the memory of a CPU device is allocated
+struct CPUMemoryOptions {
+  CPUMemoryOptions();
+  // huge_pages is a mode (see HugePages) for all pools, or comma separated
+  // modes for the forward, backward, parameter and scratch pools
+  CPUMemoryOptions(const std::string & huge_pages, int numa_node, int align);
+  HugePages huge_pages[4];  // by DeviceMempool
+  int numa_node;  // NUMA node the pools are bound to, or -1
+  int align;  // alignment of all allocations, in bytes
+};
+
+// Operations run on the threads of a pool shared by the tensor expressions
+// and the matrix multiplications (with one thread, in the calling thread)
 class Device_CPU : public Device {
  public:
-  typedef Eigen::DefaultDevice EigenDevice;
-  explicit Device_CPU(int my_id, const DeviceMempoolSizes & mb, bool shared);
+  typedef Eigen::ThreadPoolDevice EigenDevice;
+  explicit Device_CPU(int my_id, const DeviceMempoolSizes & mb, bool shared,
+                      const CPUMemoryOptions & opts = CPUMemoryOptions(),
+                      unsigned num_threads = 1);
   ~Device_CPU();
+  // must not be called while operations are running on the device
+  void set_num_threads(unsigned num_threads);
+  unsigned num_threads() const;
   CPUAllocator cpu_mem;
-  Eigen::DefaultDevice* edevice;
+  Eigen::ThreadPoolDevice* edevice;
   MemAllocator* shmem;
+  // allocators of the pools, by DeviceMempool (nullptr for a shared PS pool)
+  std::vector<std::unique_ptr<CPUAllocator>> pool_mem;
+ private:
+  std::unique_ptr<Eigen::ThreadPoolInterface> thread_pool;
 };
 
 class DeviceManager final {
@@ -1,5 +1,7 @@
 #include <iomanip>
 #include <fstream>
+#include <atomic>
+#include <mutex>
 
 #include "dynet/dynet.h"
 
@@ -18,12 +20,78 @@ namespace dynet {
 float* kSCALAR_MINUSONE;
 float* kSCALAR_ONE;
 float* kSCALAR_ZERO;
-int n_hgs = 0;
-unsigned n_cumul_hgs = 0;
+std::atomic<int> n_hgs(0);
+std::atomic<unsigned> n_cumul_hgs(0);
 
 int get_number_of_active_graphs() {return n_hgs;};
 unsigned get_current_graph_id() {return n_cumul_hgs;};
 
+// The forward, backward and scratch memory pools of a graph that exists at
+// the same time as the graph using the pools of the devices
+struct GraphArena {
+  GraphArena() {
+    for (Device* dev : get_device_manager()->get_devices()) {
+      const DeviceMempoolSizes& mbs = dev->pool_sizes;
+      const vector<AlignedMemoryPool*>& pools = dev->pools;
+      fxs.push_back(new AlignedMemoryPool(dev->name + " forward memory (graph arena)", (mbs.used[0] << 20), pools[0]->get_allocator()));
+      dEdfs.push_back(new AlignedMemoryPool(dev->name + " backward memory (graph arena)", (mbs.used[1] << 20), pools[1]->get_allocator()));
+      scs.push_back(new AlignedMemoryPool(dev->name + " scratch memory (graph arena)", (mbs.used[3] << 20), pools[3]->get_allocator()));
+    }
+  }
+  ~GraphArena() {
+    for (auto p : fxs) delete p;
+    for (auto p : dEdfs) delete p;
+    for (auto p : scs) delete p;
+  }
+  std::vector<AlignedMemoryPool*> fxs, dEdfs, scs;  // by device
+};
+
+// Redirects the pools of all devices to the arena of a graph on the current
+// thread; does nothing for graphs that use the device pools
+class ArenaScope {
+ public:
+  explicit ArenaScope(GraphArena* arena) {
+    if (arena == nullptr) return;
+    const vector<Device*>& devs = get_device_manager()->get_devices();
+    for (size_t d = 0; d < devs.size(); ++d) {
+      redirects.emplace_back(new ScopedPoolRedirect(devs[d]->pools[(int)DeviceMempool::FXS], arena->fxs[d]));
+      redirects.emplace_back(new ScopedPoolRedirect(devs[d]->pools[(int)DeviceMempool::DEDFS], arena->dEdfs[d]));
+      redirects.emplace_back(new ScopedPoolRedirect(devs[d]->pools[(int)DeviceMempool::SCS], arena->scs[d]));
+    }
+  }
+  ~ArenaScope() {
+    // redirects have to be undone in reverse order
+    while (!redirects.empty()) redirects.pop_back();
+  }
+ private:
+  vector<unique_ptr<ScopedPoolRedirect>> redirects;
+};
+
+static std::mutex graphs_mutex;
+static bool device_pools_in_use = false;
+static vector<GraphArena*> free_arenas;  // arenas of destroyed graphs
+
+// Each existing graph holds a slot containing its id, which is reset when the
+// graph is destroyed, so expressions check their graph without locking. Slots
+// are reused by later graphs, which have new ids. They are allocated by
+// chunks that are never moved or freed.
+static const unsigned kGraphSlotsPerChunk = 256;
+static const unsigned kMaxGraphSlotChunks = 4096;
+static std::atomic<std::atomic<unsigned>*> graph_slot_chunks[kMaxGraphSlotChunks];
+static unsigned num_graph_slots = 0;
+static vector<unsigned> free_graph_slots;
+
+bool is_graph_alive(unsigned slot, unsigned id) {
+  const std::atomic<unsigned>* chunk =
+    graph_slot_chunks[slot / kGraphSlotsPerChunk].load(std::memory_order_acquire);
+  return chunk != nullptr && id != 0 &&
+         chunk[slot % kGraphSlotsPerChunk].load(std::memory_order_acquire) == id;
+}
+
+static std::atomic<unsigned>& graph_slot_id(unsigned slot) {
+  return graph_slot_chunks[slot / kGraphSlotsPerChunk].load()[slot % kGraphSlotsPerChunk];
+}
+
 Node::~Node() {}
 size_t Node::aux_storage_size() const { return 0; }
 
@@ -50,6 +118,56 @@ void Node::backward(const std::vector<const Tensor*>& xs,
   }
 }
 
+NodeArena::~NodeArena() {
+  for (auto & c : chunks)
+    ::operator delete(c.mem);
+}
+
+void* NodeArena::allocate(size_t n) {
+  const size_t align = alignof(std::max_align_t);
+  n = (n + align - 1) / align * align;
+  // chunks left over from before a clear() or revert() are reused first
+  while (chunk < chunks.size() && used + n > chunks[chunk].size) {
+    ++chunk;
+    used = 0;
+  }
+  if (chunk == chunks.size()) {
+    Chunk c;
+    c.size = std::max(kChunkSize, n);
+    c.mem = static_cast<char*>(::operator new(c.size));
+    chunks.push_back(c);
+    used = 0;
+  }
+  void* p = chunks[chunk].mem + used;
+  used += n;
+  return p;
+}
+
+size_t NodeArena::capacity() const {
+  size_t n = 0;
+  for (auto & c : chunks)
+    n += c.size;
+  return n;
+}
+
+static thread_local bool tl_backward_assign = false;
+
+bool Node::backward_assigns() { return tl_backward_assign; }
+
+void Node::backward_assign(const std::vector<const Tensor*>& xs,
+                           const Tensor& fx,
+                           const Tensor& dEdf,
+                           unsigned xs_i,
+                           Tensor& dEdxi) const {
+  DYNET_ASSERT(supports_backward_assign(), "Node " << as_dummy_string() << " does not support backward_assign");
+  // reset even if backward throws
+  struct AssignScope {
+    AssignScope() { tl_backward_assign = true; }
+    ~AssignScope() { tl_backward_assign = false; }
+  } scope;
+  backward(xs, fx, dEdf, xs_i, dEdxi);
+}
+
 void Node::autobatch_reshape_concatonly(const ComputationGraph & cg,
                                         const std::vector<VariableIndex> & batch_ids,
                                         const std::vector<int> & concat,
@@ -68,50 +186,115 @@ void Node::autobatch_reshape_concatonly(const ComputationGraph & cg,
 }
 
 ComputationGraph::ComputationGraph() {
-  if(autobatch_flag) {
+  batched = autobatch_flag;
+  if(batched) {
     ee.reset(new BatchedExecutionEngine(*this));
   } else {
     ee.reset(new SimpleExecutionEngine(*this));
   }
-  if (n_hgs > 0) {
-    cerr << "Memory allocator assumes only a single ComputationGraph at a time.\n";
-    throw std::runtime_error("Attempted to create >1 CG");
-  }
-  ++n_hgs;
   immediate_compute = false;
   check_validity = false;
-  ++n_cumul_hgs;
-  graph_id = n_cumul_hgs;
+  inference_mode = false;
+  remat_mode = false;
+  frozen = false;
+  register_graph();
 }
 
-ComputationGraph::ComputationGraph(bool batched) {
+ComputationGraph::ComputationGraph(bool batched) : batched(batched) {
   if(batched) {
     ee.reset(new BatchedExecutionEngine(*this));
   } else {
     ee.reset(new SimpleExecutionEngine(*this));
   }
-  if (n_hgs > 0) {
-    cerr << "Memory allocator assumes only a single ComputationGraph at a time.\n";
-    throw std::runtime_error("Attempted to create >1 CG");
-  }
-  ++n_hgs;
   immediate_compute = false;
   check_validity = false;
-  ++n_cumul_hgs;
-  graph_id = n_cumul_hgs;
+  inference_mode = false;
+  remat_mode = false;
+  frozen = false;
+  register_graph();
 }
 
 ComputationGraph::~ComputationGraph() {
-  this->clear();
+  {
+    ArenaScope scope(arena);
+    this->clear();
+    ee.reset();
+  }
+  std::lock_guard<std::mutex> lk(graphs_mutex);
+  graph_slot_id(graph_slot).store(0, std::memory_order_release);
+  free_graph_slots.push_back(graph_slot);
   --n_hgs;
+  if (arena != nullptr)
+    free_arenas.push_back(arena);
+  else
+    device_pools_in_use = false;
+}
+
+// The first graph uses the memory pools of the devices, graphs created while
+// it exists lease an arena
+void ComputationGraph::register_graph() {
+  std::lock_guard<std::mutex> lk(graphs_mutex);
+  arena = nullptr;
+  if (device_pools_in_use) {
+    if (free_arenas.empty()) {
+      arena = new GraphArena();
+    } else {
+      arena = free_arenas.back();
+      free_arenas.pop_back();
+    }
+  } else {
+    device_pools_in_use = true;
+  }
+  ++n_hgs;
+  graph_id = ++n_cumul_hgs;
+  if (free_graph_slots.empty()) {
+    if (num_graph_slots == kGraphSlotsPerChunk * kMaxGraphSlotChunks)
+      DYNET_RUNTIME_ERR("Too many computation graphs exist at the same time");
+    if (num_graph_slots % kGraphSlotsPerChunk == 0) {
+      std::atomic<unsigned>* chunk = new std::atomic<unsigned>[kGraphSlotsPerChunk];
+      for (unsigned j = 0; j < kGraphSlotsPerChunk; ++j) chunk[j].store(0);
+      graph_slot_chunks[num_graph_slots / kGraphSlotsPerChunk].store(chunk, std::memory_order_release);
+    }
+    graph_slot = num_graph_slots++;
+  } else {
+    graph_slot = free_graph_slots.back();
+    free_graph_slots.pop_back();
+  }
+  graph_slot_id(graph_slot).store(graph_id, std::memory_order_release);
 }
 
 void ComputationGraph::clear() {
+  ArenaScope scope(arena);
   parameter_nodes.clear();
-  for (auto n : nodes) delete n;
-  nodes.clear();
-
+  destroy_nodes(0);
+  node_arena.clear();
+  retained.clear();
+  frozen = false;
+
+  if (batch_stats_flag) {
+    AutobatchStats stats = ee->autobatch_stats();
+    if (stats.forward_calls > 0)
+      cerr << "[dynet] autobatching of graph " << graph_id << ":\n" << stats;
+  }
+  ee->clear_autobatch_stats();
   ee->invalidate();
+  // pools that trim keep the peak of each graph, not of each free()
+  for (Device* dev : get_device_manager()->get_devices()) {
+    dev->pools[(int)DeviceMempool::FXS]->end_of_use();
+    dev->pools[(int)DeviceMempool::DEDFS]->end_of_use();
+    dev->pools[(int)DeviceMempool::SCS]->end_of_use();
+  }
+}
+
+AutobatchStats ComputationGraph::autobatch_stats() const {
+  return ee->autobatch_stats();
+}
+
+void ComputationGraph::destroy_nodes(VariableIndex from) {
+  // the memory of the nodes belongs to node_arena, so only run destructors
+  for (size_t i = from; i < nodes.size(); ++i)
+    nodes[i]->~Node();
+  nodes.resize(from);
 }
 
 VariableIndex ComputationGraph::add_function_node(Node *node, Device *device) {
@@ -130,22 +313,35 @@ VariableIndex ComputationGraph::add_function_node(Node *node, Device *device) {
   return new_node_index;
 }
 
-CGCheckpoint ComputationGraph::_get_checkpoint() {
+CGCheckpoint ComputationGraph::_get_checkpoint(bool evaluate) {
+  ArenaScope scope(arena);
   CGCheckpoint p;
-  p.device_mem_checkpoint = default_device->mark(this);
+  p.has_device_mem = evaluate;
+  if (evaluate)
+    p.device_mem_checkpoint = default_device->mark(this);
   p.node_idx = nodes.size();
   p.par_node_idx = parameter_nodes.size();
+  p.node_mem_checkpoint = node_arena.mark();
   return p;
 }
 
 void ComputationGraph::_revert(CGCheckpoint p) {
-  default_device->revert(p.device_mem_checkpoint);
+  if (frozen)
+    DYNET_RUNTIME_ERR("Cannot revert a frozen ComputationGraph");
+  ArenaScope scope(arena);
+  if (p.has_device_mem)
+    default_device->revert(p.device_mem_checkpoint);
   // clear all nodes at position >= p.node_idx
   if ((int)nodes.size() > p.node_idx) {
-    for(int i = p.node_idx; i < (int)nodes.size(); i++)
-      delete nodes[i]; // the deletion of nodes.
-    nodes.resize(p.node_idx);
-    ee->invalidate(p.node_idx - 1); // clear precomputed forward values
+    destroy_nodes(p.node_idx);
+    node_arena.revert(p.node_mem_checkpoint);
+    if ((int)retained.size() > p.node_idx)
+      retained.resize(p.node_idx);
+    // clear precomputed forward values
+    if (p.node_idx > 0)
+      ee->invalidate(p.node_idx - 1);
+    else
+      ee->invalidate();
   }
   // clear all parameter nodes at position >= p.par_node_idx
   if ((int)parameter_nodes.size() > p.par_node_idx) {
@@ -153,8 +349,8 @@ void ComputationGraph::_revert(CGCheckpoint p) {
   }
 }
 
-void ComputationGraph::checkpoint() {
-  checkpoints.push_back(_get_checkpoint());
+void ComputationGraph::checkpoint(bool evaluate) {
+  checkpoints.push_back(_get_checkpoint(evaluate));
 }
 
 void ComputationGraph::revert() {
@@ -171,7 +367,7 @@ Dim& ComputationGraph::get_dimension(VariableIndex index) const {
 
 VariableIndex ComputationGraph::add_input(real s, Device *device) {
   VariableIndex new_node_index(nodes.size());
-  nodes.push_back(new ScalarInputNode(s));
+  nodes.push_back(make_node<ScalarInputNode>(s));
   nodes.back()->device = device;
   set_dim_for_new_node(new_node_index);
   return new_node_index;
@@ -179,7 +375,7 @@ VariableIndex ComputationGraph::add_input(real s, Device *device) {
 
 VariableIndex ComputationGraph::add_input(const real* ps, Device *device) {
   VariableIndex new_node_index(nodes.size());
-  nodes.push_back(new ScalarInputNode(ps));
+  nodes.push_back(make_node<ScalarInputNode>(ps));
   nodes.back()->device = device;
   set_dim_for_new_node(new_node_index);
   return new_node_index;
@@ -187,7 +383,7 @@ VariableIndex ComputationGraph::add_input(const real* ps, Device *device) {
 
 VariableIndex ComputationGraph::add_input(const Dim& d, const vector<float>& pm, Device *device) {
   VariableIndex new_node_index(nodes.size());
-  nodes.push_back(new InputNode(d, pm));
+  nodes.push_back(make_node<InputNode>(d, pm));
   nodes.back()->device = device;
   set_dim_for_new_node(new_node_index);
   return new_node_index;
@@ -195,7 +391,7 @@ VariableIndex ComputationGraph::add_input(const Dim& d, const vector<float>& pm,
 
 VariableIndex ComputationGraph::add_input(const Dim& d, const vector<float>* pm, Device *device) {
   VariableIndex new_node_index(nodes.size());
-  nodes.push_back(new InputNode(d, pm));
+  nodes.push_back(make_node<InputNode>(d, pm));
   nodes.back()->device = device;
   set_dim_for_new_node(new_node_index);
   return new_node_index;
@@ -204,7 +400,7 @@ VariableIndex ComputationGraph::add_input(const Dim& d, const vector<float>* pm,
 VariableIndex ComputationGraph::add_input(const Dim& d, const vector<unsigned int>& ids,
                                           const vector<float>& data, Device *device, float defdata) {
   VariableIndex new_node_index(nodes.size());
-  nodes.push_back(new SparseInputNode(d, ids, data, defdata));
+  nodes.push_back(make_node<SparseInputNode>(d, ids, data, defdata));
   nodes.back()->device = device;
   set_dim_for_new_node(new_node_index);
   return new_node_index;
@@ -212,7 +408,7 @@ VariableIndex ComputationGraph::add_input(const Dim& d, const vector<unsigned in
 
 VariableIndex ComputationGraph::add_parameters(Parameter p) {
   VariableIndex new_node_index(nodes.size());
-  ParameterNode* new_node = new ParameterNode(p);
+  ParameterNode* new_node = make_node<ParameterNode>(p);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   parameter_nodes.push_back(new_node_index);
@@ -222,7 +418,7 @@ VariableIndex ComputationGraph::add_parameters(Parameter p) {
 
 VariableIndex ComputationGraph::add_parameters(LookupParameter p) {
   VariableIndex new_node_index(nodes.size());
-  ParameterNode* new_node = new ParameterNode(p);
+  ParameterNode* new_node = make_node<ParameterNode>(p);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   parameter_nodes.push_back(new_node_index);
@@ -232,7 +428,7 @@ VariableIndex ComputationGraph::add_parameters(LookupParameter p) {
 
 VariableIndex ComputationGraph::add_const_parameters(Parameter p) {
   VariableIndex new_node_index(nodes.size());
-  ConstParameterNode* new_node = new ConstParameterNode(p);
+  ConstParameterNode* new_node = make_node<ConstParameterNode>(p);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   set_dim_for_new_node(new_node_index);
@@ -241,7 +437,7 @@ VariableIndex ComputationGraph::add_const_parameters(Parameter p) {
 
 VariableIndex ComputationGraph::add_const_parameters(LookupParameter p) {
   VariableIndex new_node_index(nodes.size());
-  ConstParameterNode* new_node = new ConstParameterNode(p);
+  ConstParameterNode* new_node = make_node<ConstParameterNode>(p);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   set_dim_for_new_node(new_node_index);
@@ -250,7 +446,7 @@ VariableIndex ComputationGraph::add_const_parameters(LookupParameter p) {
 
 VariableIndex ComputationGraph::add_lookup(LookupParameter p, const unsigned* pindex) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, pindex);
+  LookupNode* new_node = make_node<LookupNode>(p, pindex);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   parameter_nodes.push_back(new_node_index);
@@ -260,7 +456,7 @@ VariableIndex ComputationGraph::add_lookup(LookupParameter p, const unsigned* pi
 
 VariableIndex ComputationGraph::add_lookup(LookupParameter p, unsigned index) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, index);
+  LookupNode* new_node = make_node<LookupNode>(p, index);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   parameter_nodes.push_back(new_node_index);
@@ -270,7 +466,7 @@ VariableIndex ComputationGraph::add_lookup(LookupParameter p, unsigned index) {
 
 VariableIndex ComputationGraph::add_lookup(LookupParameter p, const std::vector<unsigned>& indices) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, indices);
+  LookupNode* new_node = make_node<LookupNode>(p, indices);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   parameter_nodes.push_back(new_node_index);
@@ -280,7 +476,7 @@ VariableIndex ComputationGraph::add_lookup(LookupParameter p, const std::vector<
 
 VariableIndex ComputationGraph::add_lookup(LookupParameter p, const std::vector<unsigned>* indices) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, indices);
+  LookupNode* new_node = make_node<LookupNode>(p, indices);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   parameter_nodes.push_back(new_node_index);
@@ -291,7 +487,7 @@ VariableIndex ComputationGraph::add_lookup(LookupParameter p, const std::vector<
 
 VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, const unsigned* pindex) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, pindex);
+  LookupNode* new_node = make_node<LookupNode>(p, pindex);
   // get rid of the following in favor of using parameter_nodes to see the needs_derivative
   // expression
   nodes.push_back(new_node);
@@ -302,7 +498,7 @@ VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, const unsign
 
 VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, unsigned index) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, index);
+  LookupNode* new_node = make_node<LookupNode>(p, index);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   set_dim_for_new_node(new_node_index);
@@ -311,7 +507,7 @@ VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, unsigned ind
 
 VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, const std::vector<unsigned>& indices) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, indices);
+  LookupNode* new_node = make_node<LookupNode>(p, indices);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   set_dim_for_new_node(new_node_index);
@@ -320,7 +516,7 @@ VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, const std::v
 
 VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, const std::vector<unsigned>* indices) {
   VariableIndex new_node_index(nodes.size());
-  LookupNode* new_node = new LookupNode(p, indices);
+  LookupNode* new_node = make_node<LookupNode>(p, indices);
   nodes.push_back(new_node);
   nodes.back()->device = p.get_storage().device;
   set_dim_for_new_node(new_node_index);
@@ -331,6 +527,13 @@ VariableIndex ComputationGraph::add_const_lookup(LookupParameter p, const std::v
 // to set its dimensions properly
 void ComputationGraph::set_dim_for_new_node(const VariableIndex& i) {
   Node* node = nodes[i];
+  if (frozen) {
+    if (!parameter_nodes.empty() && parameter_nodes.back() == i)
+      parameter_nodes.pop_back();
+    destroy_nodes(i);
+    node_arena.revert(frozen_node_mark);
+    DYNET_RUNTIME_ERR("Cannot add nodes to a frozen ComputationGraph");
+  }
   vector<Dim> xds(node->arity());
   unsigned ai = 0;
   for (VariableIndex arg : node->args) {
@@ -349,17 +552,22 @@ void ComputationGraph::set_dim_for_new_node(const VariableIndex& i) {
   }
 }
 
-const Tensor& ComputationGraph::incremental_forward(const Expression& last) { return ee->incremental_forward(last.i); }
-const Tensor& ComputationGraph::forward(const Expression& last) { return ee->forward(last.i); }
-const Tensor& ComputationGraph::incremental_forward(VariableIndex last) { return ee->incremental_forward(last); }
-const Tensor& ComputationGraph::forward(VariableIndex last) { return ee->forward(last); }
-const Tensor& ComputationGraph::get_value(VariableIndex i) { return ee->get_value(i); }
+const Tensor& ComputationGraph::incremental_forward(const Expression& last) { return this->incremental_forward(last.i); }
+const Tensor& ComputationGraph::forward(const Expression& last) { return this->forward(last.i); }
+const Tensor& ComputationGraph::incremental_forward(VariableIndex last) { ArenaScope scope(arena); return ee->incremental_forward(last); }
+const Tensor& ComputationGraph::forward(VariableIndex last) { ArenaScope scope(arena); return ee->forward(last); }
+const Tensor& ComputationGraph::get_value(VariableIndex i) { ArenaScope scope(arena); return ee->get_value(i); }
 const Tensor& ComputationGraph::get_value(const Expression& e) { return this->get_value(e.i); }
-const Tensor& ComputationGraph::get_gradient(VariableIndex i) { return ee->get_gradient(i); }
+const Tensor& ComputationGraph::get_gradient(VariableIndex i) { ArenaScope scope(arena); return ee->get_gradient(i); }
 const Tensor& ComputationGraph::get_gradient(const Expression& e) { return this->get_gradient(e.i); }
-void ComputationGraph::invalidate() { ee->invalidate(); }
-void ComputationGraph::backward(const Expression& last, bool full) { ee->backward(last.i, full); }
-void ComputationGraph::backward(VariableIndex i, bool full) { ee->backward(i, full); }
+void ComputationGraph::invalidate() { ArenaScope scope(arena); ee->invalidate(); }
+void ComputationGraph::backward(const Expression& last, bool full) { this->backward(last.i, full); }
+void ComputationGraph::backward(VariableIndex i, bool full) {
+  if (inference_mode)
+    DYNET_RUNTIME_ERR("backward() cannot be called on a ComputationGraph in inference mode");
+  ArenaScope scope(arena);
+  ee->backward(i, full);
+}
 
 void ComputationGraph::set_immediate_compute(bool ic) {
   immediate_compute = ic;
@@ -369,6 +577,53 @@ void ComputationGraph::set_check_validity(bool cv) {
   check_validity = cv;
 }
 
+void ComputationGraph::set_inference_mode(bool im) {
+  if (im && frozen)
+    DYNET_RUNTIME_ERR("Inference mode cannot be used with a frozen ComputationGraph");
+  if (im != inference_mode) {
+    inference_mode = im;
+    ArenaScope scope(arena);
+    ee->invalidate();
+  }
+}
+
+void ComputationGraph::set_remat_mode(bool rm) {
+  if (rm && frozen)
+    DYNET_RUNTIME_ERR("Rematerialization mode cannot be used with a frozen ComputationGraph");
+  if (rm != remat_mode) {
+    remat_mode = rm;
+    ArenaScope scope(arena);
+    if (batched) {
+      if (remat_mode)
+        ee.reset(new SimpleExecutionEngine(*this));
+      else
+        ee.reset(new BatchedExecutionEngine(*this));
+    }
+    ee->invalidate();
+  }
+}
+
+void ComputationGraph::freeze() {
+  if (inference_mode || remat_mode)
+    DYNET_RUNTIME_ERR("A ComputationGraph in inference or rematerialization mode cannot be frozen");
+  frozen = true;
+  frozen_node_mark = node_arena.mark();
+}
+
+bool ComputationGraph::has_retained() const {
+  for (bool r : retained)
+    if (r) return true;
+  return false;
+}
+
+void ComputationGraph::retain(const Expression& e) { this->retain(e.i); }
+void ComputationGraph::retain(VariableIndex i) {
+  DYNET_ARG_CHECK(i < nodes.size(), "Attempt to retain node " << i << " of a graph with " << nodes.size() << " nodes");
+  if (retained.size() <= i)
+    retained.resize(nodes.size(), false);
+  retained[i] = true;
+}
+
 void ComputationGraph::print_graphviz() const {
   cerr << "digraph G {\n  rankdir=LR;\n  nodesep=.05;\n";
   unsigned nc = 0;
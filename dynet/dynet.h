@@ -6,9 +6,12 @@
 #ifndef DYNET_DYNET_H_
 #define DYNET_DYNET_H_
 
+#include <cstddef>
 #include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <new>
 #include <string>
 #include <utility>
 #include <vector>
@@ -29,17 +32,27 @@ extern float* kSCALAR_ZERO;
 /**
  * \ingroup compgraph
  * \brief Gets the number of active graphs
- * \details This is 0 or 1, you can't create more than one graph at once
+ * \details Graphs can exist at the same time, e.g. one per thread
  * \return Number of active graphs
  */
 int get_number_of_active_graphs();
 /**
  * \ingroup compgraph
- * \brief Get id of the current active graph
+ * \brief Get id of the most recently created graph
  * \details This can help check whether a graph is stale
  * \return Id of the current graph
  */
 unsigned get_current_graph_id();
+/**
+ * \ingroup compgraph
+ * \brief Check whether the graph with the given slot and id still exists
+ * \details Thread-safe and lock-free.
+ *
+ * \param slot Slot of a graph, as returned by ComputationGraph::get_slot()
+ * \param id Id of the graph, as returned by ComputationGraph::get_id()
+ * \return Whether the graph has not been destroyed yet
+ */
+bool is_graph_alive(unsigned slot, unsigned id);
 
 // devices provide information about GPUs and CPUs
 // these include any API information that is required to make calls
@@ -50,15 +63,123 @@ unsigned get_current_graph_id();
 extern Device* default_device;  // where parameters go by default
 
 class ExecutionEngine;
+struct AutobatchStats;
 struct ParameterNodeBase;
 struct Node;
 struct Expression;
+struct GraphArena;
 
 typedef unsigned VariableIndex;
 
+/**
+ * \ingroup compgraph
+ * \brief Arguments of a node
+ * \details Behaves like a constant std::vector<VariableIndex>. Up to kInline
+ * arguments are stored within the node itself, so that most nodes need no
+ * separate heap allocation.
+ */
+class NodeArgs {
+ public:
+  static const unsigned kInline = 4;
+  typedef const VariableIndex* const_iterator;
+  typedef const_iterator iterator;
+
+  NodeArgs() : n(0) {}
+  NodeArgs(const std::initializer_list<VariableIndex>& a) : n(0) { assign(a.begin(), a.end()); }
+  template <class It>
+  NodeArgs(It first, It last) : n(0) { assign(first, last); }
+  NodeArgs(const NodeArgs& o) : n(0) { assign(o.begin(), o.end()); }
+  NodeArgs& operator=(const NodeArgs& o) {
+    if (this != &o) {
+      release();
+      assign(o.begin(), o.end());
+    }
+    return *this;
+  }
+  ~NodeArgs() { release(); }
+
+  size_t size() const { return n; }
+  bool empty() const { return n == 0; }
+  const VariableIndex* data() const { return n > kInline ? heap : local; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + n; }
+  const VariableIndex& operator[](size_t i) const { return data()[i]; }
+  const VariableIndex& front() const { return data()[0]; }
+  const VariableIndex& back() const { return data()[n - 1]; }
+  operator std::vector<VariableIndex>() const { return std::vector<VariableIndex>(begin(), end()); }
+
+ private:
+  template <class It>
+  void assign(It first, It last) {
+    n = (unsigned)std::distance(first, last);
+    VariableIndex* dest = n > kInline ? (heap = new VariableIndex[n]) : local;
+    for (; first != last; ++first)
+      *dest++ = *first;
+  }
+  void release() {
+    if (n > kInline) delete[] heap;
+    n = 0;
+  }
+  unsigned n;
+  union {
+    VariableIndex local[kInline];
+    VariableIndex* heap;
+  };
+};
+
+/**
+ * \ingroup compgraph
+ * \brief Bump allocator for the nodes of a ComputationGraph
+ * \details Memory is carved out of large chunks and only released all at once
+ * (or back to a mark), after the nodes living in it have been destroyed. The
+ * chunks are kept for the next nodes, so a graph that is cleared and rebuilt
+ * does no memory allocation for its nodes at all.
+ */
+class NodeArena {
+ public:
+  struct Mark {
+    size_t chunk, used;
+  };
+  NodeArena() : chunk(0), used(0) {}
+  NodeArena(const NodeArena&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+  ~NodeArena();
+  /**
+   * \brief Allocate n bytes, aligned for any fundamental type
+   */
+  void* allocate(size_t n);
+  /**
+   * \brief The current position, to which revert() can go back
+   */
+  Mark mark() const { return {chunk, used}; }
+  /**
+   * \brief Release everything allocated since mark m
+   */
+  void revert(const Mark& m) { chunk = m.chunk; used = m.used; }
+  /**
+   * \brief Release everything
+   */
+  void clear() { chunk = 0; used = 0; }
+  /**
+   * \brief Total size of the chunks held
+   */
+  size_t capacity() const;
+
+ private:
+  static const size_t kChunkSize = 1 << 16;
+  struct Chunk {
+    char* mem;
+    size_t size;
+  };
+  std::vector<Chunk> chunks;
+  size_t chunk, used;  // current chunk, and bytes used in it
+};
+
 struct CGCheckpoint {
   int node_idx;
   int par_node_idx;
+  NodeArena::Mark node_mem_checkpoint;
+  bool has_device_mem;  // whether the graph was evaluated up to the checkpoint
   DeviceMempoolSizes device_mem_checkpoint;
 };
 
@@ -80,6 +201,16 @@ inline void swap(VariableIndex& i1, VariableIndex& i2) {
  * are the tails of the edge. You shouldn't need to use most methods from the
  * ComputationGraph except for `backward` since most of them are available
  * directly from the Expression class.
+ *
+ * Several graphs can exist at the same time, and different threads can build
+ * and execute their own graphs concurrently. The first graph uses the
+ * forward, backward and scratch memory pools of the devices; graphs created
+ * while it exists lease arenas with pools of their own, which are reused by
+ * later graphs once they are destroyed. All graphs share the parameters.
+ * Reading parameters from several threads is safe, but computing gradients
+ * of the same parameters concurrently (backward()), updating parameters,
+ * and random operations such as dropout are not: those must be serialized
+ * by the caller. A graph itself must only be used by one thread at a time.
  */
 struct ComputationGraph {
   /**
@@ -326,8 +457,16 @@ struct ComputationGraph {
   void clear();
   /**
    * \brief Set a checkpoint
+   * \details The graph is evaluated up to its last node first, so that
+   * revert() can also release the memory of the values computed since.
+   * With evaluate set to false, only the nodes are recorded: revert() then
+   * removes the nodes added since without releasing memory, which is how
+   * the nodes of a failed construction are taken back before the graph is
+   * run.
+   *
+   * \param evaluate Whether to evaluate the graph first
    */
-  void checkpoint();
+  void checkpoint(bool evaluate = true);
   /**
    * \brief Revert to last checkpoint
    */
@@ -472,6 +611,74 @@ struct ComputationGraph {
   void set_immediate_compute(bool ic);
   // set check_validity variable
   void set_check_validity(bool cv);
+  /**
+   * \brief Turn inference mode on or off
+   * \details A graph in inference mode cannot be differentiated, which lets
+   * the execution engine free the forward value of a node as soon as all of
+   * its consumers have been computed, and reuse that memory for later nodes.
+   * Values that were requested through forward(), values that have no
+   * consumers, leaves such as parameters and inputs, and values marked with
+   * retain() are kept. Accessing a freed
+   * value is an error. Changing the mode invalidates all computed values.
+   *
+   * \param im Whether to use inference mode
+   */
+  void set_inference_mode(bool im);
+  bool is_inference_mode() const { return inference_mode; }
+  /**
+   * \brief Keep the forward value of a node in inference mode
+   * \details Call this before the value's consumers are computed for values
+   * that will be used again by nodes added later (e.g. encoder states that
+   * are attended to while decoding).
+   *
+   * \param e Expression whose value should be kept
+   */
+  void retain(const Expression& e);
+  void retain(VariableIndex i);
+  bool is_retained(VariableIndex i) const { return i < retained.size() && retained[i]; }
+  /**
+   * \brief Turn rematerialization (gradient checkpointing) on or off
+   * \details In this mode forward values are freed as in inference mode, but
+   * backward() is still allowed: values it needs that were freed are
+   * recomputed from the nearest kept values, and freed again once the
+   * backward pass has moved past them. Values marked with retain() act as
+   * checkpoints; if there are none, every ceil(sqrt(n))-th node is kept.
+   * Nodes with auxiliary storage (e.g. dropout masks) are always kept, so the
+   * recomputed values match the original ones. Rematerialization is done by
+   * the unbatched execution engine, which an autobatched graph switches to
+   * while the mode is on. Changing the mode invalidates all computed values.
+   *
+   * \param rm Whether to rematerialize forward values during backward
+   */
+  void set_remat_mode(bool rm);
+  bool is_remat_mode() const { return remat_mode; }
+  // whether any node has been marked with retain()
+  bool has_retained() const;
+  /**
+   * \brief Freeze the graph for replay
+   * \details After this no nodes can be added to the graph. Once its values
+   * have been computed, calling forward() again re-executes the existing
+   * nodes with the memory and (when autobatching) the batches planned by the
+   * first evaluation, without building or planning anything. This makes it
+   * possible to build a graph of fixed structure once and evaluate it on
+   * many examples: feed the inputs through placeholders that read their
+   * values when the graph is executed, i.e. input() with a pointer to a
+   * vector or a real, and lookup() with a pointer to an index, and change
+   * the pointed-to values between calls to forward(). Parameter values are
+   * also re-read, so backward() and parameter updates work as usual.
+   * Freezing is not compatible with inference or rematerialization mode.
+   */
+  void freeze();
+  bool is_frozen() const { return frozen; }
+
+  /**
+   * \brief Counters of how the nodes of the graph were batched
+   * \details They cover the forward calls since the graph was created or last
+   * cleared, and are all zero if the graph is not autobatched. With
+   * `--dynet-batch-stats 1` they are printed whenever the graph is cleared or
+   * destroyed. AutobatchStats is defined in dynet/exec.h.
+   */
+  AutobatchStats autobatch_stats() const;
 
   /**
    * \brief Used for debugging
@@ -485,6 +692,11 @@ struct ComputationGraph {
    * created \return graph id
    */
   unsigned get_id() const { return graph_id; };
+  /**
+   * \brief Get the slot of the graph, to be given with its id to
+   *        is_graph_alive()
+   */
+  unsigned get_slot() const { return graph_slot; };
 
   // data
   std::vector<Node*> nodes;  // **stored in topological order**
@@ -496,17 +708,40 @@ struct ComputationGraph {
 
  private:
   unsigned graph_id;
+  unsigned graph_slot;
+  // memory of the node objects
+  NodeArena node_arena;
+  // forward/backward/scratch memory of the graph, or nullptr if it uses the
+  // pools of the devices
+  GraphArena* arena;
   // flag of whether to compute immediately for each expression, i.e., an
   // imperative execution style to help debug.
   bool immediate_compute;
   // flag of checking Inf/NaN of each layer. Only performing checking when
   // immediate_compute is also set to true.
   bool check_validity;
+  // flag of whether backward is disabled, so forward memory can be reused
+  bool inference_mode;
+  // flag of whether freed forward values are recomputed for backward
+  bool remat_mode;
+  // whether the graph was created with the autobatching engine
+  bool batched;
+  // flag of whether new nodes are rejected and forward() replays the graph
+  bool frozen;
+  // position of node_arena when the graph was frozen
+  NodeArena::Mark frozen_node_mark;
+  std::vector<bool> retained;  // nodes whose values must be kept in inference/remat mode
   VariableIndex add_function_node(Node *node, Device *device = nullptr);
+  // Construct a node in node_arena. Nodes are destroyed by destroy_nodes().
+  template <class Function, typename... Args>
+  Function* make_node(Args&&... args);
+  // Destroy nodes from..nodes.size()-1 and remove them from the graph
+  void destroy_nodes(VariableIndex from);
   void set_dim_for_new_node(const VariableIndex& i);
+  void register_graph();
 
   std::vector<CGCheckpoint> checkpoints;
-  CGCheckpoint _get_checkpoint();
+  CGCheckpoint _get_checkpoint(bool evaluate = true);
   void _revert(CGCheckpoint checkpoint);
 };
 
@@ -602,7 +837,8 @@ struct Node {
    * backward pass. Some implementation remarks from nodes.cc:
    * 1. dEdxi MUST **ACCUMULATE** a result since multiple calls to forward may
    * depend on the same x_i. Even, e.g., Identity must be implemented as dEdx1
-   * += dEdf. THIS IS EXTREMELY IMPORTANT
+   * += dEdf. THIS IS EXTREMELY IMPORTANT. The only exception are nodes that
+   * supports_backward_assign(), which overwrite dEdxi when backward_assigns().
    * 2. scalars results of forward are placed in fx.v[0]
    * 3. DYNET manages its own memory, not Eigen, and it is configured with the
    * EIGEN_NO_MALLOC option. If you get an error about Eigen attempting to
@@ -663,6 +899,22 @@ struct Node {
   virtual void backward(const std::vector<const Tensor*>& xs, const Tensor& fx,
                         const Tensor& dEdf, unsigned i,
                         Tensor& dEdxi) const final;
+  /**
+   * \brief perform the backward pass, overwriting dEdxi instead of
+   * accumulating into it
+   * \details The execution engines use this for the first gradient passed to
+   * an argument, so that its memory doesn't have to be zeroed beforehand.
+   * Only valid for nodes that supports_backward_assign().
+   */
+  void backward_assign(const std::vector<const Tensor*>& xs, const Tensor& fx,
+                       const Tensor& dEdf, unsigned i, Tensor& dEdxi) const;
+  /**
+   * \brief Whether backward_impl() can overwrite dEdxi
+   * \details Nodes returning true have to check backward_assigns() in
+   * backward_impl(), and overwrite dEdxi when it is true.
+   * \return Support for backward_assign()
+   */
+  virtual bool supports_backward_assign() const { return false; }
 
   /**
    * \brief signature for automatic batching
@@ -735,7 +987,7 @@ struct Node {
       return NULL;
   }
 
-  std::vector<VariableIndex> args; /**< Dependency structure */
+  NodeArgs args; /**< Dependency structure */
 
   // memory size
   Dim dim; /**< Will be .size() = 0 initially filled in by forward() -- TODO fix
@@ -755,6 +1007,10 @@ struct Node {
   inline bool inplaced() const { return forward_inplaced() || backward_inplaced(); }
 
  protected:
+  // Whether the current call of backward_impl() on this thread has to
+  // overwrite dEdxi rather than add to it (see backward_assign())
+  static bool backward_assigns();
+
   Node() : args(), device(nullptr) {}
   explicit Node(const std::initializer_list<VariableIndex>& a)
       : args(a), device(nullptr) {}
@@ -776,15 +1032,22 @@ struct Node {
                             depending on your computation backend*/
   bool has_cuda_implemented = true;
 };
+template <class Function, typename... Args>
+inline Function* ComputationGraph::make_node(Args&&... args) {
+  static_assert(alignof(Function) <= alignof(std::max_align_t),
+                "Node types must not be over-aligned");
+  return new (node_arena.allocate(sizeof(Function))) Function(std::forward<Args>(args)...);
+}
+
 template <class Function>
 inline VariableIndex ComputationGraph::add_function(
 	const std::initializer_list<VariableIndex>& arguments) {
-	return add_function_node(new Function(arguments));
+	return add_function_node(make_node<Function>(arguments));
 }
 template <class Function>
 inline VariableIndex ComputationGraph::add_function(Device *device,
     const std::initializer_list<VariableIndex>& arguments) {
-  return add_function_node(new Function(arguments), device);
+  return add_function_node(make_node<Function>(arguments), device);
 }
 
 // pass side information to the function. these are likely to be
@@ -794,23 +1057,23 @@ inline VariableIndex ComputationGraph::add_function(
     const std::initializer_list<VariableIndex>& arguments,
     Args&&... side_information) {
 	return add_function_node(
-		new Function(arguments, std::forward<Args>(side_information)...));
+		make_node<Function>(arguments, std::forward<Args>(side_information)...));
 }
 template <class Function, typename... Args>
 inline VariableIndex ComputationGraph::add_function(Device *device,
 	const std::initializer_list<VariableIndex>& arguments,
 	Args&&... side_information) {
 	return add_function_node(
-		new Function(arguments, std::forward<Args>(side_information)...), device);
+		make_node<Function>(arguments, std::forward<Args>(side_information)...), device);
 }
 
 template <class Function, typename T>
 inline VariableIndex ComputationGraph::add_function(const T& arguments) {
-  return add_function_node(new Function(arguments));
+  return add_function_node(make_node<Function>(arguments));
 }
 template <class Function, typename T>
 inline VariableIndex ComputationGraph::add_function(Device *device, const T& arguments) {
-	return add_function_node(new Function(arguments), device);
+	return add_function_node(make_node<Function>(arguments), device);
 }
 
 // pass side information to the function. these are likely to be
@@ -819,7 +1082,7 @@ template <class Function, typename T, typename... Args>
 inline VariableIndex ComputationGraph::add_function(
     const T& arguments, Args&&... side_information) {
 	return add_function_node(
-		new Function(arguments, std::forward<Args>(side_information)...));
+		make_node<Function>(arguments, std::forward<Args>(side_information)...));
 }
 // pass side information to the function. these are likely to be
 // nondifferentiable arguments
@@ -827,7 +1090,7 @@ template <class Function, typename T, typename... Args>
 inline VariableIndex ComputationGraph::add_function(Device *device,
 	const T& arguments, Args&&... side_information) {
 	return add_function_node(
-		new Function(arguments, std::forward<Args>(side_information)...), device);
+		make_node<Function>(arguments, std::forward<Args>(side_information)...), device);
 }
 
 }  // namespace dynet
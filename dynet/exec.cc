@@ -2,11 +2,20 @@
 
 #include <unordered_map>
 #include <queue>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #include "dynet/param-nodes.h"
+#include "dynet/nodes-fused.h"
 #include "dynet/globals.h"
 #include "dynet/timing.h"
+#include "dynet/profiler.h"
 #include "dynet/devices.h"
+#include "dynet/thread-pool.h"
 
 #ifdef HAVE_CUDA
 #include "dynet/gpu-ops.h"
@@ -16,6 +25,158 @@ using namespace std;
 
 namespace dynet {
 
+// Below this many nodes, the cost of scheduling outweighs any parallelism
+static const unsigned kMinParallelNodes = 16;
+
+// The thread pool shared by all parallel executions, along with a private
+// scratch pool per (worker, device). Scratch pools are not thread-safe, so
+// workers other than worker 0 (the calling thread) are redirected to their own.
+// Each worker also has a pool for temporaries that the engine itself needs.
+struct ParallelContext {
+  explicit ParallelContext(unsigned num_workers) : pool(num_workers), scratch(num_workers) {
+    for (unsigned w = 0; w < num_workers; ++w)
+      temp.push_back(new AlignedMemoryPool("CPU worker temporary memory", 1 << 20, &cpu_mem));
+  }
+  ~ParallelContext() {
+    for (auto & ps : scratch)
+      for (auto p : ps) delete p;
+    for (auto p : temp) delete p;
+  }
+  ThreadPool pool;
+  CPUAllocator cpu_mem;
+  std::vector<std::vector<AlignedMemoryPool*>> scratch;
+  std::vector<AlignedMemoryPool*> temp;
+};
+
+static std::mutex parallel_mutex;
+static std::unique_ptr<ParallelContext> parallel_context;
+
+// Run run_node(worker, j) for all j in [0, n) on the shared thread pool. Node j
+// may start once num_deps[j] of its predecessors have finished; the successors
+// of j are succs[succ_offsets[j] ... succ_offsets[j+1]-1].
+static void run_dag_parallel(unsigned n,
+                             const vector<unsigned>& num_deps,
+                             const vector<unsigned>& succ_offsets,
+                             const vector<unsigned>& succs,
+                             const std::function<void(unsigned, unsigned)>& run_node) {
+  std::lock_guard<std::mutex> lk(parallel_mutex);
+  const unsigned num_workers = (unsigned)exec_threads_flag;
+  if (!parallel_context || parallel_context->pool.num_workers() != num_workers)
+    parallel_context.reset(new ParallelContext(num_workers));
+  ThreadPool& pool = parallel_context->pool;
+  const vector<Device*>& devices = get_device_manager()->get_devices();
+  for (unsigned w = 1; w < num_workers; ++w) {
+    auto & ps = parallel_context->scratch[w];
+    for (size_t d = ps.size(); d < devices.size(); ++d) {
+      AlignedMemoryPool* scs = devices[d]->pools[(int)DeviceMempool::SCS];
+      ps.push_back(new AlignedMemoryPool("CPU worker scratch memory",
+                                         std::min(scs->get_cap(), (size_t)1 << 24),
+                                         &parallel_context->cpu_mem));
+    }
+  }
+
+  std::unique_ptr<std::atomic<unsigned>[]> remaining(new std::atomic<unsigned>[n]);
+  for (unsigned j = 0; j < n; ++j) remaining[j].store(num_deps[j]);
+  // Each task runs its node and then keeps going with the first successor it
+  // makes ready, so that chains stay on one thread without scheduling overhead.
+  std::function<void(unsigned, unsigned)> run_chain = [&](unsigned w, unsigned j) {
+    std::vector<std::unique_ptr<ScopedPoolRedirect>> redirects;
+    if (w > 0)
+      for (size_t d = 0; d < devices.size(); ++d)
+        redirects.emplace_back(new ScopedPoolRedirect(
+            devices[d]->pools[(int)DeviceMempool::SCS], parallel_context->scratch[w][d]));
+    while (true) {
+      run_node(w, j);
+      unsigned next = n;
+      for (unsigned k = succ_offsets[j]; k < succ_offsets[j+1]; ++k) {
+        unsigned s = succs[k];
+        if (remaining[s].fetch_sub(1) == 1) {
+          if (next == n) next = s;
+          else pool.submit([&run_chain, s](unsigned w2) { run_chain(w2, s); });
+        }
+      }
+      if (next == n) break;
+      j = next;
+    }
+  };
+  for (unsigned j = 0; j < n; ++j)
+    if (num_deps[j] == 0)
+      pool.submit([&run_chain, j](unsigned w) { run_chain(w, j); });
+  pool.wait();
+}
+
+// Parallel execution is only used for CPU devices
+static bool can_run_parallel(size_t num_tasks, size_t min_tasks = kMinParallelNodes) {
+  if (exec_threads_flag <= 1 || num_tasks < min_tasks)
+    return false;
+  for (auto dev : get_device_manager()->get_devices())
+    if (dev->type != DeviceType::CPU) return false;
+  return true;
+}
+
+// Gradients flowing into the same tensor are serialized by a lock picked from
+// a fixed number of stripes.
+static const unsigned kNumGradLocks = 64;
+
+// Accumulate the gradients of the given parameter nodes into their storage.
+// Nodes sharing a storage (e.g. several lookups into one table) are handled by
+// the same task, so ParameterStorage::g and LookupParameterStorage::grads are
+// never updated by two threads at once.
+static void accumulate_parameter_grads(const ComputationGraph& cg,
+                                       const vector<VariableIndex>& pnodes,
+                                       const vector<Tensor>& ndEdfs) {
+  unordered_map<ParameterStorageBase*, unsigned> storage2group;
+  vector<vector<VariableIndex>> groups;
+  for (VariableIndex i : pnodes) {
+    ParameterStorageBase* storage = static_cast<ParameterNodeBase*>(cg.nodes[i])->get_storage();
+    auto it = storage2group.find(storage);
+    if (it == storage2group.end()) {
+      it = storage2group.insert(make_pair(storage, (unsigned)groups.size())).first;
+      groups.push_back(vector<VariableIndex>());
+    }
+    groups[it->second].push_back(i);
+  }
+  auto accumulate_group = [&](unsigned w, unsigned g) {
+    for (VariableIndex i : groups[g])
+      static_cast<ParameterNodeBase*>(cg.nodes[i])->accumulate_grad(ndEdfs[i]);
+  };
+  if (can_run_parallel(groups.size(), 2)) {
+    vector<unsigned> num_deps(groups.size(), 0), succ_offsets(groups.size() + 1, 0), succs;
+    run_dag_parallel(groups.size(), num_deps, succ_offsets, succs, accumulate_group);
+  } else {
+    for (unsigned g = 0; g < groups.size(); ++g)
+      accumulate_group(0, g);
+  }
+}
+
+void AutobatchStats::clear() {
+  forward_calls = cached_plans = 0;
+  plan_ms = 0;
+  nodes = batches = unbatchable_nodes = 0;
+  batch_sizes.clear();
+  signatures.clear();
+  combine_bytes = accumulate_bytes = 0;
+}
+
+ostream& operator<<(ostream& os, const AutobatchStats& stats) {
+  const double mb = 1024.0 * 1024.0;
+  os << "forward calls: " << stats.forward_calls << " (" << stats.cached_plans
+     << " with a cached schedule), planning time: " << stats.plan_ms << " ms\n"
+     << "nodes: " << stats.nodes << " in " << stats.batches << " batches (mean size "
+     << stats.mean_batch_size() << "), " << stats.unbatchable_nodes << " cannot be batched\n"
+     << "batch sizes:";
+  for (size_t n = 1; n < stats.batch_sizes.size(); ++n)
+    if (stats.batch_sizes[n]) os << ' ' << n << 'x' << stats.batch_sizes[n];
+  os << "\ncopied: " << stats.combine_bytes / mb << " MB of batch arguments, "
+     << stats.accumulate_bytes / mb << " MB of batch gradients\n";
+  for (auto & item : stats.signatures) {
+    const AutobatchStats::Signature& sig = item.second;
+    os << "  sig " << item.first << ' ' << sig.op << ' ' << sig.dim << ": "
+       << sig.nodes << " nodes in " << sig.batches << " batches\n";
+  }
+  return os;
+}
+
 ExecutionEngine::ExecutionEngine(const ComputationGraph& cg)
     : device_manager(get_device_manager()), cg(cg), backward_computed(0) {}
 
@@ -40,7 +201,12 @@ void SimpleExecutionEngine::invalidate() {
 }
 
 void SimpleExecutionEngine::invalidate(unsigned i) {
-  num_nodes_evaluated = i;
+  // Freed values can only be recovered by starting over, and so can values
+  // fused into nodes from i on
+  if (cg.is_inference_mode() || cg.is_remat_mode() || !absorbed.empty())
+    invalidate();
+  else
+    num_nodes_evaluated = std::min(num_nodes_evaluated, (VariableIndex)i);
 }
 
 const Tensor& SimpleExecutionEngine::forward() {
@@ -49,16 +215,42 @@ const Tensor& SimpleExecutionEngine::forward() {
 }
 
 const Tensor& SimpleExecutionEngine::forward(VariableIndex i) {
+  if (cg.is_frozen() && i < num_nodes_evaluated) {
+    // every evaluated node is replayed, since any of them may be read next
+    replay();
+    return nfxs[i];
+  }
   invalidate();
   return incremental_forward(i);
 }
 
+void SimpleExecutionEngine::replay() {
+  vector<const Tensor*> xs(16);  // Container for arguments to nodes (reused).
+  for (VariableIndex i = 0; i < num_nodes_evaluated; ++i) {
+    const Node* node = exec_node(i);
+    // inplaced nodes share the memory of their argument, and fused away
+    // nodes have none
+    if (node->forward_inplaced() || nfxs[i].v == nullptr) continue;
+    ProfileScope prof(ProfileKind::FORWARD, node, nfxs[i].d);
+    xs.resize(node->arity());
+    unsigned ai = 0;
+    for (VariableIndex arg : node->args)
+      xs[ai++] = &nfxs[arg];
+    node->forward(xs, nfxs[i]);
+  }
+  backward_computed = 0;
+}
+
 const Tensor& SimpleExecutionEngine::get_value(VariableIndex i) {
   DYNET_ASSERT(i < cg.nodes.size(),
       "Out-of-bounds variable access in SimpleExecutionEngine::get_value()");
   if (i >= num_nodes_evaluated) {
     incremental_forward(i);
   }
+  if (i < absorbed.size() && absorbed[i])
+    materialize(i);
+  check_not_released(i);
+  if (i < requested.size()) requested[i] = true;
   return nfxs[i];
 }
 
@@ -73,9 +265,41 @@ const Tensor& SimpleExecutionEngine::get_gradient(VariableIndex i) {
   if(cg.nodes[i]->backward_inplaced()){
     DYNET_RUNTIME_ERR("This operation is an inplaced operation, thus no valid gradient");
   }
+  if (i < fused_away.size() && fused_away[i])
+    DYNET_RUNTIME_ERR("Node " << i << " was fused with the nodes using it, so it has no gradient");
+  zero_unset_gradient(i);
   return ndEdfs[i];
 }
 
+void SimpleExecutionEngine::zero_unset_gradient(VariableIndex i) {
+  char& ready = grad_ready[grad_root[i]];
+  if (!ready) {
+    TensorTools::zero(ndEdfs[grad_root[i]]);
+    ready = 1;
+  }
+}
+
+void SimpleExecutionEngine::backward_arg(const Node* node,
+                                         const vector<const Tensor*>& xs,
+                                         VariableIndex i, unsigned ai) {
+  const auto& node_fx = nfxs[i];
+  const auto& node_dEdfx = ndEdfs[i];
+  auto& node_dEdxai = ndEdfs[node->args[ai]];  // where to store dE/dx_{ai}.
+  DYNET_ASSERT(node_fx.device == node_dEdfx.device &&
+               node_fx.device == node_dEdxai.device,
+               "Attempt to do tensor backward in different devices");
+  char& ready = grad_ready[grad_root[node->args[ai]]];
+  if (ready) {
+    node->backward(xs, node_fx, node_dEdfx, ai, node_dEdxai);
+  } else if (node->supports_backward_assign()) {
+    node->backward_assign(xs, node_fx, node_dEdfx, ai, node_dEdxai);
+    ready = 1;
+  } else {
+    zero_unset_gradient(node->args[ai]);
+    node->backward(xs, node_fx, node_dEdfx, ai, node_dEdxai);
+  }
+}
+
 const Tensor& SimpleExecutionEngine::incremental_forward() {
   const VariableIndex node_max_index = (VariableIndex)(cg.nodes.size() - 1);
   return incremental_forward(node_max_index);
@@ -87,74 +311,392 @@ const Tensor& SimpleExecutionEngine::incremental_forward(VariableIndex i) {
     "SimpleExecutionEngine::incremental_forward()");
 
   // free any old memory if this is a new CG
-  if (num_nodes_evaluated == 0)
+  if (num_nodes_evaluated == 0) {
     for (Device* dev : device_manager->get_devices())
       dev->pools[(int)DeviceMempool::FXS]->free();
+    free_lists.clear();
+    pending_uses.clear(); mem_root.clear(); live_sharers.clear();
+    released.clear(); requested.clear(); recomputed.clear();
+    num_nodes_counted = 0;
+    fused.clear(); absorbed.clear(); fused_away.clear();
+  }
 
   if (i >= num_nodes_evaluated) {
     nfxs.resize(i + 1);
-    string current_node_name;  // Optionally used for debugging (reused).
+    // nodes added since the last evaluation may use values that were fused
+    // away
+    if (!absorbed.empty())
+      for (VariableIndex j = num_nodes_evaluated; j <= i; ++j)
+        for (VariableIndex arg : cg.nodes[j]->args)
+          if (arg < absorbed.size() && absorbed[arg])
+            materialize(arg);
+    if (cg.is_inference_mode() || cg.is_remat_mode()) {
+      liveness_forward(i);
+      return nfxs[i];
+    }
+    if (can_run_parallel(i + 1 - num_nodes_evaluated)) {
+      parallel_forward(i);
+      return nfxs[i];
+    }
+    if (fusion_flag)
+      plan_fusion(i);
     vector<const Tensor*> xs(16);  // Container for arguments to nodes (reused).
 
     for (; num_nodes_evaluated <= i; ++num_nodes_evaluated) {
-      const Node* node = cg.nodes[num_nodes_evaluated];
-      if (profiling_flag) {
-        current_node_name = "FWD " + node->as_dummy_string();
-        timer.start(current_node_name);
+      if (num_nodes_evaluated < absorbed.size() && absorbed[num_nodes_evaluated]) {
+        // computed as part of the node using it
+        Tensor& node_fx = nfxs[num_nodes_evaluated];
+        node_fx.d = cg.nodes[num_nodes_evaluated]->dim;
+        node_fx.device = cg.nodes[num_nodes_evaluated]->device;
+        node_fx.mem_pool = DeviceMempool::FXS;
+        node_fx.v = nullptr;
+        continue;
+      }
+      const Node* node = exec_node(num_nodes_evaluated);
+      ProfileScope prof(ProfileKind::FORWARD, node, node->dim);
+      allocate_forward_memory(num_nodes_evaluated);
+      // If inplaced operation, memory is shared so don't call forward
+      if(!node->forward_inplaced()) {
+        xs.resize(node->arity());
+        unsigned ai = 0;
+        for (VariableIndex arg : node->args)
+          xs[ai++] = &nfxs[arg];
+        // Compute f(xs) and store to node_fx.
+        node->forward(xs, nfxs[num_nodes_evaluated]);
       }
+    }
+  }
+
+  check_not_released(i);
+  // in inference/remat mode, values handed out to the user are kept
+  if (i < requested.size()) requested[i] = true;
+  return nfxs[i];
+}
+
+void SimpleExecutionEngine::allocate_forward_memory(VariableIndex i) {
+  const Node* node = cg.nodes[i];
+  for (VariableIndex arg : node->args) {
+    DYNET_ARG_CHECK(nfxs[arg].device == node->device ||
+        node->supports_multidevice(),
+        "Attempt to do tensor forward in different devices (nodes " <<
+        arg << " and " << i << ")");
+  }
+  auto& node_fx = nfxs[i];
+  node_fx.d = node->dim;
+  // Get the device
+  DYNET_ASSERT(node->device != nullptr,
+      "Attempt to access null device in "
+      "SimpleExecutionEngine::incremental_forward");
+  node_fx.device = node->device;
+  node_fx.mem_pool = DeviceMempool::FXS;
+  // If inplaced operation reuse (share) memory
+  if(node->forward_inplaced()) {
+    DYNET_ASSERT(node->args.size() == 1,
+                 "Inplacing only supported for arity-1 nodes");
+    node_fx.v = nfxs[node->args[0]].v;
+  } else {
+    node_fx.v = static_cast<float*>(
+      allocate_fx(node_fx.device, node->dim.size() * sizeof(float)));
+    if (node_fx.v == nullptr) {
+      DYNET_RUNTIME_ERR("Ran out of memory when executing node " <<
+                        i << ", allocating FWD memory.");
+    }
+    void* aux_mem = nullptr;
+    // Is the node requesting extra memory?
+    size_t aux_size = node->aux_storage_size();
+    if (aux_size) {
+      aux_mem = allocate_fx(node_fx.device, aux_size);
+      if (aux_mem == nullptr)
+        DYNET_RUNTIME_ERR("Ran out of auxiliary memory when executing node "
+                          << i);
+    }
+    node->aux_mem = aux_mem;
+  }
+}
+
+void* SimpleExecutionEngine::allocate_fx(Device* device, size_t n) {
+  // free lists only exist in inference/remat mode
+  if (!free_lists.empty())
+    return free_lists[device->device_id]->allocate(n);
+  return device->pools[(int)DeviceMempool::FXS]->allocate(n);
+}
+
+void SimpleExecutionEngine::liveness_forward(VariableIndex upto) {
+  const vector<Device*>& devices = device_manager->get_devices();
+  if (free_lists.empty()) {
+    free_lists.resize(devices.size());
+    for (Device* dev : devices) {
+      DYNET_ASSERT(dev->device_id < (int)devices.size(), "Bad device id in SimpleExecutionEngine::liveness_forward");
+      free_lists[dev->device_id].reset(new PoolFreeList(dev->pools[(int)DeviceMempool::FXS]));
+    }
+  }
+
+  // Liveness: count the consumers of every node, including the ones added
+  // since the last call that have not been computed yet.
+  const VariableIndex num_nodes = cg.nodes.size();
+  pending_uses.resize(num_nodes, 0);
+  mem_root.resize(num_nodes);
+  live_sharers.resize(num_nodes, 0);
+  released.resize(num_nodes, false);
+  requested.resize(num_nodes, false);
+  recomputed.resize(num_nodes, false);
+  checkpoint_stride = 0;
+  if (cg.is_remat_mode() && !cg.has_retained())
+    checkpoint_stride = (unsigned)ceil(sqrt((double)num_nodes));
+  for (; num_nodes_counted < num_nodes; ++num_nodes_counted)
+    for (VariableIndex arg : cg.nodes[num_nodes_counted]->args)
+      ++pending_uses[arg];
+  requested[upto] = true;
+
+  vector<const Tensor*> xs(16);  // Container for arguments to nodes (reused).
+  for (; num_nodes_evaluated <= upto; ++num_nodes_evaluated) {
+    const VariableIndex j = num_nodes_evaluated;
+    const Node* node = cg.nodes[j];
+    ProfileScope prof(ProfileKind::FORWARD, node, node->dim);
+    for (VariableIndex arg : node->args)
+      if (released[arg])
+        DYNET_RUNTIME_ERR("Node " << j << " uses the value of node " << arg
+                          << ", which was already freed. "
+                          "Use ComputationGraph::retain() on values that are "
+                          "used again by nodes added later.");
+    allocate_forward_memory(j);
+    if (!node->forward_inplaced()) {
       xs.resize(node->arity());
       unsigned ai = 0;
-      for (VariableIndex arg : node->args) {
-        xs[ai] = &nfxs[arg];
-        DYNET_ARG_CHECK(xs[ai]->device == node->device ||
-            node->supports_multidevice(),
-            "Attempt to do tensor forward in different devices (nodes " <<
-            arg << " and " << num_nodes_evaluated << ")");
-        ++ai;
+      for (VariableIndex arg : node->args)
+        xs[ai++] = &nfxs[arg];
+      node->forward(xs, nfxs[j]);
+      // auxiliary memory is only kept around for the backward pass
+      if (node->aux_mem != nullptr && cg.is_inference_mode()) {
+        free_lists[node->device->device_id]->release(node->aux_mem, node->aux_storage_size());
+        node->aux_mem = nullptr;
       }
-      auto& node_fx = nfxs[num_nodes_evaluated];
-      node_fx.d = node->dim;
-      // Get the device
-      DYNET_ASSERT(node->device != nullptr,
-          "Attempt to access null device in "
-          "SimpleExecutionEngine::incremental_forward");
-      node_fx.device = node->device;
-      node_fx.mem_pool = DeviceMempool::FXS;
-      // Get the memory to store f(xs)
-      auto& node_fx_pools = node_fx.device->pools;
-      // If inplaced operation reuse (share) memory and don't call forward
-      if(node->forward_inplaced()) {
-        DYNET_ASSERT(node->args.size() == 1,
-                     "Inplacing only supported for arity-1 nodes");
-        node_fx.v = nfxs[node->args[0]].v;
-      } else {
-        node_fx.v = static_cast<float*>(
-          node_fx_pools[(int)DeviceMempool::FXS]->allocate(
-              node->dim.size() * sizeof(float)));
-        if (node_fx.v == nullptr) {
-          DYNET_RUNTIME_ERR("Ran out of memory when executing node " <<
-                            num_nodes_evaluated << ", allocating FWD memory.");
-        }
-        void* aux_mem = nullptr;
-        // Is the node requesting extra memory?
-        size_t aux_size = node->aux_storage_size();
-        if (aux_size) {
-          aux_mem = node_fx_pools[(int)DeviceMempool::FXS]->allocate(aux_size);
-          if (aux_mem == nullptr)
-            DYNET_RUNTIME_ERR("Ran out of auxiliary memory when executing node "
-                              << num_nodes_evaluated);
-        }
-        node->aux_mem = aux_mem;
+    }
+    mem_root[j] = node->forward_inplaced() ? mem_root[node->args[0]] : j;
+    ++live_sharers[mem_root[j]];
+    for (VariableIndex arg : node->args)
+      if (--pending_uses[arg] == 0)
+        release_value(arg);
+  }
+}
 
-        // Compute f(xs) and store to node_fx.
-        node->forward(xs, node_fx);
+void SimpleExecutionEngine::release_value(VariableIndex i) {
+  // Leaves (parameters, inputs, constants) are typically reused by every step
+  // of an incrementally built graph, so they are never freed
+  const Node* node = cg.nodes[i];
+  if (released[i] || requested[i] || cg.is_retained(i) || node->arity() == 0)
+    return;
+  if (cg.is_remat_mode()) {
+    // recomputing a node would overwrite its auxiliary storage (e.g. resample
+    // a dropout mask), so such nodes serve as checkpoints
+    if (node->aux_storage_size() > 0 ||
+        (checkpoint_stride > 0 && i % checkpoint_stride == 0))
+      return;
+  }
+  free_value(i);
+}
+
+void SimpleExecutionEngine::free_value(VariableIndex i) {
+  released[i] = true;
+  const VariableIndex root = mem_root[i];
+  if (--live_sharers[root] == 0) {
+    const Tensor& fx = nfxs[root];
+    free_lists[fx.device->device_id]->release(fx.v, fx.d.size() * sizeof(float));
+  }
+}
+
+void SimpleExecutionEngine::check_not_released(VariableIndex i) const {
+  if (i < released.size() && released[i])
+    DYNET_RUNTIME_ERR("The value of node " << i << " was freed in inference/remat mode. "
+                      "Use ComputationGraph::retain() on values that are "
+                      "accessed after their consumers have been computed.");
+}
+
+void SimpleExecutionEngine::rematerialize(VariableIndex i) {
+  vector<VariableIndex> todo(1, i);
+  vector<const Tensor*> xs(16);
+  while (!todo.empty()) {
+    const VariableIndex j = todo.back();
+    if (!released[j]) { todo.pop_back(); continue; }
+    const Node* node = cg.nodes[j];
+    bool ready = true;
+    for (VariableIndex arg : node->args) {
+      if (released[arg]) {
+        todo.push_back(arg);
+        ready = false;
+      }
+    }
+    if (!ready) continue;
+    todo.pop_back();
+    allocate_forward_memory(j);
+    if (!node->forward_inplaced()) {
+      ProfileScope prof(ProfileKind::FORWARD, node, node->dim);
+      xs.resize(node->arity());
+      unsigned ai = 0;
+      for (VariableIndex arg : node->args)
+        xs[ai++] = &nfxs[arg];
+      node->forward(xs, nfxs[j]);
+    }
+    released[j] = false;
+    recomputed[j] = true;
+    ++live_sharers[mem_root[j]];
+  }
+}
+
+void SimpleExecutionEngine::plan_fusion(VariableIndex upto) {
+  const VariableIndex from = num_nodes_evaluated;
+  const unsigned n = upto - from + 1;
+  // Count the consumers of the nodes to evaluate among all nodes of the graph
+  vector<unsigned> uses(n, 0);
+  vector<VariableIndex> consumer(n, 0);
+  for (VariableIndex j = from; j < cg.nodes.size(); ++j) {
+    for (VariableIndex arg : cg.nodes[j]->args) {
+      if (arg >= from && arg <= upto) {
+        ++uses[arg - from];
+        consumer[arg - from] = j;
+      }
+    }
+  }
+  // Fusible nodes compute an elementwise function of arguments of their own
+  // dimension, on the CPU
+  vector<bool> fusible(n, false);
+  for (VariableIndex j = from; j <= upto; ++j) {
+    const Node* node = cg.nodes[j];
+    if (node->device->type != DeviceType::CPU || !FusedElementwise::fusible_arity(node))
+      continue;
+    bool same_dims = true;
+    for (VariableIndex arg : node->args)
+      same_dims = same_dims && cg.nodes[arg]->dim == node->dim;
+    fusible[j - from] = same_dims;
+  }
+  // A fusible node is computed inside its consumer if that is its only one
+  // and is fusible too, unless the value was asked for
+  fused.resize(upto + 1);
+  absorbed.resize(upto + 1, false);
+  fused_away.resize(upto + 1, false);
+  for (VariableIndex j = from; j <= upto; ++j) {
+    fused[j].reset();
+    const VariableIndex c = consumer[j - from];
+    absorbed[j] = j < upto && fusible[j - from] && uses[j - from] == 1 &&
+                  c <= upto && fusible[c - from] && !cg.is_retained(j);
+    fused_away[j] = absorbed[j];
+  }
+  // The last node of each chain is replaced by a node computing all of it
+  vector<VariableIndex> members, externals, todo;
+  vector<unsigned> operand(n);
+  for (VariableIndex r = from; r <= upto; ++r) {
+    if (!fusible[r - from] || absorbed[r]) continue;
+    members.clear(); externals.clear();
+    todo.assign(1, r);
+    while (!todo.empty()) {
+      const VariableIndex j = todo.back();
+      todo.pop_back();
+      members.push_back(j);
+      for (VariableIndex arg : cg.nodes[j]->args)
+        if (arg >= from && absorbed[arg])
+          todo.push_back(arg);
+    }
+    if (members.size() == 1) continue;
+    // nodes are in topological order, and so are the operations
+    sort(members.begin(), members.end());
+    for (VariableIndex j : members) {
+      for (VariableIndex arg : cg.nodes[j]->args) {
+        if ((arg < from || !absorbed[arg]) &&
+            find(externals.begin(), externals.end(), arg) == externals.end())
+          externals.push_back(arg);
       }
+    }
+    for (unsigned k = 0; k < members.size(); ++k)
+      operand[members[k] - from] = externals.size() + k;
+    auto operand_of = [&](VariableIndex arg) -> unsigned {
+      if (arg >= from && absorbed[arg]) return operand[arg - from];
+      return find(externals.begin(), externals.end(), arg) - externals.begin();
+    };
+    vector<FusedElementwise::Op> ops;
+    for (VariableIndex j : members) {
+      const Node* node = cg.nodes[j];
+      const unsigned a = operand_of(node->args[0]);
+      const unsigned b = node->arity() > 1 ? operand_of(node->args[1]) : 0;
+      FusedElementwise::append_op(node, a, b, ops);
+    }
+    const Node* root = cg.nodes[r];
+    FusedElementwise* node = new FusedElementwise(externals, ops);
+    node->dim = root->dim;
+    node->device = root->device;
+    node->aux_mem = nullptr;
+    node->set_cg(root->get_cg());
+    fused[r].reset(node);
+  }
+}
 
-      if (profiling_flag) { timer.stop(current_node_name); }
+void SimpleExecutionEngine::materialize(VariableIndex i) {
+  vector<VariableIndex> todo(1, i);
+  vector<const Tensor*> xs(16);
+  while (!todo.empty()) {
+    const VariableIndex j = todo.back();
+    if (!absorbed[j]) { todo.pop_back(); continue; }
+    const Node* node = cg.nodes[j];
+    bool ready = true;
+    for (VariableIndex arg : node->args) {
+      if (arg < absorbed.size() && absorbed[arg]) {
+        todo.push_back(arg);
+        ready = false;
+      }
     }
+    if (!ready) continue;
+    todo.pop_back();
+    allocate_forward_memory(j);
+    xs.resize(node->arity());
+    unsigned ai = 0;
+    for (VariableIndex arg : node->args)
+      xs[ai++] = &nfxs[arg];
+    node->forward(xs, nfxs[j]);
+    absorbed[j] = false;
   }
+}
 
-  return nfxs[i];
+void SimpleExecutionEngine::parallel_forward(VariableIndex upto) {
+  const VariableIndex from = num_nodes_evaluated;
+  const unsigned n = upto - from + 1;
+  // Memory pools are not thread-safe, so all memory is allocated up front, in
+  // the same order (and hence with the same layout) as sequential execution.
+  for (VariableIndex j = from; j <= upto; ++j)
+    allocate_forward_memory(j);
+
+  // Node readiness: count the arguments of each node that still have to be
+  // computed, and record the reverse edges.
+  vector<unsigned> num_deps(n, 0), succ_offsets(n + 1, 0), succs;
+  for (VariableIndex j = from; j <= upto; ++j) {
+    for (VariableIndex arg : cg.nodes[j]->args) {
+      if (arg >= from) {
+        ++num_deps[j - from];
+        ++succ_offsets[arg - from + 1];
+      }
+    }
+  }
+  for (unsigned j = 0; j < n; ++j)
+    succ_offsets[j + 1] += succ_offsets[j];
+  succs.resize(succ_offsets[n]);
+  vector<unsigned> cursor(succ_offsets.begin(), succ_offsets.end() - 1);
+  for (VariableIndex j = from; j <= upto; ++j)
+    for (VariableIndex arg : cg.nodes[j]->args)
+      if (arg >= from)
+        succs[cursor[arg - from]++] = j - from;
+
+  vector<vector<const Tensor*>> worker_xs(exec_threads_flag);
+  run_dag_parallel(n, num_deps, succ_offsets, succs,
+    [&](unsigned w, unsigned j) {
+      const Node* node = cg.nodes[from + j];
+      if (node->forward_inplaced()) return;
+      ProfileScope prof(ProfileKind::FORWARD, node, node->dim);
+      auto& xs = worker_xs[w];
+      xs.resize(node->arity());
+      unsigned ai = 0;
+      for (VariableIndex arg : node->args)
+        xs[ai++] = &nfxs[arg];
+      node->forward(xs, nfxs[from + j]);
+    });
+  num_nodes_evaluated = upto + 1;
 }
 
 void SimpleExecutionEngine::backward(bool full) {
@@ -173,6 +715,8 @@ void SimpleExecutionEngine::backward(VariableIndex from_where, bool full) {
 
   const unsigned num_nodes = from_where + 1;
   ndEdfs.resize(num_nodes);
+  grad_root.resize(num_nodes);
+  grad_ready.assign(num_nodes, 0);
   const vector<Device*> &devices = device_manager->get_devices();
   for(Device* device : devices)
     device->pools[(int)DeviceMempool::DEDFS]->free();
@@ -186,12 +730,17 @@ void SimpleExecutionEngine::backward(VariableIndex from_where, bool full) {
     node_dEdfx.device = nfxs[i].device;
     node_dEdfx.mem_pool = DeviceMempool::DEDFS;
     const Node* node = cg.nodes[i];
+    grad_root[i] = i;
     // If the operation is inplaced, re-use memory
-    if(node->backward_inplaced()) {
+    if (i < absorbed.size() && absorbed[i]) {
+      // fused nodes pass gradients straight to the arguments of the chain
+      node_dEdfx.v = nullptr;
+    } else if(node->backward_inplaced()) {
       // cerr << node->as_dummy_string() << ", node->args.size() == " << node->args.size() << endl;
       DYNET_ASSERT(node->args.size() == 1,
                    "Inplacing only supported for arity-1 nodes");
       node_dEdfx.v = ndEdfs[node->args[0]].v;
+      grad_root[i] = grad_root[node->args[0]];
     } else {
       node_dEdfx.v = static_cast<float*>(
           node_dEdfx.device->pools[(int)DeviceMempool::DEDFS]->allocate(
@@ -203,12 +752,14 @@ void SimpleExecutionEngine::backward(VariableIndex from_where, bool full) {
       }
     }
   }
-  // Zero all derivative memory (which is contiguous on each device)
-  for (Device* device : devices)
-    device->pools[(int)DeviceMempool::DEDFS]->zero_allocated_memory();
+  // Rather than zeroing all derivative memory, each buffer is initialized by
+  // the first gradient written to it (see backward_arg), so the buffers of
+  // nodes that get no gradient are never touched.
 
   // initialize dE/dE = 1
   ndEdfs.back().v = cg.nodes.back()->device->kSCALAR_ONE;
+  grad_root.back() = num_nodes - 1;
+  grad_ready.back() = 1;
 
   // here we find constant paths to avoid doing extra work
   // by default, a node is constant unless
@@ -232,57 +783,177 @@ void SimpleExecutionEngine::backward(VariableIndex from_where, bool full) {
 
   // Loop in reverse topological order (nodes stored in topological order),
   // considering only nodes that participate in the computation.
+  // values freed in remat mode are recomputed, which happens serially
+  const bool remat = cg.is_remat_mode() && !released.empty();
+  if (!remat && can_run_parallel(num_nodes)) {
+    parallel_backward(num_nodes, needs_derivative);
+  } else {
+    vector<bool> in_computation(num_nodes, false);
+    in_computation[num_nodes - 1] = true;
+    vector<const Tensor*> xs(16);
+    for (int i = num_nodes - 1; i >= 0; --i) {
+      if (!in_computation[i]) continue;
+      const Node* node = exec_node(i);
+      // If the operation is inplaced, no need to call backward
+      if(node->backward_inplaced()) {
+        for (VariableIndex arg : node->args)
+          in_computation[arg] = true;
+      } else {
+        for (VariableIndex arg : node->args)
+          in_computation[arg] = true;
+        // a node that received no gradient has nothing to pass on, but a
+        // value recomputed for its consumers is still released below
+        if (grad_ready[i]) {
+          ProfileScope prof(ProfileKind::BACKWARD, node, node->dim);
+          if (remat) {
+            rematerialize(i);
+            for (VariableIndex arg : node->args)
+              rematerialize(arg);
+          }
+          xs.resize(node->arity());
+          unsigned ai = 0;
+          for (VariableIndex arg : node->args)
+            xs[ai++] = &nfxs[arg];
+          ai = 0;
+          for (VariableIndex arg : node->args) {
+            if (needs_derivative[arg])
+              backward_arg(node, xs, i, ai);
+            ++ai;
+          }
+        }
+      }
+      // nodes processed later only read the values of their own arguments,
+      // which come before i
+      if (remat && recomputed[i]) {
+        recomputed[i] = false;
+        free_value(i);
+      }
+    }
+  }
+
+  // Accumulate gradients into parameters.
+  vector<VariableIndex> pnodes;
+  for (VariableIndex i : cg.parameter_nodes) {
+    if (i <= from_where) {
+      zero_unset_gradient(i);
+      pnodes.push_back(i);
+    }
+  }
+  accumulate_parameter_grads(cg, pnodes, ndEdfs);
+  backward_computed = from_where+1;
+}
+
+void SimpleExecutionEngine::parallel_backward(unsigned num_nodes,
+                                              const vector<bool>& needs_derivative) {
+  // Find the nodes that participate in the computation. Gradients are locked
+  // by grad_root, since inplaced nodes share their argument's memory.
   vector<bool> in_computation(num_nodes, false);
   in_computation[num_nodes - 1] = true;
-  vector<const Tensor*> xs(16);
-  string current_node_name;  // Optionally used for debugging (reused).
-  for (int i = num_nodes - 1; i >= 0; --i) {
-    if (!in_computation[i]) continue;
-    const Node* node = cg.nodes[i];
-    // If the operation is inplaced, no need to call backward
-    if(node->backward_inplaced()) {
-      for (VariableIndex arg : node->args)
+  for (int i = num_nodes - 1; i >= 0; --i)
+    if (in_computation[i])
+      for (VariableIndex arg : exec_node(i)->args)
         in_computation[arg] = true;
-    } else {
-      if (profiling_flag) {
-        current_node_name = "BWD " + node->as_dummy_string();
-        timer.start(current_node_name);
-      }
-      const auto& node_fx = nfxs[i];  // f(x_1, x_2, ..., x_arity), which
-                                      // was previously computed by forward.
-      const auto& node_dEdfx = ndEdfs[i];  // dE/df(x_1, x_2, ..., x_arity)
+
+  // A node may run once all of its consumers have passed their gradient down.
+  vector<unsigned> num_deps(num_nodes, 0), succ_offsets(num_nodes + 1, 0), succs;
+  for (unsigned i = 0; i < num_nodes; ++i) {
+    if (!in_computation[i]) continue;
+    succ_offsets[i + 1] = exec_node(i)->args.size();
+    for (VariableIndex arg : exec_node(i)->args)
+      ++num_deps[arg];
+  }
+  for (unsigned i = 0; i < num_nodes; ++i)
+    succ_offsets[i + 1] += succ_offsets[i];
+  succs.resize(succ_offsets[num_nodes]);
+  for (unsigned i = 0; i < num_nodes; ++i)
+    if (in_computation[i])
+      copy(exec_node(i)->args.begin(), exec_node(i)->args.end(), succs.begin() + succ_offsets[i]);
+
+  std::unique_ptr<std::mutex[]> grad_locks(new std::mutex[kNumGradLocks]);
+  vector<vector<const Tensor*>> worker_xs(exec_threads_flag);
+  run_dag_parallel(num_nodes, num_deps, succ_offsets, succs,
+    [&](unsigned w, unsigned i) {
+      const Node* node = exec_node(i);
+      // If the operation is inplaced, no need to call backward
+      if (!in_computation[i] || node->backward_inplaced()) return;
+      // all writers of the gradient of i have finished
+      if (!grad_ready[i]) return;
+      ProfileScope prof(ProfileKind::BACKWARD, node, node->dim);
+      auto& xs = worker_xs[w];
       xs.resize(node->arity());
       unsigned ai = 0;
-      for (VariableIndex arg : node->args) {
-        in_computation[arg] = true;
-        xs[ai] = &nfxs[arg];
-        ++ai;
-      }
+      for (VariableIndex arg : node->args)
+        xs[ai++] = &nfxs[arg];
       ai = 0;
       for (VariableIndex arg : node->args) {
         if (needs_derivative[arg]) {
-          auto& node_dEdxai = ndEdfs[arg];  // where to store dE/dx_{ai}.
-          DYNET_ASSERT(node_fx.device == node_dEdfx.device &&
-                       node_fx.device == node_dEdxai.device,
-                       "Attempt to do tensor backward in different devices");
-          node->backward(xs, node_fx, node_dEdfx, ai, node_dEdxai);
+          std::lock_guard<std::mutex> lk(grad_locks[grad_root[arg] % kNumGradLocks]);
+          backward_arg(node, xs, i, ai);
         }
         ++ai;
       }
-      if (profiling_flag) { timer.stop(current_node_name); }
-    }
-  }
+    });
+}
 
-  // Accumulate gradients into parameters.
-  for (VariableIndex i : cg.parameter_nodes) {
-    if (i <= from_where) {
-      ParameterNodeBase* pnode = static_cast<ParameterNodeBase*>(cg.nodes[i]);
-      pnode->accumulate_grad(ndEdfs[i]);
-    }
-  }
-  backward_computed = from_where+1;
+// Autobatch schedules are identical for structurally identical graphs, so
+// they are cached across graphs. A schedule depends only on the batching
+// signature of every node and on the arguments inside the evaluated range,
+// which form the key; node ids in the schedule are relative to the first
+// evaluated node.
+static const size_t kMaxCachedSchedules = 256;
+struct CachedSchedule {
+  vector<int> key;
+  vector<vector<VariableIndex>> batches;
+};
+static std::mutex schedule_cache_mutex;
+static unordered_map<size_t, CachedSchedule> schedule_cache;
+
+static size_t hash_schedule_key(const vector<int>& key) {
+  size_t h = key.size();
+  for (int k : key)
+    h ^= std::hash<int>()(k) + 0x9e3779b9 + (h << 6) + (h >> 2);
+  return h;
 }
 
+// Online estimate of the time (in ms) an operation takes as a function of the
+// number of elements it produces, t = launch + elems * per_elem, fit by least
+// squares with exponentially decaying weights. Two pseudo-observations of the
+// prior keep the fit defined until enough measurements have been made.
+struct LinearCostEstimate {
+  LinearCostEstimate(double launch, double per_elem) :
+      n(0), sx(0), sy(0), sxx(0), sxy(0) {
+    add(0, launch);
+    add(kPriorElems, launch + kPriorElems * per_elem);
+  }
+  void observe(double elems, double ms) {
+    n *= kDecay; sx *= kDecay; sy *= kDecay; sxx *= kDecay; sxy *= kDecay;
+    add(elems, ms);
+  }
+  double estimate(double elems) const {
+    const double mx = sx / n, my = sy / n;
+    const double var = sxx / n - mx * mx;
+    const double per_elem = var > 1e-6 ? max((sxy / n - mx * my) / var, 0.0) : 0.0;
+    return max(my - per_elem * mx, 0.0) + per_elem * elems;
+  }
+ private:
+  void add(double x, double y) { n += 1; sx += x; sy += y; sxx += x * x; sxy += x * y; }
+  static constexpr double kPriorElems = 4096;
+  static constexpr double kDecay = 0.99;
+  double n, sx, sy, sxx, sxy;
+};
+
+// The cost model behind autobatching strategy 4: one estimate per node type
+// for executing a (batched) operation, and one for concatenating arguments in
+// combine_tensors. It is shared by all graphs and learned while they run.
+struct AutobatchCostModel {
+  AutobatchCostModel() : ops(nt::conv2d + 1, LinearCostEstimate(2e-3, 1e-6)),
+                         copy(1e-3, 5e-7) {}
+  std::mutex mtx;
+  vector<LinearCostEstimate> ops;  // by nt::NodeType
+  LinearCostEstimate copy;
+};
+static AutobatchCostModel autobatch_cost_model;
+
 // To minimize the number of host-to-device memory copies, we put a bunch of
 // data in contiguous memory. Since we need to pass both pointers and sizes,
 // we use this union.
@@ -294,7 +965,7 @@ static_assert(sizeof(float*) == sizeof(std::size_t),
               "Pointer size must be the same size as size_t");
 
 // copies the list of tensors into a single contig tensor (tout).
-// allocates the memory for tout.
+// allocates the memory for tout, unless it already has some.
 void BatchedExecutionEngine::combine_tensors(
     const std::vector<VariableIndex>& batch_ids,
     int aid,
@@ -310,9 +981,17 @@ void BatchedExecutionEngine::combine_tensors(
     arg_nodes[i] = nid;
   }
   tout.d = Dim({total_dsize});
+  stats.combine_bytes += total_dsize * sizeof(float);
+  ProfileScope prof(ProfileKind::COPY, "combine_tensors");
+  if (prof.active) {
+    prof.ev.dim = tout.d;
+    prof.ev.bytes = total_dsize * sizeof(float);
+    prof.ev.batch_size = batch_ids.size();
+    prof.ev.device_id = tout.device->device_id;
+  }
 
   // allocate memory for tout
-  float* dest =
+  float* dest = tout.v != nullptr ? tout.v :
       static_cast<float*>(mempool->allocate(total_dsize * sizeof(float)));
 
 #if HAVE_CUDA
@@ -364,6 +1043,14 @@ void BatchedExecutionEngine::accumulate_tensors(
     const Tensor& tin,
     const std::vector<VariableIndex>& batch_ids,
     int ai) {
+  ProfileScope prof(ProfileKind::ACCUMULATE, "accumulate_tensors");
+  if (prof.active) {
+    prof.ev.dim = tin.d;
+    prof.ev.bytes = tin.d.size() * sizeof(float);
+    prof.ev.batch_size = batch_ids.size();
+    prof.ev.device_id = tin.device->device_id;
+  }
+  accumulate_bytes += tin.d.size() * sizeof(float);
   if (tin.device->type == DeviceType::CPU) {
     size_t tot_arg = 0;
     Tensor temp_ndEdf;
@@ -419,11 +1106,27 @@ void BatchedExecutionEngine::invalidate() {
   node2size.clear();
   node2batch.clear();
   ndEdfs.clear();
+  batch_grad_ready.clear();
   nfx_cache.clear();
 }
 
+AutobatchStats BatchedExecutionEngine::autobatch_stats() const {
+  AutobatchStats ret = stats;
+  ret.accumulate_bytes = accumulate_bytes;
+  // the types are only demangled when the statistics are read
+  for (auto & item : ret.signatures)
+    item.second.op = Profiler::type_name(*item.second.type);
+  return ret;
+}
+
+void BatchedExecutionEngine::clear_autobatch_stats() {
+  stats.clear();
+  accumulate_bytes = 0;
+}
+
 void BatchedExecutionEngine::invalidate(unsigned i) {
-  num_nodes_evaluated = i;
+  // nodes that were not evaluated yet stay so
+  num_nodes_evaluated = std::min(num_nodes_evaluated, (VariableIndex)i);
 }
 
 const Tensor& BatchedExecutionEngine::forward() {
@@ -432,10 +1135,63 @@ const Tensor& BatchedExecutionEngine::forward() {
 }
 
 const Tensor& BatchedExecutionEngine::forward(VariableIndex i) {
+  if (cg.is_frozen() && i < num_nodes_evaluated) {
+    // every evaluated node is replayed, since any of them may be read next
+    replay();
+    return get_nfx(i);
+  }
   invalidate();
   return incremental_forward(i);
 }
 
+void BatchedExecutionEngine::replay() {
+  // Copies of arguments on the GPU allocate their argument lists, so give
+  // that memory back afterwards
+  std::vector<size_t> fxs_used;
+  for (Device* dev : device_manager->get_devices())
+    fxs_used.push_back(dev->pools[(int)DeviceMempool::FXS]->used());
+  VariableIndex num_batches = 0;
+  for (VariableIndex j = 0; j < num_nodes_evaluated; ++j)
+    num_batches = std::max(num_batches, (VariableIndex)(node2batch[j] + 1));
+  vector<const Tensor*> xs(16);
+  for (VariableIndex bid = 0; bid < num_batches; ++bid) {
+    auto & my_batch = batches[bid];
+    Node* node = my_batch.pseudo_node;
+    if (node != nullptr) {
+      // Pseudo nodes (e.g. of batched inputs) hold copies of the values of
+      // their nodes, so they have to be made again
+      Node* fresh = cg.nodes[my_batch.ids[0]]->autobatch_pseudo_node(cg, my_batch.ids);
+      fresh->aux_mem = node->aux_mem;
+      fresh->device = node->device;
+      delete node;
+      node = my_batch.pseudo_node = fresh;
+    } else {
+      node = cg.nodes[my_batch.ids[0]];
+    }
+    ProfileScope prof(ProfileKind::FORWARD, cg.nodes[my_batch.ids[0]], my_batch.nfx.d,
+                      my_batch.ids.size(), my_batch.sig);
+    if (my_batch.ids.size() == 1) {
+      xs.resize(node->arity());
+      unsigned ai = 0;
+      for (VariableIndex arg : node->args)
+        xs[ai++] = &get_nfx(arg);
+      node->forward(xs, my_batch.nfx);
+    } else {
+      // Arguments that were copied together are copied again into the same
+      // memory; the others still point at the right values
+      for (size_t i = 0; i < my_batch.concat.size(); ++i)
+        if (my_batch.concat[i] == 1)
+          combine_tensors(my_batch.ids, i, *const_cast<Tensor*>(my_batch.arg_nfxs[i]));
+      node->autobatch_reshape(cg, my_batch.ids, my_batch.concat, my_batch.arg_nfxs, my_batch.nfx);
+      node->forward(my_batch.arg_nfxs, my_batch.nfx);
+    }
+  }
+  unsigned di = 0;
+  for (Device* dev : device_manager->get_devices())
+    dev->pools[(int)DeviceMempool::FXS]->set_used(fxs_used[di++]);
+  backward_computed = 0;
+}
+
 const Tensor& BatchedExecutionEngine::get_value(VariableIndex i) {
   DYNET_ASSERT(i < cg.nodes.size(),
       "Out-of-bounds variable access in BatchedExecutionEngine::get_value()");
@@ -453,6 +1209,8 @@ const Tensor& BatchedExecutionEngine::get_gradient(VariableIndex i) {
                       << i << ", but backward pass was computed from node "
                       << backward_computed);
   }
+  if (node2batch[i] < batch_grad_ready.size() && !batch_grad_ready[node2batch[i]])
+    TensorTools::zero(ndEdfs[i]);
   return ndEdfs[i];
 }
 
@@ -476,6 +1234,7 @@ void BatchedExecutionEngine::garbage_collect() {
   for (Device* dev : device_manager->get_devices())
     dev->pools[(int)DeviceMempool::FXS]->free();
   batches.clear();
+  placement_groups.clear();
 }
 
 const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
@@ -484,7 +1243,8 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
 
   if (upto >= num_nodes_evaluated) {
     if (autobatch_strategy == 0) autobatch_strategy = 1;
-    string current_batch_name;
+    ProfileScope plan_prof(ProfileKind::PLAN, "autobatch");
+    Timing plan_timer;
 
     const size_t uptop1 = upto + 1;
     const size_t uptop1psig = uptop1 + sigmap.size();
@@ -514,10 +1274,54 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
     float* prof2avg = (float*)(active_un_begin + uptop1psig);
     float* prof2cnt = prof2avg + uptop1psig;
 
+    // Compute the batching signatures, which together with the arguments
+    // within the range identify the schedule
+    vector<int> node2sig(uptop1 - node_id);
+    vector<int> schedule_key;
+    schedule_key.reserve(node2sig.size() * 4 + 2);
+    schedule_key.push_back(autobatch_strategy);
+    schedule_key.push_back(node2sig.size());
+    for (VariableIndex j = num_nodes_evaluated; j <= upto; ++j) {
+      const Node* node = cg.nodes[j];
+      const int sig = node->autobatch_sig(cg, sigmap);
+      node2sig[j - num_nodes_evaluated] = sig;
+      schedule_key.push_back(sig);
+      schedule_key.push_back(sig ? sigmap.sig2type(sig) : 0);
+      schedule_key.push_back(node->args.size());
+      for (VariableIndex arg : node->args)
+        schedule_key.push_back(arg >= node_id ? (int)(arg - node_id) : -1);
+    }
+    const size_t schedule_hash = hash_schedule_key(schedule_key);
+    bool schedule_cached = false;
+    {
+      std::lock_guard<std::mutex> lk(schedule_cache_mutex);
+      auto it = schedule_cache.find(schedule_hash);
+      if (it != schedule_cache.end() && it->second.key == schedule_key) {
+        for (auto & cached_ids : it->second.batches) {
+          auto & batch_ids = batches[batch_id].ids;
+          batch_ids.resize(cached_ids.size());
+          for (size_t k = 0; k < cached_ids.size(); ++k) {
+            VariableIndex curr_node = cached_ids[k] + node_id;
+            batch_ids[k] = curr_node;
+            node2batch[curr_node] = batch_id;
+            node2size[curr_node] = cg.nodes[curr_node]->dim.size();
+          }
+          ++batch_id;
+        }
+        schedule_cached = true;
+      }
+    }
+
     // More intelligent batching?
-    if (autobatch_strategy == 1 || autobatch_strategy == 3) {
+    if (schedule_cached) {
+      // the schedule was replayed from the cache
+    } else if (autobatch_strategy == 1 || autobatch_strategy == 3 ||
+               autobatch_strategy == 4) {
       // Count of remaining things for this profile
       unordered_map<int, int> depthprofcnt(upto * 3);
+      // Elements of the arguments a node of this profile concatenates when
+      // batched, or -1 if not known yet (strategy 4)
+      vector<double> prof2concat(autobatch_strategy == 4 ? uptop1psig : 0, -1.0);
       // Node to successors
       vector<VariableIndex> node2successors(uptop1, (VariableIndex)0);
       vector<VariableIndex> active_batched(uptop1 * 2, (VariableIndex)0);
@@ -543,11 +1347,11 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
         }
         node2depth[j] = depth;
         // Get the node profile ID
-        sig = node->autobatch_sig(cg, sigmap);
+        sig = node2sig[j - num_nodes_evaluated];
         // If batchable, collect statistics
         if (sig != 0) {
           node2profid[j] = sig;
-          if (autobatch_strategy == 3) {
+          if (autobatch_strategy == 3 || autobatch_strategy == 4) {
             ++depthprofcnt[(depth * upto) + sig];
           }
           abmax = (VariableIndex)max((int)abmax, sig+1);
@@ -559,7 +1363,7 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
             active_batched.push_back(j);
             active_batched[sig] = active_batched.size();
             active_batched.push_back(abptr);
-            if(autobatch_strategy == 3)
+            if(autobatch_strategy == 3 || autobatch_strategy == 4)
               --depthprofcnt[sig];
           }
         } else if(node2left[j] == 0) {
@@ -575,10 +1379,50 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
         // 1. Nodes that don't support batching
         // 2. Nodes that support batching. In this case, use a heuristic
         //    of picking the node with the lowest average ID of nodes of
-        //    that profile.
+        //    that profile, or (strategy 4) the batch with the lowest
+        //    estimated time per node.
         int curr_node = -1, curr_prof = -1;
         if (active_un_begin != active_un_end) {
           curr_node = *(active_un_begin++);
+        } else if (autobatch_strategy == 4) {
+          double best_cost = 1e30;
+          std::lock_guard<std::mutex> lk(autobatch_cost_model.mtx);
+          for (size_t profid = 1; profid < (size_t)abmax; ++profid) {
+            if (active_batched[profid] == (VariableIndex)0) continue;
+            const VariableIndex exemplar = active_batched[active_batched[profid]-1];
+            const double num_ready = active_batched[profid + uptop1];
+            const LinearCostEstimate& op = autobatch_cost_model.ops[sigmap.sig2type(profid)];
+            double cost = op.estimate(num_ready * node2size[exemplar]);
+            if (num_ready > 1) {
+              if (prof2concat[profid] < 0) {
+                const Node* node = cg.nodes[exemplar];
+                const vector<int> concat = node->autobatch_concat(cg);
+                prof2concat[profid] = 0;
+                for (size_t ai = 0; ai < concat.size(); ++ai)
+                  if (concat[ai])
+                    prof2concat[profid] += cg.nodes[node->args[ai]]->dim.size();
+              }
+              if (prof2concat[profid] > 0)
+                cost += autobatch_cost_model.copy.estimate(num_ready * prof2concat[profid]);
+            }
+            // nodes of this profile at the same depth that are not ready yet
+            // will need another launch
+            if (depthprofcnt[(node2depth[exemplar] * upto) + profid] != 0)
+              cost += op.estimate(0);
+            cost /= num_ready;
+            if (cost < best_cost) {
+              curr_prof = profid;
+              best_cost = cost;
+            }
+          }
+
+          abptr = active_batched[curr_prof];
+          if(active_batched[abptr] == 0) {
+            curr_node = active_batched[abptr-1];
+            active_batched[curr_prof] = 0;
+            active_batched[curr_prof + uptop1] = 0;
+            curr_prof = -1;
+          }
         } else {
           float best_avg = 1e10;
           for (size_t profid = 1; profid < (size_t)abmax; ++profid) {
@@ -626,7 +1470,7 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
                 active_batched.push_back(next_node);
                 active_batched[profid] = active_batched.size();
                 active_batched.push_back(abptr);
-                if(autobatch_strategy == 3)
+                if(autobatch_strategy == 3 || autobatch_strategy == 4)
                   --depthprofcnt[(node2depth[next_node] * upto) + profid];
               }
             }
@@ -669,7 +1513,7 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
                   active_batched.push_back(next_node);
                   active_batched[profid] = active_batched.size();
                   active_batched.push_back(abptr);
-                  if (autobatch_strategy == 3)
+                  if (autobatch_strategy == 3 || autobatch_strategy == 4)
                     --depthprofcnt[(node2depth[next_node] * upto) + profid];
                 }
               }
@@ -693,7 +1537,7 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
           depth = max(node2depth[k]+1,depth);
         node2depth[j] = depth;
         node2size[j] = node->dim.size();
-        sig = node->autobatch_sig(cg, sigmap);
+        sig = node2sig[j - num_nodes_evaluated];
         depth_profile_batches[make_pair(depth, sig)].push_back(j); 
       }
       for (auto & batch_info : depth_profile_batches) {
@@ -711,9 +1555,24 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
       }
     }
 
+    if (!schedule_cached) {
+      CachedSchedule schedule;
+      schedule.key = std::move(schedule_key);
+      schedule.batches.resize(batch_id - num_batches_evaluated);
+      for (VariableIndex bid = num_batches_evaluated; bid < batch_id; ++bid) {
+        auto & cached_ids = schedule.batches[bid - num_batches_evaluated];
+        for (VariableIndex curr_node : batches[bid].ids)
+          cached_ids.push_back(curr_node - num_nodes_evaluated);
+      }
+      std::lock_guard<std::mutex> lk(schedule_cache_mutex);
+      if (schedule_cache.size() >= kMaxCachedSchedules)
+        schedule_cache.clear();
+      schedule_cache[schedule_hash] = std::move(schedule);
+    }
+
     // 2.5 print some debug info
     if (profiling_flag > 1) {
-      cout << "Forward Call" << endl;
+      cout << "Forward Call" << (schedule_cached ? " (cached schedule)" : "") << endl;
       for(VariableIndex bid = num_batches_evaluated; bid < batch_id; ++bid) {
         auto & batch_ids = batches[bid].ids;
         VariableIndex curr_node = batch_ids[0];
@@ -722,6 +1581,39 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
       }
     }
 
+    // 2.7 Lay out the outputs that are concatenated together contiguously
+    plan_placement(num_batches_evaluated, batch_id);
+
+    // 2.8 Count the batches for the autobatching statistics
+    ++stats.forward_calls;
+    if (schedule_cached) ++stats.cached_plans;
+    for (VariableIndex bid = num_batches_evaluated; bid < batch_id; ++bid) {
+      BatchInfo& batch = batches[bid];
+      const unsigned size = batch.ids.size();
+      batch.sig = node2sig[batch.ids[0] - num_nodes_evaluated];
+      stats.nodes += size;
+      ++stats.batches;
+      if (stats.batch_sizes.size() <= size) stats.batch_sizes.resize(size + 1, 0);
+      ++stats.batch_sizes[size];
+      if (batch.sig == 0) {
+        stats.unbatchable_nodes += size;
+        continue;
+      }
+      AutobatchStats::Signature& sig_stats = stats.signatures[batch.sig];
+      if (sig_stats.batches == 0) {
+        const Node* node = cg.nodes[batch.ids[0]];
+        sig_stats.type = &typeid(*node);
+        sig_stats.dim = node->dim;
+      }
+      ++sig_stats.batches;
+      sig_stats.nodes += size;
+    }
+    if (plan_prof.active) {
+      if (schedule_cached) plan_prof.ev.name = "autobatch (cached)";
+      plan_prof.ev.batch_size = uptop1 - num_nodes_evaluated;
+      plan_prof.ev.bytes = temp_data_size;
+    }
+
     // 3. Based on the batches, allocate the memory, etc
     for(VariableIndex bid = num_batches_evaluated; bid < batch_id; ++bid) {
       auto & my_batch = batches[bid];
@@ -740,8 +1632,15 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
         nfx.mem_pool = DeviceMempool::FXS;
         // Allocate memory
         auto mempool = node->device->pools[(int)DeviceMempool::FXS];
-        nfx.v = static_cast<float*>(
-            mempool->allocate(node2size[curr_node] * sizeof(float)));
+        if (my_batch.group >= 0) {
+          PlacementGroup& group = placement_groups[my_batch.group];
+          if (group.v == nullptr)
+            group.v = static_cast<float*>(mempool->allocate(group.size * sizeof(float)));
+          nfx.v = group.v ? group.v + my_batch.group_offset : nullptr;
+        } else {
+          nfx.v = static_cast<float*>(
+              mempool->allocate(node2size[curr_node] * sizeof(float)));
+        }
         if (nfx.v == nullptr) {
           DYNET_RUNTIME_ERR("Ran out of memory when allocating for node "
                             << curr_node << ", allocating FWD memory.");
@@ -772,8 +1671,17 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
 
         // Allocate main/auxiliary memory for the batch
         auto mempool = node->device->pools[(int)DeviceMempool::FXS];
-        float *head_main = static_cast<float*>(
-            mempool->allocate(tot_main * sizeof(float)));
+        float *head_main = nullptr;
+        if (my_batch.group >= 0) {
+          PlacementGroup& group = placement_groups[my_batch.group];
+          if (group.v == nullptr)
+            group.v = static_cast<float*>(mempool->allocate(group.size * sizeof(float)));
+          if (group.v != nullptr)
+            head_main = group.v + my_batch.group_offset;
+        } else {
+          head_main = static_cast<float*>(
+              mempool->allocate(tot_main * sizeof(float)));
+        }
         if (head_main == nullptr) {
           DYNET_RUNTIME_ERR("Ran out of memory when executing batch " << bid <<
                             ", allocating FWD memory.");
@@ -808,18 +1716,20 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
       }  // batch_ids.size() > 1 condition
     }  // loop over all batches
 
+    plan_prof.stop();
+    stats.plan_ms += plan_timer.stop();
+
     // 4: do the actual execution
     Tensor temp_nfx;
     vector<const Tensor*> xs(16), ts(16);
+    // strategy 4 learns its cost model from the execution times
+    const bool learn_costs = autobatch_strategy == 4;
+    Timing op_timer;
     while(num_batches_evaluated < batch_id) {
       // Read in the stuff for this batch
       auto & my_batch = batches[num_batches_evaluated];
-      if (profiling_flag) {
-        VariableIndex nid = my_batch.ids[0];
-        Node* node = cg.nodes[nid];
-        current_batch_name = "FWD " + node->as_dummy_string();
-        timer.start(current_batch_name);
-      }
+      ProfileScope prof(ProfileKind::FORWARD, cg.nodes[my_batch.ids[0]], my_batch.nfx.d,
+                        my_batch.ids.size(), my_batch.sig);
       if (my_batch.ids.size() == 1) { // execute a single node
         VariableIndex nid = my_batch.ids[0];
         Node* node = cg.nodes[nid];
@@ -829,7 +1739,14 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
           xs[ai] = &get_nfx(arg);
           ++ai;
         }
+        const int sig = learn_costs ? node2sig[nid - num_nodes_evaluated] : 0;
+        if (sig) op_timer.start();
         node->forward(xs, my_batch.nfx);
+        if (sig) {
+          const double ms = op_timer.stop();
+          std::lock_guard<std::mutex> lk(autobatch_cost_model.mtx);
+          autobatch_cost_model.ops[sigmap.sig2type(sig)].observe(node2size[nid], ms);
+        }
         ++num_batches_evaluated;
       } else { // execute a batch node
         size_t arity = my_batch.concat.size();
@@ -873,18 +1790,30 @@ const Tensor& BatchedExecutionEngine::incremental_forward_no_update(
             //   autobatch_garbage[i] = false;
             } else { // if non-contig, copy xs_i into new mem.
               // 2.b) the inputs need to be concatenated, and are not contiguous
+              if (learn_costs) op_timer.start();
               combine_tensors(my_batch.ids, i, *my_xsi);
+              if (learn_costs) {
+                const double ms = op_timer.stop();
+                std::lock_guard<std::mutex> lk(autobatch_cost_model.mtx);
+                autobatch_cost_model.copy.observe(my_xsi->d.size(), ms);
+              }
             }
             my_batch.arg_nfxs[i] = my_xsi;
           }
         }
 
         node->autobatch_reshape(cg, my_batch.ids, my_batch.concat, my_batch.arg_nfxs, my_batch.nfx);
+        if (learn_costs) op_timer.start();
         node->forward(my_batch.arg_nfxs, my_batch.nfx);
+        if (learn_costs) {
+          const double ms = op_timer.stop();
+          const int sig = node2sig[my_batch.ids[0] - num_nodes_evaluated];
+          std::lock_guard<std::mutex> lk(autobatch_cost_model.mtx);
+          autobatch_cost_model.ops[sigmap.sig2type(sig)].observe(my_batch.nfx.d.size(), ms);
+        }
         // cerr << "batched forward[" << num_batches_evaluated << "] (nodes:"; for(auto id : my_batch.ids) cerr << ' ' << id; cerr << ") == " << print_vec(as_vector(my_batch.nfx)) << endl;
         ++num_batches_evaluated;
       } // execute a batch node (not a single instance node)
-      if (profiling_flag) { timer.stop(current_batch_name); }
     }
 
     free(node2profid);
@@ -905,7 +1834,7 @@ const Tensor& BatchedExecutionEngine::incremental_forward(VariableIndex i) {
     incremental_forward_no_update(i, 1);
     double best_speed = timer.stop();
     autobatch_flag = 1;
-    for(size_t strat = 2; strat < 4; ++strat) {
+    for(size_t strat = 2; strat < 5; ++strat) {
       timer.start();
       incremental_forward_no_update(i, strat);
       double speed = timer.stop();
@@ -955,13 +1884,23 @@ void BatchedExecutionEngine::backward(VariableIndex from_where, bool full) {
   ndEdfs.resize(node2batch.size());
   for(Device* device : device_manager->get_devices())
     device->pools[(int)DeviceMempool::DEDFS]->free();
+  // gradients of placement groups mirror their forward layout
+  vector<float*> group_ndEdfs(placement_groups.size(), nullptr);
   for (unsigned i = 0; i < num_batches; ++i) {
     const auto & my_batch = batches[i];
     const auto & dim = my_batch.nfx.d;
     batched_ndEdfs[i].d = dim;
     batched_ndEdfs[i].device = cg.nodes[my_batch.ids[0]]->device;
     batched_ndEdfs[i].mem_pool = DeviceMempool::DEDFS;
-    batched_ndEdfs[i].v = static_cast<float*>(batched_ndEdfs[i].device->pools[(int)DeviceMempool::DEDFS]->allocate(dim.size() * sizeof(float)));
+    AlignedMemoryPool* pool = batched_ndEdfs[i].device->pools[(int)DeviceMempool::DEDFS];
+    if (my_batch.group >= 0) {
+      float*& gv = group_ndEdfs[my_batch.group];
+      if (gv == nullptr)
+        gv = static_cast<float*>(pool->allocate(placement_groups[my_batch.group].size * sizeof(float)));
+      batched_ndEdfs[i].v = gv ? gv + my_batch.group_offset : nullptr;
+    } else {
+      batched_ndEdfs[i].v = static_cast<float*>(pool->allocate(dim.size() * sizeof(float)));
+    }
     if (!batched_ndEdfs[i].v) {
       DYNET_RUNTIME_ERR("out of memory while attempting to allocate space for derivatives of node " << i << ", allocating BWD memory.");
     }
@@ -973,8 +1912,9 @@ void BatchedExecutionEngine::backward(VariableIndex from_where, bool full) {
       ndEdfs[id].v = batched_ndEdfs[i].v + node2offset[id];
     }
   }
-  for(Device* device : device_manager->get_devices())
-    device->pools[(int)DeviceMempool::DEDFS]->zero_allocated_memory();
+  // The memory of each batch is zeroed by backward_batch() when the first
+  // gradient reaches it
+  batch_grad_ready.assign(num_batches, 0);
 
   // initialize dE/dE = 1
   size_t final_size = batched_ndEdfs.back().d.size();
@@ -985,6 +1925,7 @@ void BatchedExecutionEngine::backward(VariableIndex from_where, bool full) {
     vals[pos_in_batch] = 1.0f;
     TensorTools::set_elements(batched_ndEdfs.back(), vals);
   }
+  batch_grad_ready.back() = 1;
 
   // here we find constant paths to avoid doing extra work
   // by default, a node is constant unless
@@ -1006,96 +1947,41 @@ void BatchedExecutionEngine::backward(VariableIndex from_where, bool full) {
     }
   }
 
-  // loop in reverse topological order
-  // consider only batches that participate in the computation.
+  // find the batches that participate in the computation
   vector<bool> in_computation(num_batches, false);
   in_computation.back() = true;
-  vector<const Tensor*> xs;
-  string current_batch_name;
   for (int i = num_batches - 1; i >= 0; --i) {
     if (!in_computation[i]) continue;
     const auto & my_batch = batches[i];
-    VariableIndex nid = my_batch.ids[0];
-    if (profiling_flag) {
-      Node* node = cg.nodes[nid];
-      current_batch_name = "BWD " + node->as_dummy_string();
-      timer.start(current_batch_name);
-    }
-    if (my_batch.ids.size() == 1) { // execute a single node
-      const Node* node = cg.nodes[nid];
-      xs.resize(node->arity());
-      unsigned ai = 0;
-      for (VariableIndex arg : node->args) {
+    if (my_batch.ids.size() == 1) {
+      for (VariableIndex arg : cg.nodes[my_batch.ids[0]]->args)
         in_computation[node2batch[arg]] = true;
-        xs[ai] = &get_nfx(arg);
-        ++ai;
-      }
-      ai = 0;
-      for (VariableIndex arg : node->args) {
-        if (needs_derivative[node2batch[arg]]) {
-          node->backward(xs, get_nfx(nid), ndEdfs[nid], ai, ndEdfs[arg]);
-          // cerr << "unbatched backward[" << nid << "](" << ai << ")->" << arg << " == " << print_vec(as_vector(my_batch.nfx)) << endl;
-        }
-        ++ai;
-      }
-    } else { // execute a batch node
-      size_t arity = my_batch.concat.size();
-      Node* node = my_batch.pseudo_node;
+    } else {
+      const Node* node = my_batch.pseudo_node;
       if(node == nullptr) node = cg.nodes[my_batch.ids[0]];
-      xs.resize(arity); 
       size_t ai = 0;
       for (VariableIndex arg : node->args) {
         if(!my_batch.concat[ai]) {
-          xs[ai] = &get_nfx(arg);
           in_computation[node2batch[arg]] = true;
         } else {
-          xs[ai] = my_batch.arg_nfxs[ai];
           for(auto bid : my_batch.ids)
             in_computation[node2batch[cg.nodes[bid]->args[ai]]] = true;
         }
         ++ai;
       }
-      ai = 0;
-      for (VariableIndex arg : node->args) {
-        // No concatenation whatsoever
-        if (my_batch.concat[ai] == 0) {
-          if (needs_derivative[node2batch[arg]]) {
-            node->backward(xs, my_batch.nfx, batched_ndEdfs[i], ai, batched_ndEdfs[node2batch[arg]]);
-            // cerr << "batched backward[" << i << "](" << ai << ")->" << node2batch[arg] << " == " << print_vec(as_vector(batched_ndEdfs[node2batch[arg]])) << endl;
-          }
-        // Needs concatenation
-        } else {
-          bool nd = false;
-          for(auto nid : my_batch.ids)
-            if((bool)(nd = needs_derivative[node2batch[cg.nodes[nid]->args[ai]]]))
-              break;
-          if (nd) {
-            // Non-contiguous
-            Tensor my_ndEdf = *xs[ai];
-            if (my_batch.concat[ai] == 1) {
-              size_t used = node->device->pools[(int)DeviceMempool::DEDFS]->used();
-              my_ndEdf.v = static_cast<float*>(batched_ndEdfs[i].device->pools[(int)DeviceMempool::DEDFS]->allocate(my_ndEdf.d.size() * sizeof(float)));
-              my_ndEdf.mem_pool = DeviceMempool::DEDFS;
-              TensorTools::zero(my_ndEdf);
-              node->backward(xs, my_batch.nfx, batched_ndEdfs[i], ai, my_ndEdf);
-              // cerr << "noncontig backward[" << i << "](" << ai << ")->" << node2batch[arg] << " == "; for(auto id : my_batch.ids) cerr << " ndEdfs[" << cg.nodes[id]->args[ai] << "] == " << print_vec(as_vector(ndEdfs[cg.nodes[id]->args[ai]])); cerr << " + " << print_vec(as_vector(my_ndEdf)) << " == ";
-              accumulate_tensors(my_ndEdf, my_batch.ids, ai);
-              // for(auto id : my_batch.ids) cerr << " ndEdfs[" << cg.nodes[id]->args[ai] << "] == " << print_vec(as_vector(ndEdfs[cg.nodes[id]->args[ai]])); cerr << endl;
-              node->device->pools[(int)DeviceMempool::DEDFS]->set_used(used);
-            // Contiguous
-            } else {
-              VariableIndex aid = cg.nodes[my_batch.ids[0]]->args[ai];
-              float* v = batched_ndEdfs[node2batch[aid]].v + node2offset[aid];
-              my_ndEdf.v = v;
-              node->backward(xs, my_batch.nfx, batched_ndEdfs[i], ai, my_ndEdf);
-              // cerr << "contig backward[" << i << "](" << ai << ")->" << node2batch[arg] << " == "; for(auto id : my_batch.ids) cerr << " ndEdfs[" << cg.nodes[id]->args[ai] << "] == " << print_vec(as_vector(ndEdfs[cg.nodes[id]->args[ai]])); cerr << endl;
-            }
-          }
-        }
-        ++ai;
-      }
     }
-    if(profiling_flag) { timer.stop(current_batch_name); }
+  }
+
+  // loop in reverse topological order
+  if (can_run_parallel(num_batches)) {
+    parallel_backward(num_batches, batched_ndEdfs, needs_derivative, in_computation);
+  } else {
+    vector<const Tensor*> xs;
+    for (int i = num_batches - 1; i >= 0; --i) {
+      // batches that received no gradient have nothing to pass on
+      if (!in_computation[i] || !batch_grad_ready[i]) continue;
+      backward_batch(i, batched_ndEdfs, needs_derivative, xs, nullptr, nullptr);
+    }
   }
 
   // accumulate gradients into parameters
@@ -1104,14 +1990,315 @@ void BatchedExecutionEngine::backward(VariableIndex from_where, bool full) {
   // that returns the current value of the parameters
   // TODO: Can this be batched? Maybe not with the current assumptions, but
   //       it would be nice to have.
-  for (VariableIndex i : cg.parameter_nodes)
-    if(i < (VariableIndex)ndEdfs.size() && ndEdfs[i].v != nullptr)
-      static_cast<ParameterNodeBase*>(cg.nodes[i])->accumulate_grad(ndEdfs[i]);
+  vector<VariableIndex> pnodes;
+  for (VariableIndex i : cg.parameter_nodes) {
+    if(i < (VariableIndex)ndEdfs.size() && ndEdfs[i].v != nullptr) {
+      if (node2batch[i] < num_batches && !batch_grad_ready[node2batch[i]])
+        TensorTools::zero(ndEdfs[i]);
+      pnodes.push_back(i);
+    }
+  }
+  accumulate_parameter_grads(cg, pnodes, ndEdfs);
   backward_computed = from_where + 1;
   // for(VariableIndex vi = (VariableIndex)0; vi <= backward_computed; ++vi) cerr << "ndEdfs[" << vi << "] == " << print_vec(as_vector(ndEdfs[vi])) << endl;
 
 }
 
+void BatchedExecutionEngine::backward_batch(VariableIndex i,
+                                            vector<Tensor>& batched_ndEdfs,
+                                            const vector<bool>& needs_derivative,
+                                            vector<const Tensor*>& xs,
+                                            std::mutex* batch_locks,
+                                            AlignedMemoryPool* temp_pool) {
+  const auto & my_batch = batches[i];
+  VariableIndex nid = my_batch.ids[0];
+  ProfileScope prof(ProfileKind::BACKWARD, cg.nodes[nid], my_batch.nfx.d,
+                    my_batch.ids.size(), my_batch.sig);
+  // When running in parallel, hold the locks of all batches receiving the
+  // gradient while it is written (in increasing order, to avoid deadlock).
+  // Batches that receive their first gradient are zeroed beforehand.
+  vector<VariableIndex> dests;
+  vector<std::unique_lock<std::mutex>> held;
+  auto lock_dests = [&]() {
+    sort(dests.begin(), dests.end());
+    dests.erase(unique(dests.begin(), dests.end()), dests.end());
+    if (batch_locks != nullptr)
+      for (auto d : dests)
+        held.emplace_back(batch_locks[d]);
+    for (auto d : dests) {
+      if (!batch_grad_ready[d]) {
+        TensorTools::zero(batched_ndEdfs[d]);
+        batch_grad_ready[d] = 1;
+      }
+    }
+  };
+  auto unlock_dests = [&]() {
+    held.clear();
+    dests.clear();
+  };
+  if (my_batch.ids.size() == 1) { // execute a single node
+    const Node* node = cg.nodes[nid];
+    xs.resize(node->arity());
+    unsigned ai = 0;
+    for (VariableIndex arg : node->args) {
+      xs[ai] = &get_nfx(arg);
+      ++ai;
+    }
+    ai = 0;
+    for (VariableIndex arg : node->args) {
+      if (needs_derivative[node2batch[arg]]) {
+        dests.push_back(node2batch[arg]);
+        lock_dests();
+        node->backward(xs, get_nfx(nid), ndEdfs[nid], ai, ndEdfs[arg]);
+        unlock_dests();
+        // cerr << "unbatched backward[" << nid << "](" << ai << ")->" << arg << " == " << print_vec(as_vector(my_batch.nfx)) << endl;
+      }
+      ++ai;
+    }
+  } else { // execute a batch node
+    size_t arity = my_batch.concat.size();
+    Node* node = my_batch.pseudo_node;
+    if(node == nullptr) node = cg.nodes[my_batch.ids[0]];
+    xs.resize(arity); 
+    size_t ai = 0;
+    for (VariableIndex arg : node->args) {
+      if(!my_batch.concat[ai]) {
+        xs[ai] = &get_nfx(arg);
+      } else {
+        xs[ai] = my_batch.arg_nfxs[ai];
+      }
+      ++ai;
+    }
+    ai = 0;
+    for (VariableIndex arg : node->args) {
+      // No concatenation whatsoever
+      if (my_batch.concat[ai] == 0) {
+        if (needs_derivative[node2batch[arg]]) {
+          dests.push_back(node2batch[arg]);
+          lock_dests();
+          node->backward(xs, my_batch.nfx, batched_ndEdfs[i], ai, batched_ndEdfs[node2batch[arg]]);
+          unlock_dests();
+          // cerr << "batched backward[" << i << "](" << ai << ")->" << node2batch[arg] << " == " << print_vec(as_vector(batched_ndEdfs[node2batch[arg]])) << endl;
+        }
+      // Needs concatenation
+      } else {
+        bool nd = false;
+        for(auto nid : my_batch.ids)
+          if((bool)(nd = needs_derivative[node2batch[cg.nodes[nid]->args[ai]]]))
+            break;
+        if (nd) {
+          // Arguments that were contiguous in forward memory may still have
+          // gradients that are not (e.g. across pool chunks)
+          bool contig = my_batch.concat[ai] == 2;
+          if (contig) {
+            VariableIndex aid = cg.nodes[my_batch.ids[0]]->args[ai];
+            float* v = batched_ndEdfs[node2batch[aid]].v + node2offset[aid];
+            for (auto id : my_batch.ids) {
+              aid = cg.nodes[id]->args[ai];
+              if (batched_ndEdfs[node2batch[aid]].v + node2offset[aid] != v) {
+                contig = false;
+                break;
+              }
+              v += node2size[aid];
+            }
+          }
+          // Non-contiguous
+          Tensor my_ndEdf = *xs[ai];
+          if (!contig) {
+            AlignedMemoryPool* pool = (temp_pool != nullptr ? temp_pool : node->device->pools[(int)DeviceMempool::DEDFS]);
+            size_t used = pool->used();
+            my_ndEdf.v = static_cast<float*>(pool->allocate(my_ndEdf.d.size() * sizeof(float)));
+            my_ndEdf.mem_pool = DeviceMempool::DEDFS;
+            TensorTools::zero(my_ndEdf);
+            node->backward(xs, my_batch.nfx, batched_ndEdfs[i], ai, my_ndEdf);
+            // cerr << "noncontig backward[" << i << "](" << ai << ")->" << node2batch[arg] << " == "; for(auto id : my_batch.ids) cerr << " ndEdfs[" << cg.nodes[id]->args[ai] << "] == " << print_vec(as_vector(ndEdfs[cg.nodes[id]->args[ai]])); cerr << " + " << print_vec(as_vector(my_ndEdf)) << " == ";
+            for(auto id : my_batch.ids)
+              dests.push_back(node2batch[cg.nodes[id]->args[ai]]);
+            lock_dests();
+            accumulate_tensors(my_ndEdf, my_batch.ids, ai);
+            unlock_dests();
+            // for(auto id : my_batch.ids) cerr << " ndEdfs[" << cg.nodes[id]->args[ai] << "] == " << print_vec(as_vector(ndEdfs[cg.nodes[id]->args[ai]])); cerr << endl;
+            if (temp_pool != nullptr) temp_pool->free();
+            else pool->set_used(used);
+          // Contiguous
+          } else {
+            VariableIndex aid = cg.nodes[my_batch.ids[0]]->args[ai];
+            float* v = batched_ndEdfs[node2batch[aid]].v + node2offset[aid];
+            my_ndEdf.v = v;
+            for(auto id : my_batch.ids)
+              dests.push_back(node2batch[cg.nodes[id]->args[ai]]);
+            lock_dests();
+            node->backward(xs, my_batch.nfx, batched_ndEdfs[i], ai, my_ndEdf);
+            unlock_dests();
+            // cerr << "contig backward[" << i << "](" << ai << ")->" << node2batch[arg] << " == "; for(auto id : my_batch.ids) cerr << " ndEdfs[" << cg.nodes[id]->args[ai] << "] == " << print_vec(as_vector(ndEdfs[cg.nodes[id]->args[ai]])); cerr << endl;
+          }
+        }
+      }
+      ++ai;
+    }
+  }
+}
+
+void BatchedExecutionEngine::parallel_backward(VariableIndex num_batches,
+                                               vector<Tensor>& batched_ndEdfs,
+                                               const vector<bool>& needs_derivative,
+                                               const vector<bool>& in_computation) {
+  // get_nfx() fills nfx_cache lazily, so fill it before going parallel
+  for (VariableIndex bi = 0; bi < num_batches; ++bi)
+    for (auto id : batches[bi].ids)
+      get_nfx(id);
+
+  // A batch may run once every batch consuming one of its nodes has finished.
+  vector<unsigned> num_deps(num_batches, 0), succ_offsets(num_batches + 1, 0), succs;
+  vector<VariableIndex> dests;
+  for (VariableIndex bi = 0; bi < num_batches; ++bi) {
+    succ_offsets[bi] = succs.size();
+    if (!in_computation[bi]) continue;
+    dests.clear();
+    for (auto id : batches[bi].ids)
+      for (auto arg : cg.nodes[id]->args)
+        dests.push_back(node2batch[arg]);
+    sort(dests.begin(), dests.end());
+    dests.erase(unique(dests.begin(), dests.end()), dests.end());
+    for (auto d : dests) {
+      ++num_deps[d];
+      succs.push_back(d);
+    }
+  }
+  succ_offsets[num_batches] = succs.size();
+
+  // Temporaries for non-contiguous arguments come from the worker's own pool
+  // rather than from the shared DEDFS pool.
+  vector<vector<const Tensor*>> worker_xs(exec_threads_flag);
+  std::unique_ptr<std::mutex[]> batch_locks(new std::mutex[num_batches]);
+  run_dag_parallel(num_batches, num_deps, succ_offsets, succs,
+    [&](unsigned w, unsigned bi) {
+      if (!in_computation[bi] || !batch_grad_ready[bi]) return;
+      backward_batch(bi, batched_ndEdfs, needs_derivative, worker_xs[w],
+                     batch_locks.get(), parallel_context->temp[w]);
+    });
+}
+
+// Whether the nodes of run appear in ids consecutively and in the same order
+static bool contains_run(const vector<VariableIndex>& ids,
+                         const vector<VariableIndex>& run) {
+  auto it = find(ids.begin(), ids.end(), run[0]);
+  return (size_t)(ids.end() - it) >= run.size() && equal(run.begin(), run.end(), it);
+}
+
+void BatchedExecutionEngine::plan_placement(VariableIndex first_batch,
+                                            VariableIndex end_batch) {
+  for (VariableIndex bid = first_batch; bid < end_batch; ++bid)
+    batches[bid].group = -1;
+  // The orders in which consumers would like to read the members of each
+  // multi-node batch, and whether single node batches joined a group
+  vector<vector<vector<VariableIndex>>> demands(end_batch - first_batch);
+  vector<bool> grouped(end_batch - first_batch, false);
+  vector<VariableIndex> producers, sorted_producers;
+  // Consumers come after their producers, so going backwards, all demands on
+  // a batch are known when it is reached.
+  for (VariableIndex bid = end_batch; bid-- > first_batch; ) {
+    auto & batch_ids = batches[bid].ids;
+    if (batch_ids.size() < 2) continue;
+    // Pick the member order that satisfies the most consumers, keeping the
+    // original order on ties
+    auto & my_demands = demands[bid - first_batch];
+    size_t best_score = 0;
+    for (auto & run : my_demands)
+      best_score += contains_run(batch_ids, run);
+    // Candidates: each demand first, and all demands that do not overlap
+    // one laid out after the other
+    vector<VariableIndex> candidate, best;
+    for (size_t c = 0; c <= my_demands.size(); ++c) {
+      candidate.clear();
+      if (c < my_demands.size()) {
+        candidate = my_demands[c];
+      } else {
+        for (auto & run : my_demands) {
+          bool overlaps = false;
+          for (auto id : run)
+            overlaps = overlaps || find(candidate.begin(), candidate.end(), id) != candidate.end();
+          if (!overlaps)
+            candidate.insert(candidate.end(), run.begin(), run.end());
+        }
+      }
+      for (auto id : batch_ids)
+        if (find(candidate.begin(), candidate.end(), id) == candidate.end())
+          candidate.push_back(id);
+      size_t score = 0;
+      for (auto & other : my_demands)
+        score += contains_run(candidate, other);
+      if (score > best_score) {
+        best_score = score;
+        best.swap(candidate);
+      }
+    }
+    if (!best.empty())
+      batch_ids.swap(best);
+
+    // Record what this batch needs from its producers
+    const Node* exemplar = cg.nodes[batch_ids[0]];
+    const vector<int> concat = exemplar->autobatch_concat(cg);
+    for (size_t ai = 0; ai < concat.size(); ++ai) {
+      if (!concat[ai]) continue;
+      producers.clear();
+      bool usable = true;
+      for (auto id : batch_ids) {
+        const VariableIndex arg = cg.nodes[id]->args[ai];
+        usable = usable && node2batch[arg] >= first_batch &&
+            cg.nodes[arg]->device == exemplar->device;
+        producers.push_back(arg);
+      }
+      if (!usable) continue;
+      sorted_producers = producers;
+      sort(sorted_producers.begin(), sorted_producers.end());
+      if (adjacent_find(sorted_producers.begin(), sorted_producers.end()) !=
+          sorted_producers.end())
+        continue;
+      const VariableIndex pbid = node2batch[producers[0]];
+      bool same_batch = true;
+      for (auto p : producers)
+        same_batch = same_batch && node2batch[p] == pbid;
+      if (same_batch) {
+        if (batches[pbid].ids.size() > 1)
+          demands[pbid - first_batch].push_back(producers);
+        continue;
+      }
+      // Otherwise, if the producers are made of whole batches, one after the
+      // other, these batches can share one block
+      vector<pair<VariableIndex, size_t>> runs;  // batch, start in producers
+      bool whole_batches = true;
+      for (size_t k = 0; k < producers.size() && whole_batches; ) {
+        const VariableIndex b = node2batch[producers[k]];
+        const size_t len = batches[b].ids.size();
+        whole_batches = !grouped[b - first_batch] && k + len <= producers.size();
+        for (size_t l = k; l < k + len && whole_batches; ++l)
+          whole_batches = node2batch[producers[l]] == b;
+        for (auto & r : runs)
+          whole_batches = whole_batches && r.first != b;
+        runs.push_back(make_pair(b, k));
+        k += len;
+      }
+      if (!whole_batches) continue;
+      PlacementGroup group = {0, nullptr};
+      for (auto & r : runs) {
+        auto & producer = batches[r.first];
+        producer.group = placement_groups.size();
+        producer.group_offset = group.size;
+        grouped[r.first - first_batch] = true;
+        const size_t len = producer.ids.size();
+        for (size_t l = r.second; l < r.second + len; ++l)
+          group.size += node2size[producers[l]];
+        if (len > 1)
+          demands[r.first - first_batch].push_back(
+              vector<VariableIndex>(producers.begin() + r.second,
+                                    producers.begin() + r.second + len));
+      }
+      placement_groups.push_back(group);
+    }
+  }
+}
+
 const Tensor& BatchedExecutionEngine::get_nfx(VariableIndex i) {
   if(nfx_cache[i].v == nullptr) {
     const Tensor & bt = batches[node2batch[i]].nfx;
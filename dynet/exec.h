@@ -1,12 +1,60 @@
 #ifndef DYNET_EXEC_H
 #define DYNET_EXEC_H
 
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+
 #include "dynet/dynet.h"
 
 namespace dynet {
 
 class DeviceManager;
 
+/**
+ * \ingroup execution
+ * \brief Counters describing how the autobatching engine batched a graph
+ * \details They cover the forward calls since the graph was created or last
+ *          cleared, see ComputationGraph::autobatch_stats().
+ */
+struct AutobatchStats {
+  /**
+   * \brief The batches of one autobatch signature
+   */
+  struct Signature {
+    Signature() : type(nullptr), batches(0), nodes(0) {}
+    std::string op; /**< Name of the type of the nodes, e.g. "Tanh" */
+    const std::type_info* type; /**< Type of the nodes */
+    Dim dim; /**< Dimension of the first node */
+    unsigned batches; /**< Number of batches */
+    unsigned nodes; /**< Number of nodes in these batches */
+  };
+
+  AutobatchStats() { clear(); }
+  void clear();
+  /**
+   * \brief Average number of nodes per batch
+   */
+  double mean_batch_size() const { return batches ? (double)nodes / batches : 0.0; }
+
+  unsigned forward_calls; /**< Forward calls that planned batches */
+  unsigned cached_plans; /**< Of those, calls that reused a cached schedule */
+  double plan_ms; /**< Time spent planning batches, in milliseconds */
+  unsigned nodes; /**< Nodes executed */
+  unsigned batches; /**< Batches executed, including single nodes */
+  unsigned unbatchable_nodes; /**< Nodes of signature 0, which are never batched */
+  std::vector<unsigned> batch_sizes; /**< batch_sizes[n] is the number of batches of n nodes */
+  std::map<int, Signature> signatures; /**< Batches by autobatch signature */
+  size_t combine_bytes; /**< Bytes copied to concatenate the arguments of batches */
+  size_t accumulate_bytes; /**< Bytes of batched gradients copied back to the arguments */
+};
+
+std::ostream& operator<<(std::ostream& os, const AutobatchStats& stats);
+
 class ExecutionEngine {
  public:
   virtual ~ExecutionEngine();
@@ -24,6 +72,9 @@ class ExecutionEngine {
   virtual const Tensor& get_gradient(VariableIndex i) = 0;
   virtual void backward(bool full = false) = 0;
   virtual void backward(VariableIndex i, bool full = false) = 0;
+  // counters of the batches made so far, empty if the engine does not batch
+  virtual AutobatchStats autobatch_stats() const { return AutobatchStats(); }
+  virtual void clear_autobatch_stats() {}
  protected:
   explicit ExecutionEngine(const ComputationGraph& cg);
   DeviceManager* const device_manager;
@@ -34,7 +85,8 @@ class ExecutionEngine {
 class SimpleExecutionEngine : public ExecutionEngine {
  public:
   explicit SimpleExecutionEngine(const ComputationGraph& cg) :
-    ExecutionEngine(cg), num_nodes_evaluated(0) {}
+    ExecutionEngine(cg), num_nodes_evaluated(0), num_nodes_counted(0),
+    checkpoint_stride(0) {}
   void invalidate() override;
   void invalidate(unsigned i) override;
   const Tensor& forward() override;
@@ -46,32 +98,102 @@ class SimpleExecutionEngine : public ExecutionEngine {
   void backward(bool full = false) override;
   void backward(VariableIndex from_where, bool full = false) override;
  private:
+  void allocate_forward_memory(VariableIndex i);
+  void* allocate_fx(Device* device, size_t n);
+  // Evaluate nodes num_nodes_evaluated..upto on the execution thread pool,
+  // running independent nodes concurrently.
+  void parallel_forward(VariableIndex upto);
+  // Re-execute the evaluated nodes of a frozen graph in their existing memory
+  void replay();
+  // Run the backward pass over nodes 0..num_nodes-1 on the execution thread
+  // pool, starting each node once all of its consumers have finished.
+  void parallel_backward(unsigned num_nodes,
+                         const std::vector<bool>& needs_derivative);
+  // Pass the gradient of node->args[ai] on, overwriting the gradient buffer
+  // if this is the first gradient written to it
+  void backward_arg(const Node* node, const std::vector<const Tensor*>& xs,
+                    VariableIndex i, unsigned ai);
+  // Zero the gradient buffer of node i if nothing was written to it
+  void zero_unset_gradient(VariableIndex i);
+  // Evaluate nodes num_nodes_evaluated..upto for a graph in inference or
+  // remat mode, returning values that are no longer needed to the FXS free
+  // lists.
+  void liveness_forward(VariableIndex upto);
+  // Free the value of node i unless it has to be kept
+  void release_value(VariableIndex i);
+  void free_value(VariableIndex i);
+  // Recompute the freed value of node i, and recursively those of its
+  // arguments, from the values that were kept.
+  void rematerialize(VariableIndex i);
+  void check_not_released(VariableIndex i) const;
+  // Replace chains of elementwise nodes in num_nodes_evaluated..upto by
+  // FusedElementwise nodes (--dynet-fusion)
+  void plan_fusion(VariableIndex upto);
+  // Compute the value of a node that was fused away, and recursively those of
+  // its arguments
+  void materialize(VariableIndex i);
+  // The node that computes the value of node i
+  const Node* exec_node(VariableIndex i) const {
+    return i < fused.size() && fused[i] ? fused[i].get() : cg.nodes[i];
+  }
   std::vector<Tensor> nfxs;
   std::vector<Tensor> ndEdfs;
+  // Gradient memory is only initialized by the first write to it
+  std::vector<VariableIndex> grad_root;  // node owning the memory of a gradient
+  std::vector<char> grad_ready;  // by owning node, whether memory is initialized
   VariableIndex num_nodes_evaluated;
+  // Inference and remat mode bookkeeping
+  std::vector<std::unique_ptr<PoolFreeList>> free_lists;  // by device id
+  std::vector<unsigned> pending_uses;  // consumers of a node not yet computed
+  std::vector<VariableIndex> mem_root;  // node owning the memory of a value
+  std::vector<unsigned> live_sharers;  // live values using a node's memory
+  std::vector<bool> released, requested;
+  std::vector<bool> recomputed;  // values rematerialized by backward
+  VariableIndex num_nodes_counted;  // nodes whose arguments are in pending_uses
+  unsigned checkpoint_stride;  // automatic checkpoints in remat mode, 0=none
+  // Fusion bookkeeping
+  std::vector<std::unique_ptr<Node>> fused;  // replaces the last node of a chain
+  std::vector<bool> absorbed;  // values only computed inside a fused node
+  // nodes that were absorbed, even once their value was materialized, as
+  // their gradient is still only computed inside the fused node
+  std::vector<bool> fused_away;
 };
 
 struct BatchInfo {
 public:
-  BatchInfo() : pseudo_node(nullptr) { }
+  BatchInfo() : pseudo_node(nullptr), sig(0), group(-1), group_offset(0) { }
   // The forward tensor, may be null if singleton batch
   Tensor nfx;
   // The pseudo node used for calculation, also may be null if not needed
   Node* pseudo_node;
   // IDs of the batch components
   std::vector<VariableIndex> ids;
+  // Autobatch signature of the components
+  int sig;
   // 0=no need to concat
   // 1=need to concat
   // 2=need to concat + already contiguous in space
   std::vector<int> concat;
   // Concatenated arguments
   std::vector<const Tensor*> arg_nfxs;
+  // Placement group whose memory block holds the output of this batch, or
+  // -1, and the offset of the output within the block
+  int group;
+  size_t group_offset;
+};
+
+// Outputs of batches that a later batch concatenates, laid out next to each
+// other in one block so that they can be used in place
+struct PlacementGroup {
+  size_t size;  // in floats
+  float* v;     // forward memory, once allocated
 };
 
 class BatchedExecutionEngine : public ExecutionEngine {
  public:
   explicit BatchedExecutionEngine(const ComputationGraph& cg) :
-    ExecutionEngine(cg), num_nodes_evaluated(0), num_batches_evaluated(0) {}
+    ExecutionEngine(cg), num_nodes_evaluated(0), num_batches_evaluated(0),
+    accumulate_bytes(0) {}
   ~BatchedExecutionEngine() { garbage_collect(); }
   void invalidate() override;
   void invalidate(unsigned i) override;
@@ -83,24 +205,51 @@ class BatchedExecutionEngine : public ExecutionEngine {
   const Tensor& get_gradient(VariableIndex i) override;
   void backward(bool full = false) override;
   void backward(VariableIndex from_where, bool full = false) override;
+  AutobatchStats autobatch_stats() const override;
+  void clear_autobatch_stats() override;
   void garbage_collect();
  private:
   const Tensor& incremental_forward_no_update(VariableIndex upto,
                                               int autobatch_strategy);
+  // Re-execute the batches of the evaluated nodes of a frozen graph in their
+  // existing memory
+  void replay();
   void combine_tensors(const std::vector<VariableIndex>& batch_ids,
                        int aid, Tensor &tout);
   void accumulate_tensors(const Tensor& tin,
                           const std::vector<VariableIndex>& batch_ids,
                           int ai);
+  // Backward through batch i. When batch_locks is given, the locks of the
+  // batches receiving gradients are held while writing to them, and
+  // temporaries are taken from temp_pool instead of the DEDFS pool.
+  void backward_batch(VariableIndex i, std::vector<Tensor>& batched_ndEdfs,
+                      const std::vector<bool>& needs_derivative,
+                      std::vector<const Tensor*>& xs,
+                      std::mutex* batch_locks, AlignedMemoryPool* temp_pool);
+  void parallel_backward(VariableIndex num_batches,
+                         std::vector<Tensor>& batched_ndEdfs,
+                         const std::vector<bool>& needs_derivative,
+                         const std::vector<bool>& in_computation);
+  // Arrange the outputs that batches first_batch..end_batch-1 concatenate
+  // to be contiguous, by ordering the nodes within producer batches and by
+  // placing producer batches next to each other in placement groups.
+  void plan_placement(VariableIndex first_batch, VariableIndex end_batch);
   const Tensor& get_nfx(VariableIndex i);
   std::vector<Tensor> nfx_cache;
   std::vector<Tensor> ndEdfs;
+  // by batch, whether its gradient memory was zeroed; this happens lazily,
+  // right before the first gradient is written to it
+  std::vector<char> batch_grad_ready;
   VariableIndex num_nodes_evaluated, num_batches_evaluated;
   // Information about the batched computation graph
   std::vector<VariableIndex> node2batch; // length: number of nodes
   std::vector<size_t> node2offset, node2size; // length: number of nodes
   std::vector<BatchInfo> batches; // length: number of batches
+  std::vector<PlacementGroup> placement_groups;
   SigMap sigmap;
+  AutobatchStats stats;
+  // accumulate_tensors may run on several threads, so it counts separately
+  std::atomic<size_t> accumulate_bytes;
 };
 
 } // namespace dynet
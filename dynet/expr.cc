@@ -3,12 +3,24 @@
 #include <initializer_list>
 
 #include "dynet/nodes.h"
+#include "dynet/param-nodes.h"
 #include "dynet/devices.h"
 
 namespace dynet {
 
 using std::vector;
 
+// With --dynet-packed-weights, the parameter whose values are computed by x,
+// so that products by x can use its packed values, otherwise an empty one
+static Parameter packable_parameter(const Expression& x) {
+  if (packed_weights_flag) {
+    const Node* node = x.pg->nodes[x.i];
+    if (auto pnode = dynamic_cast<const ParameterNode*>(node)) return pnode->params;
+    if (auto cpnode = dynamic_cast<const ConstParameterNode*>(node)) return cpnode->params;
+  }
+  return Parameter();
+}
+
 std::string Expression::get_device_name() const {
   if (pg->nodes[i]->device == nullptr)
     throw std::runtime_error("Unknown device for node:" + std::to_string(i));
@@ -70,7 +82,7 @@ Expression operator+(const Expression& x, real y) { return y + x; }
 Expression operator-(const Expression& x, const Expression& y) { return x + (-y); }
 Expression operator-(real x, const Expression& y) { return Expression(y.pg, y.pg->add_function<ConstantMinusX>({y.i}, x)); }
 Expression operator-(const Expression& x, real y) { return -(y - x); }
-Expression operator*(const Expression& x, const Expression& y) { return Expression(x.pg, x.pg->add_function<MatrixMultiply>({x.i, y.i})); }
+Expression operator*(const Expression& x, const Expression& y) { return Expression(x.pg, x.pg->add_function<MatrixMultiply>({x.i, y.i}, packable_parameter(x))); }
 Expression operator*(const Expression& x, float y) { return Expression(x.pg, x.pg->add_function<ConstScalarMultiply>({x.i}, y)); }
 Expression operator/(const Expression& x, const Expression& y) { return Expression(x.pg, x.pg->add_function<CwiseQuotient>({x.i, y.i})); }
 Expression cmult(const Expression& x, const Expression& y) { return Expression(x.pg, x.pg->add_function<CwiseMultiply>({x.i, y.i})); }
@@ -296,6 +308,27 @@ Expression vanilla_lstm_c(const Expression& c_tm1, const Expression& gates_t){
 Expression vanilla_lstm_h(const Expression& c_t, const Expression& gates_t){
   return Expression(c_t.pg, c_t.pg->add_function<VanillaLSTMH>({c_t.i, gates_t.i}));
 }
+Expression gru_gates(const Expression& x_t, const Expression& h_tm1, const Expression& Wxz, const Expression& Whz, const Expression& bz, const Expression& Wxr, const Expression& Whr, const Expression& br){
+  return Expression(h_tm1.pg, h_tm1.pg->add_function<GRUGates>({x_t.i, h_tm1.i, Wxz.i, Whz.i, bz.i, Wxr.i, Whr.i, br.i}));
+}
+Expression gru_c(const Expression& x_t, const Expression& h_tm1, const Expression& gates_t, const Expression& Wxh, const Expression& Whh, const Expression& bh){
+  return Expression(h_tm1.pg, h_tm1.pg->add_function<GRUC>({x_t.i, h_tm1.i, gates_t.i, Wxh.i, Whh.i, bh.i}));
+}
+Expression gru_h(const Expression& h_tm1, const Expression& gates_t, const Expression& c_t){
+  return Expression(h_tm1.pg, h_tm1.pg->add_function<GRUH>({h_tm1.i, gates_t.i, c_t.i}));
+}
+Expression vanilla_lstm_sequence(const Expression& x, const Expression& h0, const Expression& c0, const Expression& Wx, const Expression& Wh, const Expression& b, const Expression& mask, real forget_gate_bias){
+  std::vector<VariableIndex> xis = {x.i, h0.i, c0.i, Wx.i, Wh.i, b.i};
+  if (mask.pg != nullptr) xis.push_back(mask.i);
+  return Expression(x.pg, x.pg->add_function<VanillaLSTMSequence>(xis, mask.pg != nullptr, false, forget_gate_bias));
+}
+Expression vanilla_lstm_sequence_dropout(const Expression& x, const Expression& h0, const Expression& c0, const Expression& Wx, const Expression& Wh, const Expression& b, const Expression& dropout_mask_x, const Expression& dropout_mask_h, const Expression& mask, real forget_gate_bias){
+  std::vector<VariableIndex> xis = {x.i, h0.i, c0.i, Wx.i, Wh.i, b.i};
+  if (mask.pg != nullptr) xis.push_back(mask.i);
+  xis.push_back(dropout_mask_x.i);
+  xis.push_back(dropout_mask_h.i);
+  return Expression(x.pg, x.pg->add_function<VanillaLSTMSequence>(xis, mask.pg != nullptr, true, forget_gate_bias));
+}
 
 Expression to_device(const Expression & x, Device *device) {
   DYNET_ASSERT(x.pg->nodes[x.i]->device != device, "It is unnecessary to perform to_device operation in the same devices");
@@ -306,8 +339,21 @@ Expression to_device(const Expression & x, Device *device) {
 // Functions with variable argument lengths   //
 ////////////////////////////////////////////////
 
-Expression affine_transform(const std::initializer_list<Expression> &xs) { return detail::f<AffineTransform>(xs); }
-Expression affine_transform(const std::vector<Expression> &xs) { return detail::f<AffineTransform>(xs); }
+template <typename T>
+static Expression affine_transform_impl(const T& xs) {
+  if (!packed_weights_flag) return detail::f<AffineTransform>(xs);
+  DYNET_ARG_CHECK(xs.size() > 0, "Zero-size argument passed to function");
+  ComputationGraph *pg = xs.begin()->pg;
+  vector<VariableIndex> xis;
+  vector<Parameter> lps;
+  for (auto & x : xs) {
+    lps.push_back(xis.size() % 2 == 1 ? packable_parameter(x) : Parameter());
+    xis.push_back(x.i);
+  }
+  return Expression(pg, pg->add_function<AffineTransform>(xis, lps));
+}
+Expression affine_transform(const std::initializer_list<Expression> &xs) { return affine_transform_impl(xs); }
+Expression affine_transform(const std::vector<Expression> &xs) { return affine_transform_impl(xs); }
 
 Expression sum(const std::initializer_list<Expression> &xs) { return detail::f<Sum>(xs); }
 Expression sum(const std::vector<Expression> &xs) { return detail::f<Sum>(xs); }
@@ -34,8 +34,9 @@ struct Expression {
   ComputationGraph *pg;
   VariableIndex i;
   unsigned graph_id;
+  unsigned graph_slot;
 
-  Expression() : pg(nullptr), i(0), graph_id(0) {}
+  Expression() : pg(nullptr), i(0), graph_id(0), graph_slot(0) {}
 
   /**
    * \brief Base expression constructor
@@ -45,12 +46,12 @@ struct Expression {
    * \param i Variable index
    */
   Expression(ComputationGraph *pg, VariableIndex i) : pg(pg),
-    i(i), graph_id(pg->get_id()) {}
+    i(i), graph_id(pg->get_id()), graph_slot(pg->get_slot()) {}
 
   std::string get_device_name() const;
 
   const bool is_stale() const {
-    return (get_number_of_active_graphs() != 1 || graph_id != get_current_graph_id());
+    return !is_graph_alive(graph_slot, graph_id);
   }
 
   /**
@@ -2638,6 +2639,85 @@ Expression vanilla_lstm_c(const Expression& c_tm1, const Expression& gates_t);
 
 Expression vanilla_lstm_h(const Expression& c_t, const Expression& gates_t);
 
+/**
+ * \ingroup lstm
+ * \brief Computes GRU gates
+ * \details Computes the update and reset gates of a GRU as follows:
+ *
+ *     gates_z = sigmoid (Wxz * x_t + Whz * h_tm1 + bz)
+ *     gates_r = sigmoid (Wxr * x_t + Whr * h_tm1 + br)
+ *
+ *     returns [gates_z]
+ *             [gates_r]
+ *
+ * \param x_t Input at current timestep (vector size I)
+ * \param h_tm1 h of previous timestep (vector size H)
+ * \param Wxz Parameter matrix size H x I
+ * \param Whz Parameter matrix size H x H
+ * \param bz Bias parameter size H
+ * \param Wxr Parameter matrix size H x I
+ * \param Whr Parameter matrix size H x H
+ * \param br Bias parameter size H
+ * \return An expression with dimensions 2H
+ */
+Expression gru_gates(const Expression& x_t, const Expression& h_tm1, const Expression& Wxz, const Expression& Whz, const Expression& bz, const Expression& Wxr, const Expression& Whr, const Expression& br);
+
+/**
+ * \ingroup lstm
+ * \brief Computes GRU candidate state
+ * \details Computes c_t = tanh(Wxh * x_t + Whh * (gates_r . h_tm1) + bh)
+ *
+ * \param x_t Input at current timestep (vector size I)
+ * \param h_tm1 h of previous timestep (vector size H)
+ * \param gates_t Gates at current timestep as computed by gru_gates (vector size 2H)
+ * \param Wxh Parameter matrix size H x I
+ * \param Whh Parameter matrix size H x H
+ * \param bh Bias parameter size H
+ * \return Vector size H
+ */
+Expression gru_c(const Expression& x_t, const Expression& h_tm1, const Expression& gates_t, const Expression& Wxh, const Expression& Whh, const Expression& bh);
+
+/**
+ * \ingroup lstm
+ * \brief Computes GRU hidden state
+ * \details Computes h_t = (1 - gates_z) . h_tm1 + gates_z . c_t
+ *
+ * \param h_tm1 h of previous timestep (vector size H)
+ * \param gates_t Gates at current timestep as computed by gru_gates (vector size 2H)
+ * \param c_t Candidate state as computed by gru_c (vector size H)
+ * \return Vector size H
+ */
+Expression gru_h(const Expression& h_tm1, const Expression& gates_t, const Expression& c_t);
+
+/**
+ * \ingroup lstm
+ * \brief Runs an LSTM over a whole sequence
+ * \details Computes the same states as vanilla_lstm_gates, vanilla_lstm_c and
+ *          vanilla_lstm_h applied at every timestep, but in a single node: the
+ *          input projections of all timesteps are one matrix multiplication,
+ *          and the recurrence runs in a tight loop, in the forward as well as
+ *          in the backward pass. Only implemented on CPU.
+ *
+ *          Where the mask is 0, the state is carried over from the previous
+ *          timestep (h_t = h_tm1, c_t = c_tm1), so batch elements of
+ *          different lengths can be padded to the same length, and the last
+ *          timestep holds the final state of every batch element.
+ *
+ * \param x Inputs, one column per timestep (size I x T)
+ * \param h0 Initial hidden state (vector size H)
+ * \param c0 Initial cell state (vector size H)
+ * \param Wx Parameter matrix size 4H x I
+ * \param Wh Parameter matrix size 4H x H
+ * \param b Bias parameter size 4H
+ * \param mask (optional) Vector of size T, 1 for the timesteps of each batch element and 0 for the padding
+ * \param dropout_mask_x Input dropout mask, size I
+ * \param dropout_mask_h Hidden state dropout mask, size H
+ * \param forget_gate_bias Value added to the forget gate
+ * \return An expression with dimensions H x T x 2: the hidden states, then the cell states of all timesteps
+ */
+Expression vanilla_lstm_sequence(const Expression& x, const Expression& h0, const Expression& c0, const Expression& Wx, const Expression& Wh, const Expression& b, const Expression& mask = Expression(), real forget_gate_bias = 1.f);
+Expression vanilla_lstm_sequence_dropout(const Expression& x, const Expression& h0, const Expression& c0, const Expression& Wx, const Expression& Wh, const Expression& b, const Expression& dropout_mask_x, const Expression& dropout_mask_h, const Expression& mask = Expression(), real forget_gate_bias = 1.f);
+
 }  // namespace dynet
 
 #endif
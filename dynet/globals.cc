@@ -13,6 +13,11 @@ Device* default_device = nullptr;
 float default_weight_decay_lambda;
 int autobatch_flag; 
 int profiling_flag = 0;
+int exec_threads_flag = 1;
+int fusion_flag = 0;
+int trim_mem_flag = 0;
+int batch_stats_flag = 0;
+int packed_weights_flag = 0;
 NamedTimer timer;
 
 }
@@ -38,10 +38,13 @@ bool check_grad(ParameterCollection& m, Expression& expr, int verbosity) {
     for (size_t i = 0; i < ts; ++i) {
       float old = TensorTools::access_element(p.values, i);
       TensorTools::set_element(p.values, i, old - alpha);
+      ++p.version;
       float E_left = as_scalar(g.forward(expr));
       TensorTools::set_element(p.values, i, old + alpha);
+      ++p.version;
       float E_right = as_scalar(g.forward(expr));
       TensorTools::set_element(p.values, i, old);
+      ++p.version;
       float g = (E_right - E_left) / (2 * alpha);
       float g_act = TensorTools::access_element(p.g, i);
       float f = fabs(g - g_act);
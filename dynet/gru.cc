@@ -102,45 +102,17 @@ Expression GRUBuilder::add_input_impl(int prev, const Expression& x) {
   Expression in = x;
   for (unsigned i = 0; i < layers; ++i) {
     const vector<Expression>& vars = param_vars[i];
+    if (dropout_rate) in = dropout(in, dropout_rate);
     Expression h_tprev;
-    // prev_zero means that h_tprev should be treated as 0
-    bool prev_zero = false;
-    if (prev >= 0 || has_initial_state) {
+    if (prev >= 0 || has_initial_state)
       h_tprev = (prev < 0) ? h0[i] : h[prev][i];
-    } else { prev_zero = true; }
-    if (dropout_rate) in = dropout(in, dropout_rate);
-    // update gate
-    Expression zt;
-    if (prev_zero)
-      zt = affine_transform({vars[BZ], vars[X2Z], in});
-    else
-      zt = affine_transform({vars[BZ], vars[X2Z], in, vars[H2Z], h_tprev});
-    zt = logistic(zt);
-    // forget
-    Expression ft = 1.f - zt;
-    // reset gate
-    Expression rt;
-    if (prev_zero)
-      rt = affine_transform({vars[BR], vars[X2R], in});
-    else
-      rt = affine_transform({vars[BR], vars[X2R], in, vars[H2R], h_tprev});
-    rt = logistic(rt);
-
+    else  // the initial state defaults to zero
+      h_tprev = zeros(*in.pg, Dim({hidden_dim}, in.dim().bd));
+    // update and reset gates
+    Expression gates_t = gru_gates(in, h_tprev, vars[X2Z], vars[H2Z], vars[BZ], vars[X2R], vars[H2R], vars[BR]);
     // candidate activation
-    Expression ct;
-    if (prev_zero) {
-      ct = affine_transform({vars[BH], vars[X2H], in});
-      ct = tanh(ct);
-      Expression nwt = cmult(zt, ct);
-      in = ht[i] = nwt;
-    } else {
-      Expression ght = cmult(rt, h_tprev);
-      ct = affine_transform({vars[BH], vars[X2H], in, vars[H2H], ght});
-      ct = tanh(ct);
-      Expression nwt = cmult(zt, ct);
-      Expression crt = cmult(ft, h_tprev);
-      in = ht[i] = crt + nwt;
-    }
+    Expression ct = gru_c(in, h_tprev, gates_t, vars[X2H], vars[H2H], vars[BH]);
+    in = ht[i] = gru_h(h_tprev, gates_t, ct);
   }
   if (dropout_rate) return dropout(ht.back(), dropout_rate);
   else return ht.back();
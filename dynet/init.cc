@@ -6,6 +6,7 @@
 #include "dynet/globals.h"
 #include "dynet/str-util.h"
 #include "dynet/devices.h"
+#include "dynet/profiler.h"
 
 #include <iostream>
 #include <random>
@@ -20,7 +21,8 @@ using namespace std;
 
 namespace dynet {
 
-DynetParams::DynetParams() : random_seed(0), mem_descriptor("512"), weight_decay(0), autobatch(0), profiling(0),
+DynetParams::DynetParams() : random_seed(0), mem_descriptor("512"), weight_decay(0), autobatch(0), profiling(0), exec_threads(1), fusion(0),
+  hugepages_descriptor("0"), numa_node(-1), mem_align(0), trim_mem(0), batch_stats(0), packed_weights(0), cpu_threads(1),
   shared_parameters(false), ngpus_requested(false), ids_requested(false), cpu_requested(false), requested_gpus(-1)
 {
 #if HAVE_CUDA
@@ -147,6 +149,126 @@ DynetParams extract_dynet_params(int& argc,
       }
     }
 
+    // Trace of the profiled events
+    else if (startswith(arg, "--dynet-trace") ||
+             startswith(arg, "--dynet_trace")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-trace expects an argument (the file the trace is written to)");
+      } else {
+        params.trace_file = get_arg(argi, argv);
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Threads used to execute independent nodes
+    else if (startswith(arg, "--dynet-exec-threads") ||
+             startswith(arg, "--dynet_exec_threads")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-exec-threads expects an argument (the number of threads)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.exec_threads;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Fusion of elementwise operations
+    else if (startswith(arg, "--dynet-fusion") ||
+             startswith(arg, "--dynet_fusion")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-fusion expects an argument (0 for none 1 for on)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.fusion;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Huge pages for the CPU memory pools
+    else if (startswith(arg, "--dynet-hugepages") ||
+             startswith(arg, "--dynet_hugepages")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-hugepages expects an argument (0 for none, 1 for transparent, 2 for explicit huge pages)");
+      } else {
+        params.hugepages_descriptor = get_arg(argi, argv);
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // NUMA node of the CPU memory pools
+    else if (startswith(arg, "--dynet-numa-node") ||
+             startswith(arg, "--dynet_numa_node")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-numa-node expects an argument (the NUMA node to allocate memory on)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.numa_node;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Alignment of CPU memory
+    else if (startswith(arg, "--dynet-align") ||
+             startswith(arg, "--dynet_align")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-align expects an argument (the alignment of CPU memory, in bytes)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.mem_align;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Shrinking of memory pools
+    else if (startswith(arg, "--dynet-trim-mem") ||
+             startswith(arg, "--dynet_trim_mem")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-trim-mem expects an argument (0 for none 1 for on)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.trim_mem;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Autobatching statistics
+    else if (startswith(arg, "--dynet-batch-stats") ||
+             startswith(arg, "--dynet_batch_stats")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-batch-stats expects an argument (0 for none 1 for on)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.batch_stats;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Packed parameters
+    else if (startswith(arg, "--dynet-packed-weights") ||
+             startswith(arg, "--dynet_packed_weights")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-packed-weights expects an argument (0 for none 1 for on)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.packed_weights;
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
+    // Threads of the CPU device
+    else if (startswith(arg, "--dynet-cpu-threads") ||
+             startswith(arg, "--dynet_cpu_threads")) {
+      if (!has_arg(argi, argc, argv)) {
+        throw std::invalid_argument("[dynet] --dynet-cpu-threads expects an argument (number of threads)");
+      } else {
+        string a2 = get_arg(argi, argv);
+        istringstream c(a2); c >> params.cpu_threads;
+        if (params.cpu_threads < 1)
+          throw std::invalid_argument("[dynet] --dynet-cpu-threads expects a positive number of threads, got " + a2);
+        remove_args(argc, argv, argi, 2);
+      }
+    }
+
 #if HAVE_CUDA
     else if (startswith(arg, "--dynet-gpus") ||
              startswith(arg, "--dynet_gpus")) {
@@ -252,19 +374,75 @@ void initialize(DynetParams& params) {
     cerr << "[dynet] using autobatching" << endl;
   autobatch_flag = params.autobatch;
   
+  if (!params.trace_file.empty() && params.profiling == 0)
+    params.profiling = 1;
   if(params.profiling)
     cerr << "[dynet] using profiling level " << params.profiling << endl;
   profiling_flag = params.profiling;
+  if (profiling_flag) {
+    profiler.reserve();
+    profiler.trace_file = params.trace_file;
+    if (!params.trace_file.empty())
+      cerr << "[dynet] writing the profile trace to " << params.trace_file << endl;
+  }
+
+  // Set number of execution threads
+  if (params.exec_threads < 1)
+    throw std::invalid_argument("[dynet] number of execution threads must be at least 1\n");
+  if (params.exec_threads > 1)
+    cerr << "[dynet] executing independent nodes on " << params.exec_threads << " threads" << endl;
+  exec_threads_flag = params.exec_threads;
+
+  // Set fusion
+  if (params.fusion)
+    cerr << "[dynet] fusing elementwise operations" << endl;
+  fusion_flag = params.fusion;
+
+  // Set trimming of memory pools
+  if (params.trim_mem)
+    cerr << "[dynet] trimming memory pools" << endl;
+  trim_mem_flag = params.trim_mem;
+
+  // Set printing of autobatching statistics
+  if (params.batch_stats)
+    cerr << "[dynet] printing autobatching statistics of each graph" << endl;
+  batch_stats_flag = params.batch_stats;
+
+  // Set packing of parameters. The packed copies of each process would not
+  // see the updates made by other processes to shared parameters.
+  if (params.packed_weights && params.shared_parameters) {
+    cerr << "[dynet] packed parameters are not supported with shared parameters, ignoring --dynet-packed-weights" << endl;
+    params.packed_weights = 0;
+  }
+  if (params.packed_weights)
+    cerr << "[dynet] packing parameters multiplied by a few columns" << endl;
+  packed_weights_flag = params.packed_weights;
 
   // Allocate memory
   cerr << "[dynet] allocating memory: " << params.mem_descriptor << "MB\n";
   int default_index = 0;
 
+  CPUMemoryOptions cpu_mem_opts(params.hugepages_descriptor, params.numa_node,
+                                params.mem_align > 0 ? params.mem_align : CPUMemoryOptions().align);
+  if (params.hugepages_descriptor != "0")
+    cerr << "[dynet] using huge pages for CPU memory: " << params.hugepages_descriptor << endl;
+  if (params.numa_node >= 0)
+    cerr << "[dynet] binding CPU memory to NUMA node " << params.numa_node << endl;
+
+  // Set threads of the CPU device. Processes forked to share parameters
+  // would not have the threads of the pool.
+  if (params.cpu_threads > 1 && params.shared_parameters) {
+    cerr << "[dynet] multiple CPU threads are not supported with shared parameters, ignoring --dynet-cpu-threads" << endl;
+    params.cpu_threads = 1;
+  }
+  if (params.cpu_threads > 1)
+    cerr << "[dynet] running operations on " << params.cpu_threads << " CPU threads" << endl;
+
   Device *d;
   if (gpudevices.size()) {
-    d = new Device_CPU(device_manager->num_devices(), std::string("128"), params.shared_parameters);
+    d = new Device_CPU(device_manager->num_devices(), std::string("128"), params.shared_parameters, cpu_mem_opts, params.cpu_threads);
   } else {
-    d = new Device_CPU(device_manager->num_devices(), params.mem_descriptor, params.shared_parameters);
+    d = new Device_CPU(device_manager->num_devices(), params.mem_descriptor, params.shared_parameters, cpu_mem_opts, params.cpu_threads);
   }
   device_manager->add(d);
   default_device = device_manager->get(default_index);
@@ -9,6 +9,11 @@ namespace dynet {
 extern float default_weight_decay_lambda;
 extern int autobatch_flag;
 extern int profiling_flag;
+extern int exec_threads_flag;
+extern int fusion_flag;
+extern int trim_mem_flag;
+extern int batch_stats_flag;
+extern int packed_weights_flag;
 
 /**
  * \brief Represents general parameters for dynet
@@ -22,6 +27,16 @@ struct DynetParams {
   float weight_decay; /**< Weight decay rate for L2 regularization */
   int autobatch; /**< Whether to autobatch or not */
   int profiling; /**< Whether to show autobatch debug info or not */
+  std::string trace_file; /**< File the profiled events are written to at exit, or empty */
+  int exec_threads; /**< Number of threads used to execute independent nodes */
+  int fusion; /**< Whether to fuse chains of elementwise operations */
+  std::string hugepages_descriptor; /**< Huge page modes of the CPU memory pools */
+  int numa_node; /**< NUMA node the CPU memory pools are bound to, or -1 */
+  int mem_align; /**< Alignment of CPU memory in bytes, or 0 for the default */
+  int trim_mem; /**< Whether memory pools shrink after unusually large graphs */
+  int batch_stats; /**< Whether autobatching statistics are printed for each graph */
+  int packed_weights; /**< Whether products of parameters by a few columns use cached packed parameters */
+  int cpu_threads; /**< Number of threads running each operation on CPU */
   bool shared_parameters; /**< TO DOCUMENT */
   bool ngpus_requested; /**< GPUs requested by number */
   bool ids_requested; /**< GPUs requested by ids */
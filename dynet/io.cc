@@ -173,6 +173,7 @@ void TextFileLoader::populate(ParameterCollection & model, const std::string & k
                             ") do not match parameters to be populated (" << param.dim << ")");
       value_t = &param.values;
       grad_t = &param.g;
+      ++param.version;
     // Load a lookup parameter
     } else if(type == "#LookupParameter#") {
       values.resize(dim.size());
@@ -220,6 +221,7 @@ void TextFileLoader::populate(Parameter & param,
       std::vector<float> values(dim.size());
       { std::getline(datastream, line); std::istringstream iss(line); iss >> values; }
       TensorTools::set_elements(param.get_storage().values, values);
+      ++param.get_storage().version;
       if(!zero_grad){
         { std::getline(datastream, line); std::istringstream iss(line); iss >> values; }
         TensorTools::set_elements(param.get_storage().g, values);
@@ -286,6 +288,7 @@ Parameter TextFileLoader::load_param(ParameterCollection & model,
       std::vector<float> values(dim.size());
       { std::getline(datastream, line); std::istringstream iss(line); iss >> values; }
       TensorTools::set_elements(param.get_storage().values, values);
+      ++param.get_storage().version;
       if(!zero_grad){
         { std::getline(datastream, line); std::istringstream iss(line); iss >> values; }
         TensorTools::set_elements(param.get_storage().g, values);
@@ -311,6 +311,46 @@ void CoupledLSTMBuilder::disable_dropout() {
 
 //enum { _X2I, _H2I, _C2I, _BI, _X2F, _H2F, _C2F, _BF, _X2O, _H2O, _C2O, _BO, _X2G, _H2G, _C2G, _BG };
 enum { _X2I, _H2I, _BI, _X2F, _H2F, _BF, _X2O, _H2O, _BO, _X2G, _H2G, _BG };
+
+// Runs the layers of a vanilla LSTM over a whole sequence with one
+// vanilla_lstm_sequence node per layer, and stores the state at the end of the
+// sequence in ht and ct. h_tm1 and c_tm1 are empty if the state is zero.
+static Expression lstm_sequence(ComputationGraph& cg, const Expression& x, const vector<unsigned>& lengths,
+                                const vector<vector<Expression>>& param_vars, const vector<vector<Expression>>& masks,
+                                const vector<Expression>& h_tm1, const vector<Expression>& c_tm1,
+                                unsigned hid, float forget_bias, vector<Expression>& ht, vector<Expression>& ct) {
+  const unsigned seq_len = x.dim()[1], batch_size = x.dim().bd;
+  Expression mask;
+  if (!lengths.empty()) {
+    DYNET_ARG_CHECK(lengths.size() == batch_size,
+                    "add_input_sequence expects one length per batch element, but got "
+                    << lengths.size() << " lengths for a batch of " << batch_size);
+    vector<float> mask_vals(seq_len * batch_size, 0.f);
+    for (unsigned b = 0; b < batch_size; ++b) {
+      DYNET_ARG_CHECK(lengths[b] <= seq_len,
+                      "add_input_sequence: length " << lengths[b] << " is longer than the sequence (" << seq_len << ")");
+      fill(mask_vals.begin() + b * seq_len, mask_vals.begin() + b * seq_len + lengths[b], 1.f);
+    }
+    mask = input(cg, Dim({seq_len}, batch_size), mask_vals);
+  }
+  Expression in = x;
+  for (unsigned i = 0; i < param_vars.size(); ++i) {
+    const vector<Expression>& vars = param_vars[i];
+    Expression h0 = h_tm1.empty() ? zeros(cg, Dim({hid})) : h_tm1[i];
+    Expression c0 = c_tm1.empty() ? zeros(cg, Dim({hid})) : c_tm1[i];
+    Expression y;
+    if (masks.empty())
+      y = vanilla_lstm_sequence(in, h0, c0, vars[_X2I], vars[_H2I], vars[_BI], mask, forget_bias);
+    else
+      y = vanilla_lstm_sequence_dropout(in, h0, c0, vars[_X2I], vars[_H2I], vars[_BI], masks[i][0], masks[i][1], mask, forget_bias);
+    // the hidden states are the first seq_len columns, the cell states the others
+    Expression states = reshape(y, Dim({hid, 2 * seq_len}, batch_size));
+    ht[i] = pick(states, seq_len - 1, 1);
+    ct[i] = pick(states, 2 * seq_len - 1, 1);
+    in = pick_range(states, 0, seq_len, 1);
+  }
+  return in;
+}
 enum { LN_GH, LN_BH, LN_GX, LN_BX, LN_GC, LN_BC};
 
 
@@ -545,6 +585,21 @@ Expression VanillaLSTMBuilder::add_input_impl(int prev, const Expression& x) {
   return ht.back();
 }
 
+Expression VanillaLSTMBuilder::add_input_sequence_impl(int prev, const Expression& x, const vector<unsigned>& lengths) {
+  DYNET_ARG_CHECK(!ln_lstm, "VanillaLSTMBuilder::add_input_sequence does not support layer normalization");
+  const bool use_dropout = dropout_rate > 0.f || dropout_rate_h > 0.f;
+  if (use_dropout && !dropout_masks_valid) set_dropout_masks(x.dim().bd);
+  const vector<vector<Expression>> no_masks;
+  const vector<Expression> no_state;
+  const vector<Expression>& h_tm1 = prev >= 0 ? h[prev] : (has_initial_state ? h0 : no_state);
+  const vector<Expression>& c_tm1 = prev >= 0 ? c[prev] : (has_initial_state ? c0 : no_state);
+  vector<Expression> ht(layers), ct(layers);
+  Expression y = lstm_sequence(*_cg, x, lengths, param_vars, use_dropout ? masks : no_masks, h_tm1, c_tm1, hid, forget_bias, ht, ct);
+  h.push_back(ht);
+  c.push_back(ct);
+  return y;
+}
+
 void VanillaLSTMBuilder::copy(const RNNBuilder & rnn) {
   const VanillaLSTMBuilder & rnn_lstm = (const VanillaLSTMBuilder&)rnn;
   DYNET_ARG_CHECK(params.size() == rnn_lstm.params.size(),
@@ -1079,6 +1134,21 @@ Expression CompactVanillaLSTMBuilder::add_input_impl(int prev, const Expression&
   return ht.back();
 }
 
+Expression CompactVanillaLSTMBuilder::add_input_sequence_impl(int prev, const Expression& x, const vector<unsigned>& lengths) {
+  DYNET_ARG_CHECK(weightnoise_std == 0.f, "CompactVanillaLSTMBuilder::add_input_sequence does not support weight noise");
+  const bool use_dropout = dropout_rate > 0.f || dropout_rate_h > 0.f;
+  if (use_dropout && !dropout_masks_valid) set_dropout_masks(x.dim().bd);
+  const vector<vector<Expression>> no_masks;
+  const vector<Expression> no_state;
+  const vector<Expression>& h_tm1 = prev >= 0 ? h[prev] : (has_initial_state ? h0 : no_state);
+  const vector<Expression>& c_tm1 = prev >= 0 ? c[prev] : (has_initial_state ? c0 : no_state);
+  vector<Expression> ht(layers), ct(layers);
+  Expression y = lstm_sequence(*_cg, x, lengths, param_vars, use_dropout ? masks : no_masks, h_tm1, c_tm1, hid, 1.f, ht, ct);
+  h.push_back(ht);
+  c.push_back(ct);
+  return y;
+}
+
 void CompactVanillaLSTMBuilder::copy(const RNNBuilder & rnn) {
   const CompactVanillaLSTMBuilder & rnn_lstm = (const CompactVanillaLSTMBuilder&)rnn;
   DYNET_ARG_CHECK(params.size() == rnn_lstm.params.size(),
@@ -6,6 +6,7 @@
 #include "dynet/devices.h"
 #include "dynet/dynet.h"
 #include "dynet/nodes-def-macros.h"
+#include "dynet/packed-gemm.h"
 
 #ifdef __CUDACC__
 
@@ -36,12 +37,34 @@ inline void MatrixMultiply(const Device_GPU & dev, const Tensor& l, const Tensor
   }
 }
 
+// Packed parameters are only used on CPU
+inline void MatrixMultiply(const Device_GPU & dev, const Parameter & lp, const Tensor& l, const Tensor& r, Tensor& y, const float* acc_scalar) {
+  MatrixMultiply(dev, l, r, y, acc_scalar);
+}
+
 }
 
 #else
 
 namespace dynet {
 
+// Calls f(begin, end) on blocks of [0, n) in parallel on the threads of the
+// device, where each of the n items (e.g. rows of a product) costs about
+// flops operations, and blocks are multiples of align items. MKL runs its
+// products on its own threads instead.
+template <class F>
+inline void CPUParallelFor(const Device_CPU & dev, Eigen::Index n, double flops, Eigen::Index align, F f) {
+#ifndef __INTEL_MKL__
+  if(dev.edevice->numThreads() > 1 && n > align) {
+    dev.edevice->parallelFor(n, Eigen::TensorOpCost(0, 0, flops),
+                             [align](Eigen::Index size) { return (size + align - 1) / align * align; },
+                             [&f](Eigen::Index begin, Eigen::Index end) { f(begin, end); });
+    return;
+  }
+#endif
+  f(0, n);
+}
+
 inline void MatrixMultiply(const Device_CPU & dev, const Tensor& l, const Tensor& r, Tensor& y, const float* acc_scalar) {
 
   tbvec(y).device(*dev.edevice) = *acc_scalar * tbvec(y);
@@ -51,7 +74,11 @@ inline void MatrixMultiply(const Device_CPU & dev, const Tensor& l, const Tensor
       // If the left side has one batch, multiply by columns
       // [x, z, b] = [x, y] * [y, z, b]
       // -> [x, z*b] = [x, y], [y, z*b]
-      colbatch_matrix(y).noalias() += mat(l) * colbatch_matrix(r);
+      // split by rows of the result
+      const double flops = 2.0 * l.d.cols() * y.d.cols() * y.d.bd;
+      CPUParallelFor(dev, y.d.rows(), flops, 16, [&](Eigen::Index begin, Eigen::Index end) {
+        colbatch_matrix(y).middleRows(begin, end - begin).noalias() += mat(l).middleRows(begin, end - begin) * colbatch_matrix(r);
+      });
 
   } else {
     #ifdef __INTEL_MKL__
@@ -83,12 +110,28 @@ inline void MatrixMultiply(const Device_CPU & dev, const Tensor& l, const Tensor
             grp_count, size_per_grp);
     #else
       // Otherwise, loop over the batches
-      for(unsigned b = 0; b < y.d.bd; ++b)
-        batch_matrix(y, b).noalias() += batch_matrix(l, b) * batch_matrix(r, b);
+      const double flops = 2.0 * y.d.rows() * y.d.cols() * l.d.cols();
+      CPUParallelFor(dev, y.d.bd, flops, 1, [&](Eigen::Index begin, Eigen::Index end) {
+        for(unsigned b = begin; b < end; ++b)
+          batch_matrix(y, b).noalias() += batch_matrix(l, b) * batch_matrix(r, b);
+      });
     #endif
   }
 }
 
+// Same as above, where l holds the values of the parameter lp (scaled by its
+// weight decay) or lp is empty. Products of parameters by a few columns use
+// the packed values cached by the parameter instead of repacking l.
+inline void MatrixMultiply(const Device_CPU & dev, const Parameter & lp, const Tensor& l, const Tensor& r, Tensor& y, const float* acc_scalar) {
+  const unsigned n = r.d.cols() * r.d.bd;
+  if(lp.p != nullptr && l.d.bd == 1 && r.d.bd == y.d.bd && n >= 2 && n <= PackedMatrix::kMaxCols) {
+    tbvec(y).device(*dev.edevice) = *acc_scalar * tbvec(y);
+    lp.get_storage().packed_values(lp.current_weight_decay())->multiply_acc(r.v, n, y.v);
+  } else {
+    MatrixMultiply(dev, l, r, y, acc_scalar);
+  }
+}
+
 }
 
 #endif
@@ -121,7 +164,11 @@ inline void MatrixTranspMultiplyAcc(const dynet::Device_CPU & dev, const dynet::
   // computes l^T * r
   int max_b = std::max(l.d.bd, r.d.bd);
   if(l.d.bd == 1 && y.d.bd == r.d.bd) {
-    colbatch_matrix(y).noalias() += mat(l).transpose() * colbatch_matrix(r);
+    // split by rows of the result (columns of l)
+    const double flops = 2.0 * l.d.rows() * y.d.cols() * y.d.bd;
+    dynet::CPUParallelFor(dev, y.d.rows(), flops, 16, [&](Eigen::Index begin, Eigen::Index end) {
+      colbatch_matrix(y).middleRows(begin, end - begin).noalias() += mat(l).middleCols(begin, end - begin).transpose() * colbatch_matrix(r);
+    });
   } else {
     #ifdef __INTEL_MKL__
       // grp_cout is 1 as matrices in a batch have equal shape
@@ -151,8 +198,12 @@ inline void MatrixTranspMultiplyAcc(const dynet::Device_CPU & dev, const dynet::
             dev.kSCALAR_ONE, c_array, ldc,
             grp_count, size_per_grp);
     #else
-      for(int b = 0; b < max_b; ++b)
-        batch_matrix(y, b).noalias() += batch_matrix(l, b).transpose() * batch_matrix(r, b);
+      const double flops = 2.0 * y.d.rows() * y.d.cols() * l.d.rows();
+      // batches accumulating into the same result are not split
+      dynet::CPUParallelFor(dev, max_b, flops, y.d.bd > 1 ? 1 : max_b, [&](Eigen::Index begin, Eigen::Index end) {
+        for(int b = begin; b < end; ++b)
+          batch_matrix(y, b).noalias() += batch_matrix(l, b).transpose() * batch_matrix(r, b);
+      });
     #endif
   }
 }
@@ -183,7 +234,11 @@ inline void MatrixMultiplyTranspAcc(const dynet::Device_GPU & dev, const dynet::
 inline void MatrixMultiplyTranspAcc(const dynet::Device_CPU & dev, const dynet::Tensor& l, const dynet::Tensor& r, dynet::Tensor& y) {
   int max_b = std::max(l.d.bd, r.d.bd);
   if(y.d.bd == 1 && (l.d.bd == r.d.bd)) {
-    mat(y).noalias() += colbatch_matrix(l) * colbatch_matrix(r).transpose();
+    // split by rows of the result (rows of l)
+    const double flops = 2.0 * y.d.cols() * l.d.cols() * l.d.bd;
+    dynet::CPUParallelFor(dev, y.d.rows(), flops, 16, [&](Eigen::Index begin, Eigen::Index end) {
+      mat(y).middleRows(begin, end - begin).noalias() += colbatch_matrix(l).middleRows(begin, end - begin) * colbatch_matrix(r).transpose();
+    });
   } else {
     #ifdef __INTEL_MKL__
       // grp_cout is 1 as matrices in a batch have equal shape
@@ -213,8 +268,12 @@ inline void MatrixMultiplyTranspAcc(const dynet::Device_CPU & dev, const dynet::
             dev.kSCALAR_ONE, c_array, ldc,
             grp_count, size_per_grp);
     #else
-      for(int b = 0; b < max_b; ++b)
-        batch_matrix(y, b).noalias() += batch_matrix(l, b) * batch_matrix(r, b).transpose();
+      const double flops = 2.0 * y.d.rows() * y.d.cols() * l.d.cols();
+      // batches accumulating into the same result are not split
+      dynet::CPUParallelFor(dev, max_b, flops, y.d.bd > 1 ? 1 : max_b, [&](Eigen::Index begin, Eigen::Index end) {
+        for(int b = begin; b < end; ++b)
+          batch_matrix(y, b).noalias() += batch_matrix(l, b) * batch_matrix(r, b).transpose();
+      });
     #endif
   }
 }
@@ -7,6 +7,10 @@
 #include <sys/shm.h>
 #include <sys/mman.h>
 #endif
+#if __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include <fcntl.h>
 #if !_WINDOWS
@@ -24,8 +28,35 @@ using namespace std;
 
 namespace dynet {
 
+// blocks of at least this size are mapped from the OS instead of malloc'ed
+static const size_t kMinMappedSize = 1 << 20;
+static const size_t kHugePageSize = 1 << 21;
+
+#if !_WINDOWS
+// Sets the memory policy of a mapping that hasn't been touched yet, so that
+// its pages are allocated on the given NUMA node
+static void bind_to_numa_node(void* p, size_t n, int node) {
+#if __linux__ && defined(SYS_mbind)
+  const int kMpolBind = 2;  // MPOL_BIND in <linux/mempolicy.h>
+  const size_t kBits = 8 * sizeof(unsigned long);
+  unsigned long mask[1024 / kBits] = {0};
+  mask[node / kBits] |= 1UL << (node % kBits);
+  if (syscall(SYS_mbind, p, n, kMpolBind, mask, (unsigned long)(1024 + 1), 0) != 0)
+    cerr << "[dynet] could not bind memory to NUMA node " << node << endl;
+#else
+  cerr << "[dynet] binding memory to NUMA nodes is not supported on this platform" << endl;
+#endif
+}
+#endif
+
 MemAllocator::~MemAllocator() {}
 
+void* MemAllocator::malloc_zeroed(size_t n) {
+  void* ptr = malloc(n);
+  zero(ptr, n);
+  return ptr;
+}
+
 void* CPUAllocator::malloc(size_t n) {
   void* ptr = _mm_malloc(n, align);
   if (!ptr) {
@@ -36,7 +67,53 @@ void* CPUAllocator::malloc(size_t n) {
   return ptr;
 }
 
+void* CPUAllocator::malloc_zeroed(size_t n) {
+#if !_WINDOWS
+  if (n >= kMinMappedSize) {
+    // only reserves address space: pages are committed by the OS (already
+    // zeroed) on first access, i.e. as the memory pools hand them out
+    void* ptr = MAP_FAILED;
+    size_t len = n;
+#ifdef MAP_HUGETLB
+    if (huge_pages == HugePages::EXPLICIT) {
+      // reserved, so that this fails instead of faulting later if the system
+      // doesn't have enough huge pages
+      len = (n + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+      ptr = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON|MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (ptr == MAP_FAILED) {
+      len = n;
+      ptr = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON|MAP_NORESERVE, -1, 0);
+#ifdef MADV_HUGEPAGE
+      if (ptr != MAP_FAILED && huge_pages != HugePages::NONE)
+        madvise(ptr, len, MADV_HUGEPAGE);
+#endif
+    }
+    if (ptr != MAP_FAILED) {
+      if (numa_node >= 0)
+        bind_to_numa_node(ptr, len, numa_node);
+      lock_guard<mutex> lk(mtx);
+      mapped[ptr] = len;
+      return ptr;
+    }
+  }
+#endif
+  return MemAllocator::malloc_zeroed(n);
+}
+
 void CPUAllocator::free(void* mem) {
+#if !_WINDOWS
+  {
+    lock_guard<mutex> lk(mtx);
+    auto it = mapped.find(mem);
+    if (it != mapped.end()) {
+      munmap(mem, it->second);
+      mapped.erase(it);
+      return;
+    }
+  }
+#endif
   _mm_free(mem);
 }
 
@@ -59,6 +136,11 @@ void* SharedAllocator::malloc(size_t n) {
 #endif
 }
 
+void* SharedAllocator::malloc_zeroed(size_t n) {
+  // fresh mappings are zero-filled
+  return malloc(n);
+}
+
 void SharedAllocator::free(void* mem) {
 //  munmap(mem, n);
 }
@@ -1,6 +1,8 @@
 #ifndef DYNET_MEM_H
 #define DYNET_MEM_H
 
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace dynet {
@@ -14,6 +16,9 @@ struct MemAllocator {
   MemAllocator& operator=(const MemAllocator&) = delete;
   virtual ~MemAllocator();
   virtual void* malloc(std::size_t n) = 0;
+  // allocates zeroed memory; allocators that get memory which is zero already
+  // (e.g. fresh pages from the OS) don't write to it
+  virtual void* malloc_zeroed(std::size_t n);
   virtual void free(void* mem) = 0;
   virtual void zero(void* p, std::size_t n) = 0;
   inline std::size_t round_up_align(std::size_t n) const {
@@ -23,16 +28,35 @@ struct MemAllocator {
   const int align;
 };
 
+/*
+ * How the large blocks of a CPU allocator (i.e. the memory pools) are backed:
+ * NONE        -> normal pages
+ * TRANSPARENT -> transparent huge pages
+ * EXPLICIT    -> huge pages reserved by the OS (hugetlbfs), or transparent
+ *                huge pages if none are available
+ */
+enum class HugePages {NONE = 0, TRANSPARENT = 1, EXPLICIT = 2};
+
 struct CPUAllocator : public MemAllocator {
-  CPUAllocator() : MemAllocator(32) {}
+  explicit CPUAllocator(int align = 32, HugePages huge_pages = HugePages::NONE, int numa_node = -1) :
+    MemAllocator(align), huge_pages(huge_pages), numa_node(numa_node) {}
   void* malloc(std::size_t n) override;
+  // large blocks are anonymous mappings whose pages are only committed (and
+  // zero-filled by the OS) when they are first touched
+  void* malloc_zeroed(std::size_t n) override;
   void free(void* mem) override;
   void zero(void* p, std::size_t n) override;
+  const HugePages huge_pages;
+  const int numa_node;  // node the large blocks are bound to, or -1
+ private:
+  std::mutex mtx;
+  std::unordered_map<void*, std::size_t> mapped;  // size of mapped blocks
 };
 
 struct SharedAllocator : public MemAllocator {
   SharedAllocator() : MemAllocator(32) {}
   void* malloc(std::size_t n) override;
+  void* malloc_zeroed(std::size_t n) override;
   void free(void* mem) override;
   void zero(void* p, std::size_t n) override;
 };
@@ -7,12 +7,14 @@
 #include "dynet/io.h"
 #include "dynet/except.h"
 #include "dynet/devices.h"
+#include "dynet/packed-gemm.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <mutex>
 
 #define LOAD_INIT_FUNC() initialize_lookups()
 
@@ -52,8 +54,20 @@ namespace dynet {
 
 ParameterStorageBase::~ParameterStorageBase() {}
 
+// The last values packed by ParameterStorage::packed_values()
+struct PackedValuesCache {
+  std::mutex mtx;
+  unsigned version = 0;
+  float scale = 0.f;
+  std::shared_ptr<const PackedMatrix> matrix;
+};
+
+ParameterStorage::ParameterStorage()
+    : updated(true), owner(nullptr), version(0), packed_cache(std::make_shared<PackedValuesCache>()) {}
+
 ParameterStorage::ParameterStorage(const Dim& d, float scale, const std::string & name, Device *dev)
-    : name(name), dim(d), updated(true), nonzero_grad(false), owner(nullptr), device(dev) {
+    : name(name), dim(d), updated(true), nonzero_grad(false), owner(nullptr), device(dev),
+      version(0), packed_cache(std::make_shared<PackedValuesCache>()) {
   DYNET_ARG_CHECK(default_device != nullptr,
                   "Attempting to define parameters before initializing DyNet. Be sure to call dynet::initialize() before defining your model.");
 #if HAVE_CUDA
@@ -78,7 +92,8 @@ ParameterStorage::ParameterStorage(const Dim& d, float scale, const std::string
 
 ParameterStorage::ParameterStorage(const Dim& d, const ParameterInit & init,
                                    const std::string & name, Device *dev)
-    : name(name), dim(d), updated(true), nonzero_grad(false), owner(nullptr), device(dev) {
+    : name(name), dim(d), updated(true), nonzero_grad(false), owner(nullptr), device(dev),
+      version(0), packed_cache(std::make_shared<PackedValuesCache>()) {
   DYNET_ARG_CHECK(default_device != nullptr,
                   "Attempting to define parameters before initializing DyNet. Be sure to call dynet::initialize() before defining your model.");
 #if HAVE_CUDA
@@ -99,6 +114,7 @@ size_t ParameterStorage::size() const { return dim.size(); }
 
 void ParameterStorage::zero() {
   TensorTools::zero(values);
+  ++version;
   clear();
 }
 
@@ -106,6 +122,7 @@ void ParameterStorage::copy(const ParameterStorage & param) {
   DYNET_ARG_CHECK(dim == param.dim,
                   "Attempt to copy between parameters with mismatched dimensions: " << dim << " != " << param.dim);
   TensorTools::copy_elements(values, param.values);
+  ++version;
 }
 
 void ParameterStorage::clear() {
@@ -116,10 +133,24 @@ void ParameterStorage::clear() {
 
 void ParameterStorage::clip(float left, float right) {
   TensorTools::clip(values, left, right);
+  ++version;
 }
 
 void ParameterStorage::set_value(const std::vector<float>& val) {
   TensorTools::set_elements(values, val);
+  ++version;
+}
+
+std::shared_ptr<const PackedMatrix> ParameterStorage::packed_values(float scale) {
+  DYNET_ARG_CHECK(values.device->type == DeviceType::CPU, "Packed values of parameter " << name << " are only available on CPU");
+  DYNET_ARG_CHECK(dim.nd <= 2, "Packed values of parameter " << name << " must be a matrix, but its dimension is " << dim);
+  std::lock_guard<std::mutex> lock(packed_cache->mtx);
+  if (!packed_cache->matrix || packed_cache->version != version || packed_cache->scale != scale) {
+    packed_cache->matrix = std::make_shared<const PackedMatrix>(values.v, dim.rows(), dim.cols(), scale);
+    packed_cache->version = version;
+    packed_cache->scale = scale;
+  }
+  return packed_cache->matrix;
 }
 
 bool valid_parameter(const std::string & s) {
@@ -581,6 +612,7 @@ void ParameterStorage::accumulate_grad(const Tensor& d) {
 template <class MyDevice>
 void ParameterStorage::scale_parameters_dev(MyDevice & dev, float a) {
   tvec(values).device(*dev.edevice) = tvec(values) * a;
+  ++version;
 }
 #ifdef __CUDACC__
 template void ParameterStorage::scale_parameters_dev<Device_GPU>(Device_GPU & dev, float a);
@@ -31,6 +31,8 @@ namespace dynet {
 class DeviceManager;
 class ParameterCollection;
 struct ParameterInit;
+class PackedMatrix;
+struct PackedValuesCache;
 
 /**
  * \ingroup params
@@ -146,13 +148,33 @@ struct ParameterStorage : public ParameterStorageBase {
   bool nonzero_grad; /**< Whether the gradient is zero */
   ParameterCollection* owner; /**< Pointer to the collection that "owns" this parameter */
   Device *device;
+  /**
+   * Incremented whenever the values are modified by the methods of this
+   * class, trainers or loaders. Code writing to values directly must
+   * increment it too, so that the packed values are refreshed.
+   */
+  unsigned version;
+
+  /**
+   * @brief The values multiplied by scale, packed for fast multiplication by
+   *        matrices with a few columns (CPU only)
+   * @details The packed matrix is cached, and packed again only when the
+   *          version or the scale changed since the last call.
+   *
+   * @param scale Scale of the values, i.e. the current weight decay
+   * @return The packed values, which remain valid while they are held
+   */
+  std::shared_ptr<const PackedMatrix> packed_values(float scale);
 
 protected:
-  ParameterStorage() : updated(true), owner(nullptr) {}
+  ParameterStorage();
   explicit ParameterStorage(const Dim& d, float scale,
                             const std::string & name, Device *device); // initialize with a scale
   explicit ParameterStorage(const Dim& d, const ParameterInit & init,
                             const std::string & name, Device *device); // initialize with custom initializer
+
+private:
+  std::shared_ptr<PackedValuesCache> packed_cache;
 }; // struct ParameterStorage
 
 struct ParameterStorageCreator : public ParameterStorage {
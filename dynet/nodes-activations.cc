@@ -40,7 +40,10 @@ void Rectify::backward_dev_impl(const MyDevice & dev,
                              const Tensor& dEdf,
                              unsigned i,
                              Tensor& dEdxi) const {
-  tvec(dEdxi).device(*dev.edevice) += tvec(fx).cast<bool>().cast<float>() * tvec(dEdf);
+  if (backward_assigns())
+    tvec(dEdxi).device(*dev.edevice) = tvec(fx).cast<bool>().cast<float>() * tvec(dEdf);
+  else
+    tvec(dEdxi).device(*dev.edevice) += tvec(fx).cast<bool>().cast<float>() * tvec(dEdf);
 }
 DYNET_NODE_INST_DEV_IMPL(Rectify)
 
@@ -74,7 +77,10 @@ void LogisticSigmoid::backward_dev_impl(const MyDevice & dev,
                              const Tensor& dEdf,
                              unsigned i,
                              Tensor& dEdxi) const {
-  tvec(dEdxi).device(*dev.edevice) += tvec(fx).binaryExpr(tvec(dEdf), scalar_logistic_sigmoid_backward_op<float>());
+  if (backward_assigns())
+    tvec(dEdxi).device(*dev.edevice) = tvec(fx).binaryExpr(tvec(dEdf), scalar_logistic_sigmoid_backward_op<float>());
+  else
+    tvec(dEdxi).device(*dev.edevice) += tvec(fx).binaryExpr(tvec(dEdf), scalar_logistic_sigmoid_backward_op<float>());
 }
 DYNET_NODE_INST_DEV_IMPL(LogisticSigmoid)
 
@@ -103,7 +103,10 @@ void AffineTransform::forward_dev_impl(const MyDevice & dev, const vector<const
     for (unsigned i = 1; i < xs.size(); i += 2) {
       DYNET_ASSERT(xs[i+1]->d.bd == 1 || xs[i+1]->d.bd == xs[i]->d.bd, "Failed dimension check in AffineTransform::forward");
       // fx = (acc_sclar)*fx + xs[0] * xs[1]
-      MatrixMultiply(dev, *xs[i], *xs[i + 1], fx, dev.kSCALAR_ONE);
+      if (lps.empty())
+        MatrixMultiply(dev, *xs[i], *xs[i + 1], fx, dev.kSCALAR_ONE);
+      else
+        MatrixMultiply(dev, lps[i], *xs[i], *xs[i + 1], fx, dev.kSCALAR_ONE);
     }
   }
 }
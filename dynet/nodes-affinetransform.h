@@ -9,6 +9,7 @@ namespace dynet {
 // fx = xs[0] + \sum_{i=1, 3 ...} xs[i] * xs[i+1]
 struct AffineTransform : public Node {
   template <typename T> explicit AffineTransform(const T& a) : Node(a) {}
+  template <typename T> explicit AffineTransform(const T& a, const std::vector<Parameter>& lps) : Node(a), lps(lps) {}
   virtual bool supports_multibatch() const override { return true; }
   virtual int autobatch_sig(const ComputationGraph &cg, SigMap &sm) const override;
   virtual std::vector<int> autobatch_concat(const ComputationGraph & cg) const override;
@@ -21,6 +22,9 @@ struct AffineTransform : public Node {
   }
   DYNET_NODE_DEFINE_DEV_IMPL()
   mutable float* dEdf_mem;
+  // the parameters held by each argument multiplied on the left, if their
+  // packed values are used, or empty
+  std::vector<Parameter> lps;
 };
 
 } // namespace dynet
@@ -111,8 +111,16 @@ void CwiseSum::backward_dev_impl(const MyDevice & dev,
   // If dimensions are the same, just add over the whole vector
   if(!n_red) {
     if(dEdxi.d.bd == dEdf.d.bd) {
-      tvec(dEdxi).device(*dev.edevice) += tvec(dEdf);
-    } else {
+      if (backward_assigns())
+        tvec(dEdxi).device(*dev.edevice) = tvec(dEdf);
+      else
+        tvec(dEdxi).device(*dev.edevice) += tvec(dEdf);
+      return;
+    }
+    // the other cases accumulate into zeroed memory
+    if (backward_assigns())
+      TensorTools::zero(dEdxi);
+    {
 #ifdef __CUDACC__
       Eigen::array<ptrdiff_t, 1> red_axis = {1};
       tvec(dEdxi).device(*dev.edevice) += tbvec(dEdf).sum(red_axis);
@@ -123,6 +131,8 @@ void CwiseSum::backward_dev_impl(const MyDevice & dev,
     }
   // Otherwise work with broadcasting, etc.
   } else {
+    if (backward_assigns())
+      TensorTools::zero(dEdxi);
     n_red += xs[i]->d.bd!=fx.d.bd?1:0;
     DYNET_ASSERT(n_red < 5 && n_red > 0, "Unsupported number of reductions check in CwiseSum::backward (+)");
     if(n_red==1) backward_helper<MyDevice, 1>(dev, xs, fx, dEdf, i, dEdxi);
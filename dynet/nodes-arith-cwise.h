@@ -11,6 +11,7 @@ struct CwiseSum : public Node {
   template <typename T> explicit CwiseSum(const T& a) : Node(a) {}
   DYNET_NODE_DEFINE_DEV_IMPL()
   virtual bool supports_multibatch() const override { return true; }
+  virtual bool supports_backward_assign() const override { return true; }
   virtual int autobatch_sig(const ComputationGraph &cg, SigMap &sm) const override;
   virtual std::vector<int> autobatch_concat(const ComputationGraph & cg) const override;
   template<class MyDevice, int ReductionOrder>
@@ -121,10 +121,16 @@ void Sum::backward_dev_impl(const MyDevice & dev,
                              unsigned i,
                              Tensor& dEdxi) const {
   if(dEdxi.d.bd == fx.d.bd) {
-    tvec(dEdxi).device(*dev.edevice) += tvec(dEdf);
+    if (backward_assigns())
+      tvec(dEdxi).device(*dev.edevice) = tvec(dEdf);
+    else
+      tvec(dEdxi).device(*dev.edevice) += tvec(dEdf);
   } else {
     Eigen::array<ptrdiff_t, 1> red_axis = {1};
-    tvec(dEdxi).device(*dev.edevice) += tbvec(dEdf).sum(red_axis);
+    if (backward_assigns())
+      tvec(dEdxi).device(*dev.edevice) = tbvec(dEdf).sum(red_axis);
+    else
+      tvec(dEdxi).device(*dev.edevice) += tbvec(dEdf).sum(red_axis);
   }
 }
 DYNET_NODE_INST_DEV_IMPL(Sum)
@@ -21,6 +21,7 @@ struct Sum : public Node {
   }
   DYNET_NODE_DEFINE_DEV_IMPL()
   virtual bool supports_multibatch() const override { return true; }
+  virtual bool supports_backward_assign() const override { return true; }
 };
 
 // y = \sum_i,j,... x[i,j,...]
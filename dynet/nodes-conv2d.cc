@@ -10,8 +10,7 @@
 
 #include "dynet/functors.h"
 #include "dynet/nodes-impl-macros.h"
-#include "third_party/eigen_spatial_convolutions.h"
-#include "third_party/eigen_backward_spatial_convolutions.h"
+#include "dynet/cpu-conv-ops.h"
 
 #if HAVE_CUDA
 #include "dynet/cuda.h"
@@ -125,31 +124,7 @@ void Conv2D::forward_dev_impl(const MyDevice & dev, const vector<const Tensor*>&
   throw std::runtime_error("Conv2D::forward_dev_impl not supported without CUDNN");
 #endif
 #else
-  Eigen::PaddingType padding_type = is_valid ? Eigen::PADDING_VALID : Eigen::PADDING_SAME;
-  //void* CHWN_x_mem = aux_mem_pool.allocate(xs[0]->d.size() * sizeof(float));
-  void* CHWN_x_mem = scratch_allocator->allocate(xs[0]->d.size() * sizeof(float));
-  Tensor CHWN_x = Tensor(Dim({xs[0]->d[2], xs[0]->d[0], xs[0]->d[1]}, xs[0]->d.bd), static_cast<float*>(CHWN_x_mem), xs[0]->device, DeviceMempool::FXS);
-  Eigen::array<ptrdiff_t, 4> shuffles;
-  shuffles[0] = 2; shuffles[1] = 0; shuffles[2] = 1; shuffles[3] = 3;
-  tb<3>(CHWN_x).device(*dev.edevice) = tb<3>(*xs[0]).shuffle(shuffles);
-  //void* NCHW_f_mem = aux_mem_pool.allocate(xs[1]->d.size() * sizeof(float));
-  void* NCHW_f_mem = scratch_allocator->allocate(xs[1]->d.size() * sizeof(float));
-  Tensor NCHW_f = Tensor(Dim({xs[1]->d[3], xs[1]->d[2], xs[1]->d[0], xs[1]->d[1]}), static_cast<float*>(NCHW_f_mem), xs[1]->device, DeviceMempool::FXS);
-  shuffles[0] = 3; shuffles[1] = 2; shuffles[2] = 0; shuffles[3] = 1;
-  t<4>(NCHW_f).device(*dev.edevice) = t<4>(*xs[1]).shuffle(shuffles);
-  //void* CHWN_y_mem = aux_mem_pool.allocate(fx.d.size() * sizeof(float));
-  void* CHWN_y_mem = scratch_allocator->allocate(fx.d.size() * sizeof(float));
-  Tensor CHWN_y = Tensor(Dim({fx.d[2], fx.d[0], fx.d[1]}, fx.d.bd), static_cast<float*>(CHWN_y_mem), fx.device, DeviceMempool::FXS);
-  tb<3>(CHWN_y).device(*dev.edevice) = Eigen::SpatialConvolution(tb<3>(CHWN_x), t<4>(NCHW_f), stride[0], stride[1], padding_type);
-  shuffles[0] = 1; shuffles[1] = 2; shuffles[2] = 0; shuffles[3] = 3;
-  tb<3>(fx).device(*dev.edevice) = tb<3>(CHWN_y).shuffle(shuffles);
-  if (xs.size() == 3) {
-    Tensor bias = Tensor(Dim({fx.d[0], fx.d[1], fx.d.bd}, 1), static_cast<float*>(CHWN_x_mem), xs[2]->device, DeviceMempool::FXS);
-    for (unsigned i = 0; i < fx.d[2]; ++i) {
-      TensorTools::constant(bias, vec(*xs[2])(i));
-      tb<3>(fx).chip<2>(i).device(*dev.edevice) += t<3>(bias);
-    }
-  }
+  CPUConvOp(stride, is_valid).forward_impl(dev, xs, fx);
 #endif
   scratch_allocator->free();
 }
@@ -175,48 +150,7 @@ void Conv2D::backward_dev_impl(const MyDevice & dev,
   throw std::runtime_error("Conv2D::backward_dev_impl not supported without CUDNN");
 #endif
 #else
-  //void* CHWN_dy_mem = aux_mem_pool.allocate(dEdf.d.size() * sizeof(float));
-  void* CHWN_dy_mem = scratch_allocator->allocate(dEdf.d.size() * sizeof(float));
-  Tensor CHWN_dy = Tensor(Dim({dEdf.d[2], dEdf.d[0], dEdf.d[1]}, dEdf.d.bd), static_cast<float*>(CHWN_dy_mem), dEdf.device, DeviceMempool::FXS);
-  Eigen::array<ptrdiff_t, 4> shuffles;
-  shuffles[0] = 2; shuffles[1] = 0; shuffles[2] = 1; shuffles[3] = 3;
-  tb<3>(CHWN_dy).device(*dev.edevice) = tb<3>(dEdf).shuffle(shuffles);
-  if (i == 0) { //backward w.r.t the input
-    //void* NCHW_f_mem = aux_mem_pool.allocate(xs[1]->d.size() * sizeof(float));
-    void* NCHW_f_mem = scratch_allocator->allocate(xs[1]->d.size() * sizeof(float));
-    Tensor NCHW_f = Tensor(Dim({xs[1]->d[3], xs[1]->d[2], xs[1]->d[0], xs[1]->d[1]}), static_cast<float*>(NCHW_f_mem), xs[1]->device, DeviceMempool::FXS);
-    shuffles[0] = 3; shuffles[1] = 2; shuffles[2] = 0; shuffles[3] = 1;
-    t<4>(NCHW_f).device(*dev.edevice) = t<4>(*xs[1]).shuffle(shuffles);
-    //void* CHWN_dEdxi_mem = aux_mem_pool.allocate(xs[0]->d.size() * sizeof(float));
-    void* CHWN_dEdxi_mem = scratch_allocator->allocate(xs[0]->d.size() * sizeof(float));
-    Tensor CHWN_dEdxi = Tensor(Dim({xs[0]->d[2], xs[0]->d[0], xs[0]->d[1]}, xs[0]->d.bd), static_cast<float*>(CHWN_dEdxi_mem), dEdxi.device, DeviceMempool::FXS);
-    tb<3>(CHWN_dEdxi).device(*dev.edevice) = Eigen::SpatialConvolutionBackwardInput(t<4>(NCHW_f), tb<3>(CHWN_dy), xs[0]->d[0], xs[0]->d[1], stride[0], stride[1]);
-    //void* HWCN_dEdxi_mem = aux_mem_pool.allocate(xs[0]->d.size() * sizeof(float));
-    void* HWCN_dEdxi_mem = scratch_allocator->allocate(xs[0]->d.size() * sizeof(float));
-    Tensor HWCN_dEdxi = Tensor(xs[0]->d, static_cast<float*>(HWCN_dEdxi_mem), dEdxi.device, DeviceMempool::FXS);
-    shuffles[0] = 1; shuffles[1] = 2; shuffles[2] = 0; shuffles[3] = 3;
-    tb<3>(HWCN_dEdxi).device(*dev.edevice) = tb<3>(CHWN_dEdxi).shuffle(shuffles);
-    tb<3>(dEdxi).device(*dev.edevice) += tb<3>(HWCN_dEdxi);
-  } else if (i == 1) { //backward w.r.t the kernel
-    //void* CHWN_x_mem = aux_mem_pool.allocate(xs[0]->d.size() * sizeof(float));
-    void* CHWN_x_mem = scratch_allocator->allocate(xs[0]->d.size() * sizeof(float));
-    Tensor CHWN_x = Tensor(Dim({xs[0]->d[2], xs[0]->d[0], xs[0]->d[1]}, xs[0]->d.bd), static_cast<float*>(CHWN_x_mem), xs[0]->device, DeviceMempool::FXS);
-    shuffles[0] = 2; shuffles[1] = 0; shuffles[2] = 1; shuffles[3] = 3;
-    tb<3>(CHWN_x).device(*dev.edevice) = tb<3>(*xs[0]).shuffle(shuffles);
-    //void* NCHW_dEdxi_mem = aux_mem_pool.allocate(xs[1]->d.size() * sizeof(float));
-    void* NCHW_dEdxi_mem = scratch_allocator->allocate(xs[1]->d.size() * sizeof(float));
-    Tensor NCHW_dEdxi = Tensor(Dim({xs[1]->d[3], xs[1]->d[2], xs[1]->d[0], xs[1]->d[1]}), static_cast<float*>(NCHW_dEdxi_mem), dEdxi.device, DeviceMempool::FXS);
-    t<4>(NCHW_dEdxi).device(*dev.edevice) = Eigen::SpatialConvolutionBackwardKernel(tb<3>(CHWN_x), tb<3>(CHWN_dy), xs[1]->d[0], xs[1]->d[1], stride[0], stride[1], is_valid);
-    //void* HWCN_dEdxi_mem = aux_mem_pool.allocate(xs[1]->d.size() * sizeof(float));
-    void* HWCN_dEdxi_mem = scratch_allocator->allocate(xs[1]->d.size() * sizeof(float));
-    Tensor HWCN_dEdxi = Tensor(xs[1]->d, static_cast<float*>(HWCN_dEdxi_mem), dEdxi.device, DeviceMempool::FXS);
-    shuffles[0] = 2; shuffles[1] = 3; shuffles[2] = 1; shuffles[3] = 0;
-    t<4>(HWCN_dEdxi).device(*dev.edevice) = t<4>(NCHW_dEdxi).shuffle(shuffles);
-    t<4>(dEdxi).device(*dev.edevice) += t<4>(HWCN_dEdxi);
-  } else { //backward w.r.t the bias
-    Eigen::array<ptrdiff_t, 3> red_axis = {0, 1, 3};
-    t<1>(dEdxi).device(*dev.edevice) += tb<3>(dEdf).sum(red_axis);
-  }
+  CPUConvOp(stride, is_valid).backward_impl(dev, xs, fx, dEdf, i, dEdxi);
 #endif
   scratch_allocator->free();
 }
@@ -0,0 +1,219 @@
+#include "dynet/tensor-eigen.h"
+#include "dynet/nodes-fused.h"
+
+#include "dynet/nodes-impl-macros.h"
+#include "dynet/nodes-activations.h"
+#include "dynet/nodes-arith-const.h"
+#include "dynet/nodes-arith-cwise.h"
+#include "dynet/nodes-arith-unary.h"
+#include "dynet/nodes-trig.h"
+
+#include "dynet/simd-functors.h"
+
+using namespace std;
+
+namespace dynet {
+
+// ************* FusedElementwise *************
+
+// Number of elements processed at a time; the values of all operations for
+// one block stay in the cache
+static const size_t kFusedBlockSize = 256;
+
+typedef Eigen::Map<Eigen::ArrayXf> FusedBlock;
+
+#ifndef __CUDACC__
+
+// y = op(vals[op.a], vals[op.b]) for a block of n elements
+static void fused_forward_op(const FusedElementwise::Op& op, const vector<float*>& vals,
+                             float* out, size_t n) {
+  FusedBlock y(out, n), a(vals[op.a], n);
+  switch (op.type) {
+    case nt::tanh: y = a.tanh(); break;
+    case nt::logistic: y = a.unaryExpr(scalar_logistic_sigmoid_op<float>()); break;
+    case nt::rectify: y = a.max(0.f); break;
+    case nt::exp: y = a.exp(); break;
+    case nt::log: y = a.log(); break;
+    case nt::square: y = a.square(); break;
+    case nt::sqrt: y = a.sqrt(); break;
+    case nt::negate: y = op.c - a; break;
+    case nt::plus_const: y = a + op.c; break;
+    case nt::scalar_mult: y = a * op.c; break;
+    case nt::cmult: y = a * FusedBlock(vals[op.b], n); break;
+    case nt::csum: y = a + FusedBlock(vals[op.b], n); break;
+    default: DYNET_RUNTIME_ERR("Bad operation in FusedElementwise");
+  }
+}
+
+static const char* fused_op_name(nt::NodeType type) {
+  switch (type) {
+    case nt::tanh: return "tanh";
+    case nt::logistic: return "logistic";
+    case nt::rectify: return "ReLU";
+    case nt::exp: return "exp";
+    case nt::log: return "log";
+    case nt::square: return "square";
+    case nt::sqrt: return "sqrt";
+    case nt::negate: return "negate";
+    case nt::plus_const: return "plus_const";
+    case nt::scalar_mult: return "scalar_mult";
+    case nt::cmult: return "cmult";
+    case nt::csum: return "csum";
+    default: return "?";
+  }
+}
+
+string FusedElementwise::as_string(const vector<string>& arg_names) const {
+  ostringstream s;
+  s << "fused(";
+  for (size_t k = 0; k < ops.size(); ++k)
+    s << (k ? "," : "") << fused_op_name(ops[k].type);
+  for (auto & a : arg_names)
+    s << ", " << a;
+  s << ')';
+  return s.str();
+}
+
+Dim FusedElementwise::dim_forward(const vector<Dim>& xs) const {
+  DYNET_ARG_CHECK(xs.size() > 0, "Failed input count check in FusedElementwise");
+  for (size_t i = 1; i < xs.size(); ++i)
+    DYNET_ARG_CHECK(xs[i] == xs[0], "Mismatched input dimensions in FusedElementwise: " << xs);
+  return xs[0];
+}
+
+unsigned FusedElementwise::fusible_arity(const Node* node) {
+  if (dynamic_cast<const Tanh*>(node) || dynamic_cast<const LogisticSigmoid*>(node) ||
+      dynamic_cast<const Rectify*>(node) || dynamic_cast<const Exp*>(node) ||
+      dynamic_cast<const Log*>(node) || dynamic_cast<const Square*>(node) ||
+      dynamic_cast<const Sqrt*>(node) || dynamic_cast<const Negate*>(node) ||
+      dynamic_cast<const ConstantPlusX*>(node) || dynamic_cast<const ConstantMinusX*>(node) ||
+      dynamic_cast<const ConstScalarMultiply*>(node))
+    return 1;
+  if ((dynamic_cast<const CwiseMultiply*>(node) || dynamic_cast<const CwiseSum*>(node)) &&
+      node->arity() == 2)
+    return 2;
+  return 0;
+}
+
+bool FusedElementwise::append_op(const Node* node, unsigned a, unsigned b, vector<Op>& ops) {
+  Op op = {nt::identity, a, b, 0.f};
+  if (dynamic_cast<const Tanh*>(node)) op.type = nt::tanh;
+  else if (dynamic_cast<const LogisticSigmoid*>(node)) op.type = nt::logistic;
+  else if (dynamic_cast<const Rectify*>(node)) op.type = nt::rectify;
+  else if (dynamic_cast<const Exp*>(node)) op.type = nt::exp;
+  else if (dynamic_cast<const Log*>(node)) op.type = nt::log;
+  else if (dynamic_cast<const Square*>(node)) op.type = nt::square;
+  else if (dynamic_cast<const Sqrt*>(node)) op.type = nt::sqrt;
+  else if (dynamic_cast<const Negate*>(node)) op.type = nt::negate;
+  else if (auto n = dynamic_cast<const ConstantPlusX*>(node)) { op.type = nt::plus_const; op.c = n->c; }
+  else if (auto n = dynamic_cast<const ConstScalarMultiply*>(node)) { op.type = nt::scalar_mult; op.c = n->alpha; }
+  else if (auto n = dynamic_cast<const ConstantMinusX*>(node)) { op.type = nt::negate; op.c = n->c; }
+  else if (dynamic_cast<const CwiseMultiply*>(node)) op.type = nt::cmult;
+  else if (dynamic_cast<const CwiseSum*>(node)) op.type = nt::csum;
+  else return false;
+  ops.push_back(op);
+  return true;
+}
+
+#endif
+
+template<class MyDevice>
+void FusedElementwise::forward_dev_impl(const MyDevice & dev, const vector<const Tensor*>& xs, Tensor& fx) const {
+#ifdef __CUDACC__
+  DYNET_NO_CUDA_IMPL_ERROR("FusedElementwise forward");
+#else
+  AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+  float* scratch = static_cast<float*>(scratch_allocator->allocate(ops.size() * kFusedBlockSize * sizeof(float)));
+  const size_t num_args = xs.size(), last = ops.size() - 1, size = fx.d.size();
+  vector<float*> vals(num_args + ops.size());
+  for (size_t begin = 0; begin < size; begin += kFusedBlockSize) {
+    const size_t n = std::min(kFusedBlockSize, size - begin);
+    for (size_t i = 0; i < num_args; ++i)
+      vals[i] = xs[i]->v + begin;
+    for (size_t k = 0; k < last; ++k)
+      vals[num_args + k] = scratch + k * kFusedBlockSize;
+    vals[num_args + last] = fx.v + begin;
+    for (size_t k = 0; k <= last; ++k)
+      fused_forward_op(ops[k], vals, vals[num_args + k], n);
+  }
+  scratch_allocator->free();
+#endif
+}
+
+template<class MyDevice>
+void FusedElementwise::backward_dev_impl(const MyDevice & dev,
+                             const vector<const Tensor*>& xs,
+                             const Tensor& fx,
+                             const Tensor& dEdf,
+                             unsigned i,
+                             Tensor& dEdxi) const {
+#ifdef __CUDACC__
+  DYNET_NO_CUDA_IMPL_ERROR("FusedElementwise backward");
+#else
+  const size_t num_args = xs.size(), last = ops.size() - 1, size = fx.d.size();
+  // Only operations that depend on argument i pass gradients on
+  vector<bool> depends(num_args + ops.size(), false);
+  depends[i] = true;
+  for (size_t k = 0; k <= last; ++k) {
+    const Op& op = ops[k];
+    const bool binary = op.type == nt::cmult || op.type == nt::csum;
+    depends[num_args + k] = depends[op.a] || (binary && depends[op.b]);
+  }
+  // The values of all but the last operation are recomputed, and each
+  // operation gets a gradient buffer; the gradient of argument i goes
+  // straight into dEdxi
+  AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+  float* scratch = static_cast<float*>(scratch_allocator->allocate(2 * ops.size() * kFusedBlockSize * sizeof(float)));
+  float* grad_scratch = scratch + ops.size() * kFusedBlockSize;
+  vector<float*> vals(num_args + ops.size()), grads(num_args + ops.size(), nullptr);
+  for (size_t begin = 0; begin < size; begin += kFusedBlockSize) {
+    const size_t n = std::min(kFusedBlockSize, size - begin);
+    for (size_t j = 0; j < num_args; ++j)
+      vals[j] = xs[j]->v + begin;
+    for (size_t k = 0; k < last; ++k) {
+      vals[num_args + k] = scratch + k * kFusedBlockSize;
+      grads[num_args + k] = grad_scratch + k * kFusedBlockSize;
+      FusedBlock(grads[num_args + k], n).setZero();
+    }
+    vals[num_args + last] = fx.v + begin;
+    grads[num_args + last] = dEdf.v + begin;
+    grads[i] = dEdxi.v + begin;
+    // recompute the intermediate values
+    for (size_t k = 0; k < last; ++k)
+      fused_forward_op(ops[k], vals, vals[num_args + k], n);
+    // and pass the gradients back through the chain
+    for (size_t k = last + 1; k-- > 0; ) {
+      if (!depends[num_args + k]) continue;
+      const Op& op = ops[k];
+      FusedBlock y(vals[num_args + k], n), dy(grads[num_args + k], n), a(vals[op.a], n);
+      if (depends[op.a]) {
+        FusedBlock da(grads[op.a], n);
+        switch (op.type) {
+          case nt::tanh: da += dy * (1.f - y.square()); break;
+          case nt::logistic: da += dy * y * (1.f - y); break;
+          case nt::rectify: da += dy * (y > 0.f).cast<float>(); break;
+          case nt::exp: da += dy * y; break;
+          case nt::log: da += dy / a; break;
+          case nt::square: da += 2.f * dy * a; break;
+          case nt::sqrt: da += 0.5f * dy / y; break;
+          case nt::negate: da -= dy; break;
+          case nt::plus_const: da += dy; break;
+          case nt::scalar_mult: da += op.c * dy; break;
+          case nt::cmult: da += dy * FusedBlock(vals[op.b], n); break;
+          case nt::csum: da += dy; break;
+          default: DYNET_RUNTIME_ERR("Bad operation in FusedElementwise::backward");
+        }
+      }
+      if ((op.type == nt::cmult || op.type == nt::csum) && depends[op.b]) {
+        FusedBlock db(grads[op.b], n);
+        if (op.type == nt::cmult) db += dy * a;
+        else db += dy;
+      }
+    }
+  }
+  scratch_allocator->free();
+#endif
+}
+DYNET_NODE_INST_DEV_IMPL(FusedElementwise)
+
+} // namespace dynet
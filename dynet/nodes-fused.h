@@ -0,0 +1,36 @@
+#ifndef DYNET_NODES_FUSED_H_
+#define DYNET_NODES_FUSED_H_
+
+#include "dynet/dynet.h"
+#include "dynet/nodes-def-macros.h"
+#include "dynet/sig.h"
+
+namespace dynet {
+
+// y = f(x_1, ..., x_n), where f is a chain of elementwise operations of
+// tensors of the same dimension, evaluated block by block so that the
+// intermediate values never leave the cache. The execution engine creates
+// these nodes in place of the last node of each chain (see --dynet-fusion).
+struct FusedElementwise : public Node {
+  // One operation of the chain. Operands 0..n-1 are the arguments of the
+  // node, operand n+k is the result of operation k, and the result of the
+  // last operation is the value of the node. Negation computes c - a.
+  struct Op {
+    nt::NodeType type;
+    unsigned a, b;
+    float c;
+  };
+  template <typename T> explicit FusedElementwise(const T& a, const std::vector<Op>& ops) : Node(a), ops(ops) {}
+  DYNET_NODE_DEFINE_DEV_IMPL()
+  virtual bool supports_multibatch() const override { return true; }
+  // Append the operation computing node to ops, with operands a (and b for
+  // binary operations). Returns false if node is not a fusible operation.
+  static bool append_op(const Node* node, unsigned a, unsigned b, std::vector<Op>& ops);
+  // Number of arguments of a fusible node, or 0 if it can't be fused
+  static unsigned fusible_arity(const Node* node);
+  std::vector<Op> ops;
+};
+
+} // namespace dynet
+
+#endif
@@ -0,0 +1,406 @@
+#include "dynet/tensor-eigen.h"
+#include "dynet/nodes-gru.h"
+#include "dynet/matrix-multiply.h"
+
+#include "dynet/functors.h"
+#include "dynet/simd-functors.h"
+#include "dynet/nodes-impl-macros.h"
+
+using namespace std;
+
+namespace dynet {
+
+// The arguments that are not parameters (x_t, h_tm1, gates_t, c_t) may have a
+// single batch element while the others are batched, e.g. when the initial
+// state is shared by the whole batch. Those are broadcast in scratch memory
+// and their gradients are summed over the batch.
+
+#ifndef __CUDACC__
+
+  // Parameters are shared by the whole batch, the other arguments are
+  // concatenated unless they are broadcast over the batch of the node
+  static int gru_autobatch_sig(const Node & node, const ComputationGraph & cg, SigMap &sm, nt::NodeType type, unsigned num_data) {
+    Sig s(type);
+    for(unsigned i = 0; i < node.args.size(); ++i) {
+      const Dim & d = cg.nodes[node.args[i]]->dim;
+      if(i >= num_data || (d.bd == 1 && node.dim.bd > 1))
+        s.add_node(node.args[i]);
+      else
+        s.add_dim(d);
+    }
+    return sm.get_idx(s);
+  }
+
+  static vector<int> gru_autobatch_concat(const Node & node, const ComputationGraph & cg, unsigned num_data) {
+    vector<int> ret(node.args.size(), 0);
+    for(unsigned i = 0; i < num_data; ++i)
+      ret[i] = (cg.nodes[node.args[i]]->dim.bd == node.dim.bd);
+    return ret;
+  }
+
+  static unsigned gru_batch_size(const vector<Dim>& xs, unsigned num_data, const char* name) {
+    unsigned batch_size = 1;
+    for(unsigned i = 0; i < num_data; ++i)
+      batch_size = max(batch_size, xs[i].bd);
+    for(unsigned i = 0; i < num_data; ++i)
+      DYNET_ARG_CHECK(xs[i].bd == 1 || xs[i].bd == batch_size, name << ": inconsistent batch sizes " << xs[i].bd << " != " << batch_size);
+    for(unsigned i = num_data; i < xs.size(); ++i)
+      DYNET_ARG_CHECK(xs[i].bd == 1, name << ": parameters can not be batched, but argument " << i << " has batch size " << xs[i].bd);
+    return batch_size;
+  }
+
+#endif
+
+  // Returns t if it has batch_size batch elements, or a copy of it broadcast
+  // over the batch in scratch memory
+  template<class MyDevice>
+  static Tensor gru_batched(const MyDevice & dev, const Tensor & t, unsigned batch_size, AlignedMemoryPool* scratch_allocator) {
+    Tensor ret(Dim({t.d.batch_size()}, batch_size), t.v, t.device, t.mem_pool);
+    if(t.d.bd != batch_size) {
+      ret.v = static_cast<float*>(scratch_allocator->allocate(ret.d.size() * sizeof(float)));
+      Eigen::array<ptrdiff_t, 2> bcast = {1, (ptrdiff_t)batch_size};
+      tbvec(ret).device(*dev.edevice) = tbvec(t).broadcast(bcast);
+    }
+    return ret;
+  }
+
+  // dEdxi[offset:offset+rows] += d, summed over the batch if dEdxi is not batched
+  template<class MyDevice>
+  static void gru_accumulate(const MyDevice & dev, const Tensor & d, Tensor & dEdxi, unsigned offset = 0) {
+    const unsigned rows = d.d.batch_size();
+    if(dEdxi.d.bd == d.d.bd) {
+      if(rows == dEdxi.d.batch_size()) {
+        tvec(dEdxi).device(*dev.edevice) += tvec(d);
+      } else {
+        Eigen::DSizes<ptrdiff_t, 2> indices(offset, 0);
+        Eigen::DSizes<ptrdiff_t, 2> sizes(rows, static_cast<ptrdiff_t>(d.d.bd));
+        tbvec(dEdxi).slice(indices, sizes).device(*dev.edevice) += tbvec(d);
+      }
+    } else {
+      Eigen::array<ptrdiff_t, 1> vec_batch_axis = {1};
+      Eigen::DSizes<ptrdiff_t, 1> indices(offset);
+      Eigen::DSizes<ptrdiff_t, 1> sizes(rows);
+      tvec(dEdxi).slice(indices, sizes).device(*dev.edevice) += tbvec(d).sum(vec_batch_axis);
+    }
+  }
+
+  // dEdxi += W^T * d, summed over the batch if dEdxi is not batched
+  template<class MyDevice>
+  static void gru_transp_multiply_acc(const MyDevice & dev, const Tensor & W, const Tensor & d, Tensor & dEdxi, AlignedMemoryPool* scratch_allocator) {
+    if(dEdxi.d.bd == d.d.bd) {
+      MatrixTranspMultiplyAcc(dev, W, d, dEdxi);
+    } else {
+      Tensor tmp(Dim({W.d[1]}, d.d.bd), nullptr, dEdxi.device, dEdxi.mem_pool);
+      tmp.v = static_cast<float*>(scratch_allocator->allocate(tmp.d.size() * sizeof(float)));
+      TensorTools::zero(tmp);
+      MatrixTranspMultiplyAcc(dev, W, d, tmp);
+      gru_accumulate(dev, tmp, dEdxi);
+    }
+  }
+
+// ************* GRU Gates *************
+
+#ifndef __CUDACC__
+
+  string GRUGates::as_string(const vector<string>& arg_names) const {
+    ostringstream s;
+    s << "gru_gates(" << arg_names[0] << ", " << arg_names[1] << ", " << arg_names[2] << ", " << arg_names[3] << ", " << arg_names[4]
+      << ", " << arg_names[5] << ", " << arg_names[6] << ", " << arg_names[7] << ')';
+    return s.str();
+  }
+
+  Dim GRUGates::dim_forward(const vector<Dim>& xs) const {
+    DYNET_ARG_CHECK(xs.size() == 8, "Failed input count check in GRUGates");
+    unsigned batch_size = gru_batch_size(xs, 2, "GRUGates");
+    unsigned hidden_dim = xs[1][0];
+    unsigned input_dim = xs[0][0];
+    DYNET_ARG_CHECK(xs[0].ndims() == 1, "GRUGates: x_t expected to be a vector");
+    DYNET_ARG_CHECK(xs[1].ndims() == 1, "GRUGates: h_tm1 expected to be a vector");
+    for(unsigned k = 2; k < 8; k += 3) {
+      DYNET_ARG_CHECK(xs[k] == Dim({hidden_dim, input_dim}), "GRUGates: Wx expected to be " << Dim({hidden_dim, input_dim}) << ", was " << xs[k]);
+      DYNET_ARG_CHECK(xs[k+1] == Dim({hidden_dim, hidden_dim}), "GRUGates: Wh expected to be " << Dim({hidden_dim, hidden_dim}) << ", was " << xs[k+1]);
+      DYNET_ARG_CHECK(xs[k+2].ndims() == 1 && xs[k+2][0] == hidden_dim, "GRUGates: b expected to be " << Dim({hidden_dim}) << ", was " << xs[k+2]);
+    }
+    return Dim({hidden_dim*2}, batch_size);
+  }
+
+  int GRUGates::autobatch_sig(const ComputationGraph & cg, SigMap &sm) const {
+    return gru_autobatch_sig(*this, cg, sm, nt::gru_gates, 2);
+  }
+
+  std::vector<int> GRUGates::autobatch_concat(const ComputationGraph & cg) const {
+    return gru_autobatch_concat(*this, cg, 2);
+  }
+
+#endif
+
+  template<class MyDevice>
+  void GRUGates::forward_dev_impl(const MyDevice & dev, const vector<const Tensor*>& xs, Tensor& fx) const {
+    // z_t = sigmoid(Wxz * x_t + Whz * h_tm1 + bz)
+    // r_t = sigmoid(Wxr * x_t + Whr * h_tm1 + br)
+    DYNET_ASSERT(xs.size() == 8, "Failed dimension check in GRUGates::forward");
+    unsigned hidden_dim = fx.d[0] / 2;
+    unsigned batch_size = fx.d.bd;
+    Eigen::DSizes<ptrdiff_t, 2> sizes_1(hidden_dim, static_cast<ptrdiff_t>(batch_size));
+    Eigen::array<ptrdiff_t, 2> bcast = {1, (ptrdiff_t)batch_size};
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+    Tensor x_t = gru_batched(dev, *xs[0], batch_size, scratch_allocator);
+    Tensor h_tm1 = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+
+    Tensor a_t(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+    a_t.v = static_cast<float*>(scratch_allocator->allocate(a_t.d.size() * sizeof(float)));
+    for(unsigned k = 0; k < 2; ++k) {
+      Eigen::DSizes<ptrdiff_t, 2> indices(hidden_dim*k, 0);
+      tbvec(a_t).device(*dev.edevice) = tbvec(*xs[4+3*k]).broadcast(bcast);
+      MatrixMultiply(dev, *xs[2+3*k], x_t, a_t, dev.kSCALAR_ONE);
+      MatrixMultiply(dev, *xs[3+3*k], h_tm1, a_t, dev.kSCALAR_ONE);
+      tbvec(fx).slice(indices, sizes_1).device(*dev.edevice) = tbvec(a_t).unaryExpr(scalar_logistic_sigmoid_op<float>());
+    }
+    scratch_allocator->free();
+  }
+
+  template<class MyDevice>
+  void GRUGates::backward_dev_impl(const MyDevice & dev,
+                               const vector<const Tensor*>& xs,
+                               const Tensor& fx,
+                               const Tensor& dEdf,
+                               unsigned i,
+                               Tensor& dEdxi) const {
+    unsigned hidden_dim = fx.d[0] / 2;
+    unsigned batch_size = fx.d.bd;
+    Eigen::DSizes<ptrdiff_t, 2> sizes_1(hidden_dim, static_cast<ptrdiff_t>(batch_size));
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+
+    // da_k = dg_k . g_k . (1 - g_k) for the gates k the argument contributes to
+    Tensor da[2];
+    for(unsigned k = 0; k < 2; ++k) {
+      if(i >= 2 && (i - 2) / 3 != k) continue;
+      Eigen::DSizes<ptrdiff_t, 2> indices(hidden_dim*k, 0);
+      da[k] = Tensor(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+      da[k].v = static_cast<float*>(scratch_allocator->allocate(da[k].d.size() * sizeof(float)));
+      tbvec(da[k]).device(*dev.edevice) = tbvec(dEdf).slice(indices, sizes_1)
+                                          * tbvec(fx).slice(indices, sizes_1)
+                                          * (tbvec(fx).slice(indices, sizes_1).constant(1) - tbvec(fx).slice(indices, sizes_1));
+    }
+
+    if(i < 2) {
+      // dx_t = Wxz^T * da_z + Wxr^T * da_r
+      // dh_tm1 = Whz^T * da_z + Whr^T * da_r
+      for(unsigned k = 0; k < 2; ++k)
+        gru_transp_multiply_acc(dev, *xs[2+i+3*k], da[k], dEdxi, scratch_allocator);
+    } else {
+      unsigned k = (i - 2) / 3;
+      switch((i - 2) % 3) {
+        case 0: { // dWx_k = da_k * x_t^T, summed over the batch
+          Tensor x_t = gru_batched(dev, *xs[0], batch_size, scratch_allocator);
+          MatrixMultiplyTranspAcc(dev, da[k], x_t, dEdxi);
+          break;
+        }
+        case 1: { // dWh_k = da_k * h_tm1^T, summed over the batch
+          Tensor h_tm1 = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+          MatrixMultiplyTranspAcc(dev, da[k], h_tm1, dEdxi);
+          break;
+        }
+        default: // db_k = da_k, summed over the batch
+          gru_accumulate(dev, da[k], dEdxi);
+      }
+    }
+    scratch_allocator->free();
+  }
+  DYNET_NODE_INST_DEV_IMPL(GRUGates)
+
+// ************* GRU Candidate *************
+
+#ifndef __CUDACC__
+
+  string GRUC::as_string(const vector<string>& arg_names) const {
+    ostringstream s;
+    s << "gru_c(" << arg_names[0] << ", " << arg_names[1] << ", " << arg_names[2] << ", " << arg_names[3] << ", " << arg_names[4] << ", " << arg_names[5] << ')';
+    return s.str();
+  }
+
+  Dim GRUC::dim_forward(const vector<Dim>& xs) const {
+    DYNET_ARG_CHECK(xs.size() == 6, "Failed input count check in GRUC");
+    unsigned batch_size = gru_batch_size(xs, 3, "GRUC");
+    unsigned hidden_dim = xs[1][0];
+    unsigned input_dim = xs[0][0];
+    DYNET_ARG_CHECK(xs[0].ndims() == 1, "GRUC: x_t expected to be a vector");
+    DYNET_ARG_CHECK(xs[1].ndims() == 1, "GRUC: h_tm1 expected to be a vector");
+    DYNET_ARG_CHECK(xs[2].ndims() == 1 && xs[2][0] == hidden_dim*2, "GRUC: gates_t expected 2 times as big as h_tm1, but " << xs[2][0] << " != 2*" << hidden_dim);
+    DYNET_ARG_CHECK(xs[3] == Dim({hidden_dim, input_dim}), "GRUC: Wxh expected to be " << Dim({hidden_dim, input_dim}) << ", was " << xs[3]);
+    DYNET_ARG_CHECK(xs[4] == Dim({hidden_dim, hidden_dim}), "GRUC: Whh expected to be " << Dim({hidden_dim, hidden_dim}) << ", was " << xs[4]);
+    DYNET_ARG_CHECK(xs[5].ndims() == 1 && xs[5][0] == hidden_dim, "GRUC: bh expected to be " << Dim({hidden_dim}) << ", was " << xs[5]);
+    return Dim({hidden_dim}, batch_size);
+  }
+
+  int GRUC::autobatch_sig(const ComputationGraph & cg, SigMap &sm) const {
+    return gru_autobatch_sig(*this, cg, sm, nt::gru_c, 3);
+  }
+
+  std::vector<int> GRUC::autobatch_concat(const ComputationGraph & cg) const {
+    return gru_autobatch_concat(*this, cg, 3);
+  }
+
+#endif
+
+  template<class MyDevice>
+  void GRUC::forward_dev_impl(const MyDevice & dev, const vector<const Tensor*>& xs, Tensor& fx) const {
+    // c_t = tanh(Wxh * x_t + Whh * (r_t . h_tm1) + bh)
+    DYNET_ASSERT(xs.size() == 6, "Failed dimension check in GRUC::forward");
+    unsigned hidden_dim = fx.d[0];
+    unsigned batch_size = fx.d.bd;
+    Eigen::DSizes<ptrdiff_t, 2> indices_r(hidden_dim, 0);
+    Eigen::DSizes<ptrdiff_t, 2> sizes_1(hidden_dim, static_cast<ptrdiff_t>(batch_size));
+    Eigen::array<ptrdiff_t, 2> bcast = {1, (ptrdiff_t)batch_size};
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+    Tensor x_t = gru_batched(dev, *xs[0], batch_size, scratch_allocator);
+    Tensor h_tm1 = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+    Tensor gates_t = gru_batched(dev, *xs[2], batch_size, scratch_allocator);
+
+    Tensor rh(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+    rh.v = static_cast<float*>(scratch_allocator->allocate(rh.d.size() * sizeof(float)));
+    tbvec(rh).device(*dev.edevice) = tbvec(gates_t).slice(indices_r, sizes_1) * tbvec(h_tm1);
+
+    tbvec(fx).device(*dev.edevice) = tbvec(*xs[5]).broadcast(bcast);
+    MatrixMultiply(dev, *xs[3], x_t, fx, dev.kSCALAR_ONE);
+    MatrixMultiply(dev, *xs[4], rh, fx, dev.kSCALAR_ONE);
+    tvec(fx).device(*dev.edevice) = tvec(fx).tanh();
+    scratch_allocator->free();
+  }
+
+  template<class MyDevice>
+  void GRUC::backward_dev_impl(const MyDevice & dev,
+                               const vector<const Tensor*>& xs,
+                               const Tensor& fx,
+                               const Tensor& dEdf,
+                               unsigned i,
+                               Tensor& dEdxi) const {
+    unsigned hidden_dim = fx.d[0];
+    unsigned batch_size = fx.d.bd;
+    Eigen::DSizes<ptrdiff_t, 2> indices_r(hidden_dim, 0);
+    Eigen::DSizes<ptrdiff_t, 2> sizes_1(hidden_dim, static_cast<ptrdiff_t>(batch_size));
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+
+    // da = dc_t . (1 - c_t^2)
+    Tensor da(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+    da.v = static_cast<float*>(scratch_allocator->allocate(da.d.size() * sizeof(float)));
+    tvec(da).device(*dev.edevice) = tvec(dEdf) * (tvec(fx).constant(1) - tvec(fx).square());
+
+    if(i == 0) { // dx_t = Wxh^T * da
+      gru_transp_multiply_acc(dev, *xs[3], da, dEdxi, scratch_allocator);
+    } else if(i == 1 || i == 2) {
+      // drh = Whh^T * da
+      // dh_tm1 = drh . r_t
+      // dr_t = drh . h_tm1
+      Tensor drh(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+      drh.v = static_cast<float*>(scratch_allocator->allocate(drh.d.size() * sizeof(float)));
+      TensorTools::zero(drh);
+      MatrixTranspMultiplyAcc(dev, *xs[4], da, drh);
+      if(i == 1) {
+        Tensor gates_t = gru_batched(dev, *xs[2], batch_size, scratch_allocator);
+        tbvec(drh).device(*dev.edevice) = tbvec(drh) * tbvec(gates_t).slice(indices_r, sizes_1);
+        gru_accumulate(dev, drh, dEdxi);
+      } else {
+        Tensor h_tm1 = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+        tvec(drh).device(*dev.edevice) = tvec(drh) * tvec(h_tm1);
+        gru_accumulate(dev, drh, dEdxi, hidden_dim);
+      }
+    } else if(i == 3) { // dWxh = da * x_t^T, summed over the batch
+      Tensor x_t = gru_batched(dev, *xs[0], batch_size, scratch_allocator);
+      MatrixMultiplyTranspAcc(dev, da, x_t, dEdxi);
+    } else if(i == 4) { // dWhh = da * (r_t . h_tm1)^T, summed over the batch
+      Tensor h_tm1 = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+      Tensor gates_t = gru_batched(dev, *xs[2], batch_size, scratch_allocator);
+      Tensor rh(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+      rh.v = static_cast<float*>(scratch_allocator->allocate(rh.d.size() * sizeof(float)));
+      tbvec(rh).device(*dev.edevice) = tbvec(gates_t).slice(indices_r, sizes_1) * tbvec(h_tm1);
+      MatrixMultiplyTranspAcc(dev, da, rh, dEdxi);
+    } else { // dbh = da, summed over the batch
+      gru_accumulate(dev, da, dEdxi);
+    }
+    scratch_allocator->free();
+  }
+  DYNET_NODE_INST_DEV_IMPL(GRUC)
+
+// ************* GRU State *************
+
+#ifndef __CUDACC__
+
+  string GRUH::as_string(const vector<string>& arg_names) const {
+    ostringstream s;
+    s << "gru_h(" << arg_names[0] << ", " << arg_names[1] << ", " << arg_names[2] << ')';
+    return s.str();
+  }
+
+  Dim GRUH::dim_forward(const vector<Dim>& xs) const {
+    DYNET_ARG_CHECK(xs.size() == 3, "Failed input count check in GRUH");
+    unsigned batch_size = gru_batch_size(xs, 3, "GRUH");
+    unsigned hidden_dim = xs[0][0];
+    DYNET_ARG_CHECK(xs[0].ndims() == 1, "GRUH: h_tm1 expected to be a vector");
+    DYNET_ARG_CHECK(xs[1].ndims() == 1 && xs[1][0] == hidden_dim*2, "GRUH: gates_t expected 2 times as big as h_tm1, but " << xs[1][0] << " != 2*" << hidden_dim);
+    DYNET_ARG_CHECK(xs[2].ndims() == 1 && xs[2][0] == hidden_dim, "GRUH: c_t expected to be as big as h_tm1, but " << xs[2][0] << " != " << hidden_dim);
+    return Dim({hidden_dim}, batch_size);
+  }
+
+  int GRUH::autobatch_sig(const ComputationGraph & cg, SigMap &sm) const {
+    return gru_autobatch_sig(*this, cg, sm, nt::gru_h, 3);
+  }
+
+  std::vector<int> GRUH::autobatch_concat(const ComputationGraph & cg) const {
+    return gru_autobatch_concat(*this, cg, 3);
+  }
+
+#endif
+
+  template<class MyDevice>
+  void GRUH::forward_dev_impl(const MyDevice & dev, const vector<const Tensor*>& xs, Tensor& fx) const {
+    // h_t = h_tm1 + z_t . (c_t - h_tm1)
+    DYNET_ASSERT(xs.size() == 3, "Failed dimension check in GRUH::forward");
+    unsigned hidden_dim = fx.d[0];
+    unsigned batch_size = fx.d.bd;
+    Eigen::DSizes<ptrdiff_t, 2> indices_z(0, 0);
+    Eigen::DSizes<ptrdiff_t, 2> sizes_1(hidden_dim, static_cast<ptrdiff_t>(batch_size));
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+    Tensor h_tm1 = gru_batched(dev, *xs[0], batch_size, scratch_allocator);
+    Tensor gates_t = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+    Tensor c_t = gru_batched(dev, *xs[2], batch_size, scratch_allocator);
+    tbvec(fx).device(*dev.edevice) = tbvec(h_tm1) + tbvec(gates_t).slice(indices_z, sizes_1) * (tbvec(c_t) - tbvec(h_tm1));
+    scratch_allocator->free();
+  }
+
+  template<class MyDevice>
+  void GRUH::backward_dev_impl(const MyDevice & dev,
+                               const vector<const Tensor*>& xs,
+                               const Tensor& fx,
+                               const Tensor& dEdf,
+                               unsigned i,
+                               Tensor& dEdxi) const {
+    unsigned hidden_dim = fx.d[0];
+    unsigned batch_size = fx.d.bd;
+    Eigen::DSizes<ptrdiff_t, 2> indices_z(0, 0);
+    Eigen::DSizes<ptrdiff_t, 2> sizes_1(hidden_dim, static_cast<ptrdiff_t>(batch_size));
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+    Tensor gates_t = gru_batched(dev, *xs[1], batch_size, scratch_allocator);
+    Tensor d(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+    d.v = static_cast<float*>(scratch_allocator->allocate(d.d.size() * sizeof(float)));
+    if(i == 0) { // dh_tm1 = dh_t . (1 - z_t)
+      tbvec(d).device(*dev.edevice) = tbvec(dEdf) * (tbvec(dEdf).constant(1) - tbvec(gates_t).slice(indices_z, sizes_1));
+    } else if(i == 1) { // dz_t = dh_t . (c_t - h_tm1)
+      Tensor h_tm1 = gru_batched(dev, *xs[0], batch_size, scratch_allocator);
+      Tensor c_t = gru_batched(dev, *xs[2], batch_size, scratch_allocator);
+      tvec(d).device(*dev.edevice) = tvec(dEdf) * (tvec(c_t) - tvec(h_tm1));
+    } else { // dc_t = dh_t . z_t
+      tbvec(d).device(*dev.edevice) = tbvec(dEdf) * tbvec(gates_t).slice(indices_z, sizes_1);
+    }
+    gru_accumulate(dev, d, dEdxi);
+    scratch_allocator->free();
+  }
+  DYNET_NODE_INST_DEV_IMPL(GRUH)
+
+} // namespace dynet
@@ -0,0 +1,62 @@
+#ifndef DYNET_NODES_GRU_H_
+#define DYNET_NODES_GRU_H_
+
+#include "dynet/dynet.h"
+#include "dynet/nodes-def-macros.h"
+
+namespace dynet {
+
+// y = gru_gates(x_t, h_tm1, Wxz, Whz, bz, Wxr, Whr, br)
+// y = [sigmoid(Wxz * x_t + Whz * h_tm1 + bz); sigmoid(Wxr * x_t + Whr * h_tm1 + br)]
+struct GRUGates : public Node {
+  explicit GRUGates(const std::initializer_list<VariableIndex>& a) : Node(a) {}
+  virtual bool supports_multibatch() const override { return true; }
+  virtual int autobatch_sig(const ComputationGraph &cg, SigMap &sm) const override;
+  virtual std::vector<int> autobatch_concat(const ComputationGraph & cg) const override;
+  virtual void autobatch_reshape(const ComputationGraph & cg,
+                                 const std::vector<VariableIndex> & batch_ids,
+                                 const std::vector<int> & concat,
+                                 std::vector<const Tensor*>& xs,
+                                 Tensor& fx) const override {
+    autobatch_reshape_concatonly(cg, batch_ids, concat, xs, fx);
+  }
+  DYNET_NODE_DEFINE_DEV_IMPL()
+};
+
+// y = gru_c(x_t, h_tm1, gates_t, Wxh, Whh, bh)
+// y = tanh(Wxh * x_t + Whh * (r_t . h_tm1) + bh)
+struct GRUC : public Node {
+  explicit GRUC(const std::initializer_list<VariableIndex>& a) : Node(a) {}
+  virtual bool supports_multibatch() const override { return true; }
+  virtual int autobatch_sig(const ComputationGraph &cg, SigMap &sm) const override;
+  virtual std::vector<int> autobatch_concat(const ComputationGraph & cg) const override;
+  virtual void autobatch_reshape(const ComputationGraph & cg,
+                                 const std::vector<VariableIndex> & batch_ids,
+                                 const std::vector<int> & concat,
+                                 std::vector<const Tensor*>& xs,
+                                 Tensor& fx) const override {
+    autobatch_reshape_concatonly(cg, batch_ids, concat, xs, fx);
+  }
+  DYNET_NODE_DEFINE_DEV_IMPL()
+};
+
+// y = gru_h(h_tm1, gates_t, c_t)
+// y = (1 - z_t) . h_tm1 + z_t . c_t
+struct GRUH : public Node {
+  explicit GRUH(const std::initializer_list<VariableIndex>& a) : Node(a) {}
+  virtual bool supports_multibatch() const override { return true; }
+  virtual int autobatch_sig(const ComputationGraph &cg, SigMap &sm) const override;
+  virtual std::vector<int> autobatch_concat(const ComputationGraph & cg) const override;
+  virtual void autobatch_reshape(const ComputationGraph & cg,
+                                 const std::vector<VariableIndex> & batch_ids,
+                                 const std::vector<int> & concat,
+                                 std::vector<const Tensor*>& xs,
+                                 Tensor& fx) const override {
+    autobatch_reshape_concatonly(cg, batch_ids, concat, xs, fx);
+  }
+  DYNET_NODE_DEFINE_DEV_IMPL()
+};
+
+} // namespace dynet
+
+#endif
@@ -704,5 +704,284 @@ namespace dynet {
 
   DYNET_NODE_INST_DEV_IMPL(VanillaLSTMH)
 
+// ************* LSTM Sequence *************
+
+// The auxiliary memory holds a small header, the gates and their gradients
+// (one column per timestep and batch element, in timestep-major order), the
+// gradients of the initial state, and a copy of the gradient of the output
+// these were computed from.
+struct LSTMSequenceHeader {
+  unsigned dgates_valid;  // whether the gradients belong to the current forward pass
+};
+static const unsigned kLSTMSequenceHeader = 4;  // in floats
+static_assert(sizeof(LSTMSequenceHeader) <= kLSTMSequenceHeader * sizeof(float),
+              "The header of VanillaLSTMSequence does not fit its space");
+
+#ifndef __CUDACC__
+
+  string VanillaLSTMSequence::as_string(const vector<string>& arg_names) const {
+    ostringstream s;
+    s << "vanilla_lstm_sequence(" << arg_names[0];
+    for (size_t i = 1; i < arg_names.size(); ++i)
+      s << ", " << arg_names[i];
+    s << ')';
+    return s.str();
+  }
+
+  Dim VanillaLSTMSequence::dim_forward(const vector<Dim>& xs) const {
+    DYNET_ARG_CHECK(xs.size() == 6u + (masked ? 1 : 0) + (dropout ? 2 : 0), "Failed input count check in VanillaLSTMSequence");
+    const Dim &x = xs[0], &h0 = xs[1], &c0 = xs[2], &Wx = xs[3], &Wh = xs[4], &b = xs[5];
+    unsigned input_dim = x[0], seq_len = x[1], hidden_dim = h0[0], batch_size = x.bd;
+    DYNET_ARG_CHECK(x.ndims() <= 2, "VanillaLSTMSequence: x expected to be a matrix with one column per timestep, was " << x);
+    DYNET_ARG_CHECK(h0.ndims() == 1 && (h0.bd == batch_size || h0.bd == 1), "VanillaLSTMSequence: h0 expected to be a vector with batch size 1 or " << batch_size << ", was " << h0);
+    DYNET_ARG_CHECK(c0.ndims() == 1 && c0[0] == hidden_dim && (c0.bd == batch_size || c0.bd == 1), "VanillaLSTMSequence: c0 expected to have the dimension of h0, was " << c0);
+    DYNET_ARG_CHECK(Wx.ndims() == 2 && Wx[0] == hidden_dim * 4 && Wx[1] == input_dim && Wx.bd == 1, "VanillaLSTMSequence: Wx expected to be {" << hidden_dim * 4 << "," << input_dim << "}, was " << Wx);
+    DYNET_ARG_CHECK(Wh.ndims() == 2 && Wh[0] == hidden_dim * 4 && Wh[1] == hidden_dim && Wh.bd == 1, "VanillaLSTMSequence: Wh expected to be {" << hidden_dim * 4 << "," << hidden_dim << "}, was " << Wh);
+    DYNET_ARG_CHECK(b.ndims() == 1 && b[0] == hidden_dim * 4 && b.bd == 1, "VanillaLSTMSequence: b expected to be {" << hidden_dim * 4 << "}, was " << b);
+    unsigned next = 6;
+    if (masked) {
+      const Dim& mask = xs[next++];
+      DYNET_ARG_CHECK(mask.ndims() == 1 && mask[0] == seq_len && (mask.bd == batch_size || mask.bd == 1), "VanillaLSTMSequence: mask expected to be {" << seq_len << "} with batch size 1 or " << batch_size << ", was " << mask);
+    }
+    if (dropout) {
+      const Dim &mask_x = xs[next], &mask_h = xs[next + 1];
+      DYNET_ARG_CHECK(mask_x.ndims() == 1 && mask_x[0] == input_dim && (mask_x.bd == batch_size || mask_x.bd == 1), "VanillaLSTMSequence: dropout_mask_x expected to be {" << input_dim << "} with batch size 1 or " << batch_size << ", was " << mask_x);
+      DYNET_ARG_CHECK(mask_h.ndims() == 1 && mask_h[0] == hidden_dim && (mask_h.bd == batch_size || mask_h.bd == 1), "VanillaLSTMSequence: dropout_mask_h expected to be {" << hidden_dim << "} with batch size 1 or " << batch_size << ", was " << mask_h);
+    }
+    return Dim({hidden_dim, seq_len, 2}, batch_size);
+  }
+
+  size_t VanillaLSTMSequence::aux_storage_size() const {
+    const size_t hidden_dim = dim[0], cols = dim[1] * dim.bd;
+    return (kLSTMSequenceHeader + 2 * hidden_dim * 4 * cols + 2 * hidden_dim * dim.bd + dim.size()) * sizeof(float);
+  }
+
+  // Copies the inputs in timestep-major order, applying the dropout mask
+  static void lstm_sequence_inputs(const Tensor& x, const Tensor* mask_x, Tensor& x_tm) {
+    const unsigned input_dim = x.d[0], seq_len = x.d[1], batch_size = x.d.bd;
+    for (unsigned b = 0; b < batch_size; ++b) {
+      const float* x_b = x.batch_ptr(b);
+      for (unsigned t = 0; t < seq_len; ++t) {
+        Eigen::Map<Eigen::ArrayXf> y(x_tm.v + (t * batch_size + b) * input_dim, input_dim);
+        Eigen::Map<const Eigen::ArrayXf> x_t(x_b + t * input_dim, input_dim);
+        if (mask_x)
+          y = x_t * Eigen::Map<const Eigen::ArrayXf>(mask_x->batch_ptr(b), input_dim);
+        else
+          y = x_t;
+      }
+    }
+  }
+
+  // Copies the hidden states of timestep t-1 of all batch elements (h0 for
+  // t = 0), applying the dropout mask
+  static void lstm_sequence_h_tm1(const Tensor& h0, const Tensor& fx, const Tensor* mask_h,
+                                  unsigned t, float* h_tm1) {
+    const unsigned hidden_dim = fx.d[0], batch_size = fx.d.bd;
+    for (unsigned b = 0; b < batch_size; ++b) {
+      Eigen::Map<Eigen::ArrayXf> y(h_tm1 + b * hidden_dim, hidden_dim);
+      Eigen::Map<const Eigen::ArrayXf> h(t ? fx.batch_ptr(b) + (t - 1) * hidden_dim : h0.batch_ptr(b), hidden_dim);
+      if (mask_h)
+        y = h * Eigen::Map<const Eigen::ArrayXf>(mask_h->batch_ptr(b), hidden_dim);
+      else
+        y = h;
+    }
+  }
+
+  static inline bool lstm_sequence_step(const Tensor* mask, unsigned b, unsigned t) {
+    return mask == nullptr || mask->batch_ptr(b)[t] != 0.f;
+  }
+
+#endif
+
+  template<class MyDevice>
+  void VanillaLSTMSequence::forward_dev_impl(const MyDevice & dev, const vector<const Tensor*>& xs, Tensor& fx) const {
+#ifdef __CUDACC__
+    DYNET_NO_CUDA_IMPL_ERROR("VanillaLSTMSequence forward");
+#else
+    // for each timestep t (see VanillaLSTMGates, VanillaLSTMC and VanillaLSTMH):
+    //   gates_t = [sigmoid; sigmoid; sigmoid; tanh] (Wx * x_t + Wh * h_tm1 + b)
+    //   c_t = gates_f . c_tm1 + gates_i . gates_g
+    //   h_t = gates_o . tanh(c_t)
+    // where the mask is 0, the state is carried over: h_t = h_tm1, c_t = c_tm1
+    const unsigned hidden_dim = fx.d[0], seq_len = fx.d[1], batch_size = fx.d.bd;
+    const unsigned input_dim = xs[0]->d[0], cols = seq_len * batch_size;
+    const Tensor* mask = masked ? xs[6] : nullptr;
+    const Tensor* mask_x = dropout ? xs[masked ? 7 : 6] : nullptr;
+    const Tensor* mask_h = dropout ? xs[masked ? 8 : 7] : nullptr;
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+
+    float* aux = static_cast<float*>(aux_mem);
+    static_cast<LSTMSequenceHeader*>(aux_mem)->dgates_valid = 0;
+    Tensor gates(Dim({hidden_dim * 4, cols}), aux + kLSTMSequenceHeader, fx.device, fx.mem_pool);
+
+    // the input projections of all timesteps are a single multiplication
+    Tensor x_tm(Dim({input_dim, cols}), nullptr, fx.device, fx.mem_pool);
+    x_tm.v = static_cast<float*>(scratch_allocator->allocate(x_tm.d.size() * sizeof(float)));
+    lstm_sequence_inputs(*xs[0], mask_x, x_tm);
+    Eigen::Map<Eigen::MatrixXf> gates_mat(gates.v, hidden_dim * 4, cols);
+    gates_mat.colwise() = Eigen::Map<const Eigen::VectorXf>(xs[5]->v, hidden_dim * 4);
+    gates_mat.middleRows(hidden_dim, hidden_dim).array() += forget_gate_bias;
+    MatrixMultiply(dev, *xs[3], x_tm, gates, dev.kSCALAR_ONE);
+
+    Tensor h_tm1(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+    h_tm1.v = static_cast<float*>(scratch_allocator->allocate(h_tm1.d.size() * sizeof(float)));
+    for (unsigned t = 0; t < seq_len; ++t) {
+      Tensor gates_t(Dim({hidden_dim * 4}, batch_size), gates.v + t * batch_size * hidden_dim * 4, fx.device, fx.mem_pool);
+      lstm_sequence_h_tm1(*xs[1], fx, mask_h, t, h_tm1.v);
+      MatrixMultiply(dev, *xs[4], h_tm1, gates_t, dev.kSCALAR_ONE);
+      for (unsigned b = 0; b < batch_size; ++b) {
+        float* h_t = fx.batch_ptr(b) + t * hidden_dim;
+        float* c_t = fx.batch_ptr(b) + (seq_len + t) * hidden_dim;
+        const float* h_prev = t ? h_t - hidden_dim : xs[1]->batch_ptr(b);
+        const float* c_prev = t ? c_t - hidden_dim : xs[2]->batch_ptr(b);
+        if (!lstm_sequence_step(mask, b, t)) {
+          memcpy(h_t, h_prev, sizeof(float) * hidden_dim);
+          memcpy(c_t, c_prev, sizeof(float) * hidden_dim);
+          continue;
+        }
+        float* g = gates_t.v + b * hidden_dim * 4;
+        Eigen::Map<Eigen::ArrayXf> ifo(g, hidden_dim * 3), cand(g + hidden_dim * 3, hidden_dim);
+        ifo = ifo.unaryExpr(scalar_logistic_sigmoid_op<float>());
+        cand = cand.tanh();
+        Eigen::Map<Eigen::ArrayXf> c(c_t, hidden_dim), h(h_t, hidden_dim);
+        c = ifo.segment(hidden_dim, hidden_dim) * Eigen::Map<const Eigen::ArrayXf>(c_prev, hidden_dim) + ifo.head(hidden_dim) * cand;
+        h = ifo.tail(hidden_dim) * c.tanh();
+      }
+    }
+    scratch_allocator->free();
+#endif
+  }
+
+  template<class MyDevice>
+  void VanillaLSTMSequence::backward_dev_impl(const MyDevice & dev,
+                               const vector<const Tensor*>& xs,
+                               const Tensor& fx,
+                               const Tensor& dEdf,
+                               unsigned i,
+                               Tensor& dEdxi) const {
+#ifdef __CUDACC__
+    DYNET_NO_CUDA_IMPL_ERROR("VanillaLSTMSequence backward");
+#else
+    // the masks get no gradient
+    if (i > 5) return;
+    const unsigned hidden_dim = fx.d[0], seq_len = fx.d[1], batch_size = fx.d.bd;
+    const unsigned input_dim = xs[0]->d[0], cols = seq_len * batch_size;
+    const Tensor* mask = masked ? xs[6] : nullptr;
+    const Tensor* mask_x = dropout ? xs[masked ? 7 : 6] : nullptr;
+    const Tensor* mask_h = dropout ? xs[masked ? 8 : 7] : nullptr;
+
+    AlignedMemoryPool* scratch_allocator = fx.device->pools[(int)DeviceMempool::SCS];
+
+    float* aux = static_cast<float*>(aux_mem);
+    const size_t gates_size = size_t(hidden_dim) * 4 * cols;
+    Tensor gates(Dim({hidden_dim * 4, cols}), aux + kLSTMSequenceHeader, fx.device, fx.mem_pool);
+    Tensor dgates(Dim({hidden_dim * 4, cols}), gates.v + gates_size, fx.device, fx.mem_pool);
+    Tensor dh(Dim({hidden_dim}, batch_size), dgates.v + gates_size, fx.device, fx.mem_pool);
+    Tensor dc(Dim({hidden_dim}, batch_size), dh.v + dh.d.size(), fx.device, fx.mem_pool);
+    float* dEdf_copy = dc.v + dc.d.size();
+
+    // The gradients of the gates are needed for every argument. They are
+    // computed again unless they were computed since the last forward pass
+    // from the same gradient of the output, whatever argument asked for them.
+    LSTMSequenceHeader* header = static_cast<LSTMSequenceHeader*>(aux_mem);
+    const size_t dEdf_bytes = dEdf.d.size() * sizeof(float);
+    if (!header->dgates_valid || memcmp(dEdf_copy, dEdf.v, dEdf_bytes) != 0) {
+      // dh and dc hold the gradients flowing back from timestep t+1, and end
+      // up as the gradients of h0 and c0
+      TensorTools::zero(dh);
+      TensorTools::zero(dc);
+      Tensor dh_rec(Dim({hidden_dim}, batch_size), nullptr, fx.device, fx.mem_pool);
+      dh_rec.v = static_cast<float*>(scratch_allocator->allocate(dh_rec.d.size() * sizeof(float)));
+      Eigen::Map<Eigen::ArrayXf> tanh_c(static_cast<float*>(scratch_allocator->allocate(hidden_dim * sizeof(float))), hidden_dim);
+      for (unsigned t = seq_len; t-- > 0; ) {
+        Tensor dgates_t(Dim({hidden_dim * 4}, batch_size), dgates.v + t * batch_size * hidden_dim * 4, fx.device, fx.mem_pool);
+        for (unsigned b = 0; b < batch_size; ++b) {
+          Eigen::Map<Eigen::ArrayXf> dh_b(dh.v + b * hidden_dim, hidden_dim), dc_b(dc.v + b * hidden_dim, hidden_dim);
+          dh_b += Eigen::Map<const Eigen::ArrayXf>(dEdf.batch_ptr(b) + t * hidden_dim, hidden_dim);
+          dc_b += Eigen::Map<const Eigen::ArrayXf>(dEdf.batch_ptr(b) + (seq_len + t) * hidden_dim, hidden_dim);
+          Eigen::Map<Eigen::ArrayXf> da(dgates_t.v + b * hidden_dim * 4, hidden_dim * 4);
+          if (!lstm_sequence_step(mask, b, t)) {
+            da.setZero();
+            continue;
+          }
+          const float* g = gates.v + (t * batch_size + b) * hidden_dim * 4;
+          Eigen::Map<const Eigen::ArrayXf> i_t(g, hidden_dim), f_t(g + hidden_dim, hidden_dim),
+                                           o_t(g + hidden_dim * 2, hidden_dim), g_t(g + hidden_dim * 3, hidden_dim);
+          const float* c_b = fx.batch_ptr(b) + seq_len * hidden_dim;
+          Eigen::Map<const Eigen::ArrayXf> c_t(c_b + t * hidden_dim, hidden_dim),
+                                           c_tm1(t ? c_b + (t - 1) * hidden_dim : xs[2]->batch_ptr(b), hidden_dim);
+          // h_t = o_t . tanh(c_t)
+          tanh_c = c_t.tanh();
+          da.segment(hidden_dim * 2, hidden_dim) = dh_b * tanh_c * o_t * (1.f - o_t);
+          dc_b += dh_b * o_t * (1.f - tanh_c.square());
+          // c_t = f_t . c_tm1 + i_t . g_t
+          da.head(hidden_dim) = dc_b * g_t * i_t * (1.f - i_t);
+          da.segment(hidden_dim, hidden_dim) = dc_b * c_tm1 * f_t * (1.f - f_t);
+          da.tail(hidden_dim) = dc_b * i_t * (1.f - g_t.square());
+          dc_b *= f_t;
+          dh_b.setZero();
+        }
+        // dh_tm1 += (Wh^T * dgates_t) . mask_h
+        TensorTools::zero(dh_rec);
+        MatrixTranspMultiplyAcc(dev, *xs[4], dgates_t, dh_rec);
+        if (mask_h) {
+          for (unsigned b = 0; b < batch_size; ++b)
+            Eigen::Map<Eigen::ArrayXf>(dh.v + b * hidden_dim, hidden_dim) +=
+              Eigen::Map<const Eigen::ArrayXf>(dh_rec.v + b * hidden_dim, hidden_dim) *
+              Eigen::Map<const Eigen::ArrayXf>(mask_h->batch_ptr(b), hidden_dim);
+        } else {
+          tvec(dh).device(*dev.edevice) += tvec(dh_rec);
+        }
+      }
+      memcpy(dEdf_copy, dEdf.v, dEdf_bytes);
+      header->dgates_valid = 1;
+    }
+
+    if (i == 0) {
+      // dx = (Wx^T * dgates) . mask_x, back in batch-major order
+      Tensor dx_tm(Dim({input_dim, cols}), nullptr, fx.device, fx.mem_pool);
+      dx_tm.v = static_cast<float*>(scratch_allocator->allocate(dx_tm.d.size() * sizeof(float)));
+      TensorTools::zero(dx_tm);
+      MatrixTranspMultiplyAcc(dev, *xs[3], dgates, dx_tm);
+      for (unsigned b = 0; b < batch_size; ++b) {
+        for (unsigned t = 0; t < seq_len; ++t) {
+          Eigen::Map<Eigen::ArrayXf> dx_t(dEdxi.batch_ptr(b) + t * input_dim, input_dim);
+          Eigen::Map<const Eigen::ArrayXf> dy(dx_tm.v + (t * batch_size + b) * input_dim, input_dim);
+          if (mask_x)
+            dx_t += dy * Eigen::Map<const Eigen::ArrayXf>(mask_x->batch_ptr(b), input_dim);
+          else
+            dx_t += dy;
+        }
+      }
+    } else if (i == 1 || i == 2) {
+      // dh0 and dc0, summed over the batch if the initial state is shared
+      const Tensor& d0 = (i == 1 ? dh : dc);
+      if (dEdxi.d.bd == batch_size)
+        tvec(dEdxi).device(*dev.edevice) += tvec(d0);
+      else
+        vec(dEdxi) += colbatch_matrix(d0).rowwise().sum();
+    } else if (i == 3) {
+      // dWx = dgates * x^T
+      Tensor x_tm(Dim({input_dim, cols}), nullptr, fx.device, fx.mem_pool);
+      x_tm.v = static_cast<float*>(scratch_allocator->allocate(x_tm.d.size() * sizeof(float)));
+      lstm_sequence_inputs(*xs[0], mask_x, x_tm);
+      MatrixMultiplyTranspAcc(dev, dgates, x_tm, dEdxi);
+    } else if (i == 4) {
+      // dWh = dgates * h_tm1^T
+      Tensor h_tm1(Dim({hidden_dim, cols}), nullptr, fx.device, fx.mem_pool);
+      h_tm1.v = static_cast<float*>(scratch_allocator->allocate(h_tm1.d.size() * sizeof(float)));
+      for (unsigned t = 0; t < seq_len; ++t)
+        lstm_sequence_h_tm1(*xs[1], fx, mask_h, t, h_tm1.v + t * batch_size * hidden_dim);
+      MatrixMultiplyTranspAcc(dev, dgates, h_tm1, dEdxi);
+    } else {
+      // db = sum of dgates over timesteps and batch elements
+      vec(dEdxi) += mat(dgates).rowwise().sum();
+    }
+    scratch_allocator->free();
+#endif
+  }
+
+  DYNET_NODE_INST_DEV_IMPL(VanillaLSTMSequence)
 
 }
@@ -53,6 +53,24 @@ struct VanillaLSTMH : public Node {
   DYNET_NODE_DEFINE_DEV_IMPL()
 };
 
+// y = vanilla_lstm_sequence(x, h0, c0, Wx, Wh, b[, mask][, dropout_mask_x, dropout_mask_h])
+// x has one column per timestep, y is {H, T, 2}: the hidden states, then the
+// cell states of every timestep. The gates are kept in the auxiliary memory
+// for the backward pass. CPU only.
+// backward() may be called for any subset of the arguments, in any order. The
+// gradients of the gates, which all arguments need, are computed by the first
+// call after forward() and reused by later calls with the same dEdf, so the
+// arguments must not change in between without a new forward pass.
+struct VanillaLSTMSequence : public Node {
+  explicit VanillaLSTMSequence(const std::vector<VariableIndex>& a, bool masked, bool dropout, real forget_gate_bias)
+    : Node(a), masked(masked), dropout(dropout), forget_gate_bias(forget_gate_bias) {}
+  virtual bool supports_multibatch() const override { return true; }
+  size_t aux_storage_size() const override;
+  bool masked;
+  bool dropout;
+  const real forget_gate_bias;
+  DYNET_NODE_DEFINE_DEV_IMPL()
+};
 
 } // namespace dynet
 
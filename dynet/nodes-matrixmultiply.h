@@ -8,7 +8,7 @@ namespace dynet {
 
 // y = x_1 * x_2
 struct MatrixMultiply : public Node {
-  explicit MatrixMultiply(const std::initializer_list<VariableIndex>& a) : Node(a) {}
+  explicit MatrixMultiply(const std::initializer_list<VariableIndex>& a, const Parameter& lp = Parameter()) : Node(a), lp(lp) {}
   virtual bool supports_multibatch() const override { return true; }
   virtual int autobatch_sig(const ComputationGraph &cg, SigMap &sm) const override;
   virtual std::vector<int> autobatch_concat(const ComputationGraph & cg) const override;
@@ -20,6 +20,7 @@ struct MatrixMultiply : public Node {
     autobatch_reshape_concatonly(cg, batch_ids, concat, xs, fx);
   }
   DYNET_NODE_DEFINE_DEV_IMPL()
+  Parameter lp; // the parameter the left operand holds, if its packed values are used
 };
 
 } // namespace dynet
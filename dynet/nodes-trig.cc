@@ -321,8 +321,12 @@ void Tanh::backward_dev_impl(const MyDevice & dev,
                              const Tensor& dEdf,
                              unsigned i,
                              Tensor& dEdxi) const {
-  tvec(dEdxi).device(*dev.edevice) += 
-      tvec(fx).binaryExpr(tvec(dEdf), scalar_tanh_backward_op<float>());
+  if (backward_assigns())
+    tvec(dEdxi).device(*dev.edevice) =
+        tvec(fx).binaryExpr(tvec(dEdf), scalar_tanh_backward_op<float>());
+  else
+    tvec(dEdxi).device(*dev.edevice) +=
+        tvec(fx).binaryExpr(tvec(dEdf), scalar_tanh_backward_op<float>());
 }
 DYNET_NODE_INST_DEV_IMPL(Tanh)
 
@@ -32,3 +32,4 @@
 #include "dynet/nodes-trig.h"
 #include "dynet/nodes-to-device.h"
 #include "dynet/nodes-lstm.h"
+#include "dynet/nodes-gru.h"
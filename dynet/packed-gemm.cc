@@ -0,0 +1,106 @@
+#include "dynet/packed-gemm.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <Eigen/Core>
+
+using namespace std;
+
+namespace dynet {
+
+namespace {
+
+typedef Eigen::internal::packet_traits<float>::type Packet;
+const unsigned kPacketSize = Eigen::internal::packet_traits<float>::size;
+// Rows of a panel: two packets, so that each element of x loaded is used by
+// two fused multiply-adds
+const unsigned kPanelRows = 2 * kPacketSize;
+
+// y[0:nr] += the two packets of acc
+inline void add_panel_column(const Packet acc[2], unsigned nr, float* y) {
+  using namespace Eigen::internal;
+  if (nr == kPanelRows) {
+    pstoreu(y, padd(ploadu<Packet>(y), acc[0]));
+    pstoreu(y + kPacketSize, padd(ploadu<Packet>(y + kPacketSize), acc[1]));
+  } else {
+    EIGEN_ALIGN_MAX float tmp[kPanelRows];
+    pstore(tmp, acc[0]);
+    pstore(tmp + kPacketSize, acc[1]);
+    for (unsigned r = 0; r < nr; ++r)
+      y[r] += tmp[r];
+  }
+}
+
+} // namespace
+
+// Panel p holds rows [p*kPanelRows, (p+1)*kPanelRows) of the matrix, column
+// by column, padded with zeros past the last row.
+PackedMatrix::PackedMatrix(const float* data, unsigned rows, unsigned cols, float scale) :
+    rows(rows), cols(cols) {
+  const unsigned num_panels = (rows + kPanelRows - 1) / kPanelRows;
+  const size_t size = (size_t)num_panels * kPanelRows * cols;
+  panels = static_cast<float*>(Eigen::internal::aligned_malloc(max(size, (size_t)1) * sizeof(float)));
+  memset(panels, 0, size * sizeof(float));
+  for (unsigned p = 0; p < num_panels; ++p) {
+    float* panel = panels + (size_t)p * kPanelRows * cols;
+    const unsigned r0 = p * kPanelRows, nr = min(kPanelRows, rows - r0);
+    for (unsigned j = 0; j < cols; ++j) {
+      const float* src = data + (size_t)j * rows + r0;
+      float* dst = panel + (size_t)j * kPanelRows;
+      for (unsigned r = 0; r < nr; ++r)
+        dst[r] = src[r] * scale;
+    }
+  }
+}
+
+PackedMatrix::~PackedMatrix() {
+  Eigen::internal::aligned_free(panels);
+}
+
+// Each panel is multiplied by four columns of x at a time, keeping the
+// 2 packets x 4 columns of the result in registers.
+void PackedMatrix::multiply_acc(const float* x, unsigned n, float* y) const {
+  using namespace Eigen::internal;
+  const unsigned num_panels = (rows + kPanelRows - 1) / kPanelRows;
+  for (unsigned p = 0; p < num_panels; ++p) {
+    const float* a = panels + (size_t)p * kPanelRows * cols;
+    const unsigned r0 = p * kPanelRows, nr = min(kPanelRows, rows - r0);
+    unsigned c = 0;
+    for (; c + 4 <= n; c += 4) {
+      Packet acc[4][2];
+      for (unsigned jj = 0; jj < 4; ++jj)
+        acc[jj][0] = acc[jj][1] = pset1<Packet>(0.f);
+      const float* x0 = x + (size_t)c * cols;
+      const float* x1 = x0 + cols;
+      const float* x2 = x1 + cols;
+      const float* x3 = x2 + cols;
+      for (unsigned j = 0; j < cols; ++j) {
+        const Packet a0 = pload<Packet>(a + (size_t)j * kPanelRows);
+        const Packet a1 = pload<Packet>(a + (size_t)j * kPanelRows + kPacketSize);
+        Packet b = pset1<Packet>(x0[j]);
+        acc[0][0] = pmadd(a0, b, acc[0][0]); acc[0][1] = pmadd(a1, b, acc[0][1]);
+        b = pset1<Packet>(x1[j]);
+        acc[1][0] = pmadd(a0, b, acc[1][0]); acc[1][1] = pmadd(a1, b, acc[1][1]);
+        b = pset1<Packet>(x2[j]);
+        acc[2][0] = pmadd(a0, b, acc[2][0]); acc[2][1] = pmadd(a1, b, acc[2][1]);
+        b = pset1<Packet>(x3[j]);
+        acc[3][0] = pmadd(a0, b, acc[3][0]); acc[3][1] = pmadd(a1, b, acc[3][1]);
+      }
+      for (unsigned jj = 0; jj < 4; ++jj)
+        add_panel_column(acc[jj], nr, y + (size_t)(c + jj) * rows + r0);
+    }
+    for (; c < n; ++c) {
+      Packet acc[2] = {pset1<Packet>(0.f), pset1<Packet>(0.f)};
+      const float* x0 = x + (size_t)c * cols;
+      for (unsigned j = 0; j < cols; ++j) {
+        const Packet b = pset1<Packet>(x0[j]);
+        acc[0] = pmadd(pload<Packet>(a + (size_t)j * kPanelRows), b, acc[0]);
+        acc[1] = pmadd(pload<Packet>(a + (size_t)j * kPanelRows + kPacketSize), b, acc[1]);
+      }
+      add_panel_column(acc, nr, y + (size_t)c * rows + r0);
+    }
+  }
+}
+
+} // namespace dynet
@@ -0,0 +1,52 @@
+#ifndef DYNET_PACKED_GEMM_H
+#define DYNET_PACKED_GEMM_H
+
+#include <cstddef>
+
+namespace dynet {
+
+/**
+ * \ingroup params
+ * \brief A column-major matrix stored as panels of consecutive rows, ready
+ *        to be multiplied on CPU by matrices with a few columns
+ * \details General matrix multiplication repacks its left operand on every
+ *          call. When the left operand is a parameter multiplied by a few
+ *          columns at a time (e.g. while decoding), the packing is a large
+ *          share of the cost. A PackedMatrix is packed once, and its product
+ *          with matrices of up to kMaxCols columns is computed directly from
+ *          the panels.
+ */
+class PackedMatrix {
+ public:
+  /**
+   * \brief Most columns of the right operand for which multiply_acc() is
+   *        faster than an unpacked multiplication
+   */
+  static const unsigned kMaxCols = 8;
+
+  /**
+   * \brief Pack a column-major matrix, multiplied by scale
+   */
+  PackedMatrix(const float* data, unsigned rows, unsigned cols, float scale = 1.f);
+  ~PackedMatrix();
+  PackedMatrix(const PackedMatrix&) = delete;
+  PackedMatrix& operator=(const PackedMatrix&) = delete;
+
+  /**
+   * \brief y += this * x
+   *
+   * \param x Column-major matrix of cols rows and n columns
+   * \param n Number of columns of x
+   * \param y Column-major matrix of rows rows and n columns
+   */
+  void multiply_acc(const float* x, unsigned n, float* y) const;
+
+  unsigned rows, cols;
+
+ private:
+  float* panels;
+};
+
+} // namespace dynet
+
+#endif
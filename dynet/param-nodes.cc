@@ -49,6 +49,12 @@ void ParameterNode::accumulate_grad(const Tensor& g) {
     DYNET_RUNTIME_ERR("ParameterNode has neither Parameter nor LookupParameter");
 }
 
+ParameterStorageBase* ParameterNode::get_storage() const {
+  if(params.p != nullptr)
+    return params.p.get();
+  return lparams.p.get();
+}
+
 string InputNode::as_string(const vector<string>& arg_names) const {
   ostringstream s;
   s << "constant(" << dim << ')';
@@ -165,6 +171,10 @@ Dim LookupNode::dim_forward(const vector<Dim>& xs) const {
   return dim;
 }
 
+ParameterStorageBase* LookupNode::get_storage() const {
+  return params.p.get();
+}
+
 void LookupNode::accumulate_grad(const Tensor& g) {
   if(pindex) {
     params.get_storage().accumulate_grad(*pindex, g);
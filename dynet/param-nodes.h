@@ -9,6 +9,8 @@ namespace dynet {
 
 struct ParameterNodeBase : public Node {
   virtual void accumulate_grad(const Tensor& g) = 0;
+  // the storage that accumulate_grad() writes to
+  virtual ParameterStorageBase* get_storage() const = 0;
 };
 
 // represents optimizable parameters
@@ -17,6 +19,7 @@ struct ParameterNode : public ParameterNodeBase {
   explicit ParameterNode(const LookupParameter & lp) : dim(lp.get_storage().all_dim), lparams(lp) {}
   DYNET_NODE_DEFINE_DEV_IMPL()
   void accumulate_grad(const Tensor& g) override;
+  ParameterStorageBase* get_storage() const override;
   Dim dim;
   Parameter params;
   LookupParameter lparams;
@@ -101,6 +104,7 @@ struct LookupNode : public ParameterNodeBase {
   }
   size_t aux_storage_size() const override;
   void accumulate_grad(const Tensor& g) override;
+  ParameterStorageBase* get_storage() const override;
   Dim dim;
   unsigned index;
   const unsigned* pindex;
@@ -0,0 +1,232 @@
+#include "dynet/profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tuple>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+#include "dynet/dynet.h"
+#include "dynet/devices.h"
+#include "dynet/except.h"
+
+using namespace std;
+
+namespace dynet {
+
+Profiler profiler;
+
+static const char* kind_name(ProfileKind kind) {
+  switch (kind) {
+    case ProfileKind::FORWARD: return "forward";
+    case ProfileKind::BACKWARD: return "backward";
+    case ProfileKind::PLAN: return "plan";
+    case ProfileKind::COPY: return "copy";
+    case ProfileKind::ACCUMULATE: return "accumulate";
+    case ProfileKind::UPDATE: return "update";
+  }
+  return "unknown";
+}
+
+// Numbers threads in the order in which they first record an event
+static unsigned this_thread_number() {
+  static std::atomic<unsigned> num_threads(0);
+  thread_local unsigned number = num_threads++;
+  return number;
+}
+
+static string json_escape(const string& s) {
+  string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+Profiler::Profiler() : epoch(std::chrono::steady_clock::now()), mask(0), next(0) {}
+
+Profiler::~Profiler() {
+  const uint64_t n = next;
+  if (n == 0) return;
+  if (!trace_file.empty()) {
+    try {
+      write_chrome_trace(trace_file);
+    } catch (const std::exception& e) {
+      cerr << e.what() << endl;
+    }
+  }
+  cout << "Profile:" << endl;
+  write_summary(cout, profiling_flag > 1);
+}
+
+void Profiler::reserve(size_t capacity) {
+  DYNET_ARG_CHECK(capacity > 0, "Profiler::reserve requires a capacity of at least one event");
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+  events.resize(size);
+  mask = size - 1;
+  next = 0;
+}
+
+vector<ProfileEvent> Profiler::get_events() const {
+  const uint64_t n = next;
+  const uint64_t first = n > events.size() ? n - events.size() : 0;
+  vector<ProfileEvent> ret;
+  ret.reserve(n - first);
+  for (uint64_t i = first; i < n; ++i)
+    ret.push_back(events[i & mask]);
+  return ret;
+}
+
+uint64_t Profiler::num_dropped() const {
+  const uint64_t n = next;
+  return n > events.size() ? n - events.size() : 0;
+}
+
+string Profiler::event_name(const ProfileEvent& ev) {
+  if (ev.type == nullptr)
+    return ev.name != nullptr ? ev.name : kind_name(ev.kind);
+  return type_name(*ev.type);
+}
+
+string Profiler::type_name(const type_info& type) {
+  string name = type.name();
+#ifdef __GNUG__
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+  if (status == 0 && demangled != nullptr) name = demangled;
+  free(demangled);
+#endif
+  if (name.compare(0, 7, "dynet::") == 0) name = name.substr(7);
+  return name;
+}
+
+// Demangling is slow, so the names of node types are looked up once
+static string cached_name(const ProfileEvent& ev, map<const type_info*, string>& type_names) {
+  if (ev.type == nullptr) return Profiler::event_name(ev);
+  auto it = type_names.find(ev.type);
+  if (it == type_names.end())
+    it = type_names.insert(make_pair(ev.type, Profiler::event_name(ev))).first;
+  return it->second;
+}
+
+void Profiler::write_chrome_trace(ostream& os) const {
+  const vector<ProfileEvent> evs = get_events();
+  map<const type_info*, string> type_names;
+  os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n"
+     << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"dynet\"}}";
+  for (const ProfileEvent& ev : evs) {
+    const string name = cached_name(ev, type_names);
+    ostringstream dim;
+    dim << ev.dim;
+    os << ",\n{\"name\": \"" << json_escape(name) << "\", \"cat\": \"" << kind_name(ev.kind)
+       << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << ev.thread
+       << fixed << setprecision(3)
+       << ", \"ts\": " << ev.start_ns / 1000.0
+       << ", \"dur\": " << (ev.end_ns - ev.start_ns) / 1000.0
+       << defaultfloat
+       << ", \"args\": {\"dim\": \"" << dim.str() << "\", \"batch_size\": " << ev.batch_size
+       << ", \"sig\": " << ev.sig << ", \"device\": " << ev.device_id
+       << ", \"bytes\": " << ev.bytes << "}}";
+  }
+  os << "\n]}" << endl;
+}
+
+void Profiler::write_chrome_trace(const string& filename) const {
+  ofstream out(filename);
+  if (!out)
+    DYNET_RUNTIME_ERR("Could not open " << filename << " to write the profile trace");
+  write_chrome_trace(out);
+}
+
+void Profiler::write_summary(ostream& os, bool by_dim) const {
+  struct Total {
+    double ms = 0;
+    size_t calls = 0, nodes = 0, bytes = 0;
+  };
+  // (kind, type or name, dim) -> totals
+  map<tuple<int, string, string>, Total> totals;
+  map<const type_info*, string> type_names;
+  // Events of a thread may be nested (e.g. copies within the backward pass of
+  // a batch); their time is only counted for the innermost event
+  vector<ProfileEvent> evs = get_events();
+  sort(evs.begin(), evs.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+    return a.thread != b.thread ? a.thread < b.thread :
+           a.start_ns != b.start_ns ? a.start_ns < b.start_ns : a.end_ns > b.end_ns;
+  });
+  vector<double> self_ms(evs.size());
+  vector<size_t> open;
+  for (size_t i = 0; i < evs.size(); ++i) {
+    while (!open.empty() && (evs[open.back()].thread != evs[i].thread ||
+                             evs[open.back()].end_ns <= evs[i].start_ns))
+      open.pop_back();
+    self_ms[i] = (evs[i].end_ns - evs[i].start_ns) / 1e6;
+    if (!open.empty()) self_ms[open.back()] -= self_ms[i];
+    open.push_back(i);
+  }
+  double total_ms = 0;
+  for (size_t i = 0; i < evs.size(); ++i) {
+    const ProfileEvent& ev = evs[i];
+    const string name = cached_name(ev, type_names);
+    string dim;
+    if (by_dim) {
+      ostringstream ss;
+      ss << ev.dim;
+      dim = ss.str();
+    }
+    Total& t = totals[make_tuple((int)ev.kind, name, dim)];
+    const double ms = self_ms[i];
+    t.ms += ms;
+    ++t.calls;
+    t.nodes += ev.batch_size;
+    t.bytes += ev.bytes;
+    total_ms += ms;
+  }
+  vector<pair<double, decltype(totals)::const_iterator>> sorted;
+  for (auto it = totals.begin(); it != totals.end(); ++it)
+    sorted.push_back(make_pair(it->second.ms, it));
+  sort(sorted.begin(), sorted.end(),
+       [](const pair<double, decltype(totals)::const_iterator>& a,
+          const pair<double, decltype(totals)::const_iterator>& b) { return a.first > b.first; });
+  os << setw(11) << "ms" << setw(8) << "%" << setw(10) << "calls" << setw(10) << "nodes"
+     << setw(11) << "us/call" << setw(11) << "MB" << "  kind        operation" << endl;
+  for (auto & item : sorted) {
+    const Total& t = item.second->second;
+    os << fixed << setprecision(3) << setw(11) << t.ms
+       << setprecision(1) << setw(8) << (total_ms > 0 ? 100.0 * t.ms / total_ms : 0.0)
+       << setw(10) << t.calls << setw(10) << t.nodes
+       << setprecision(2) << setw(11) << 1000.0 * t.ms / t.calls
+       << setw(11) << t.bytes / (1024.0 * 1024.0)
+       << "  " << left << setw(12) << kind_name((ProfileKind)get<0>(item.second->first))
+       << get<1>(item.second->first);
+    if (by_dim) os << ' ' << get<2>(item.second->first);
+    os << right << defaultfloat << endl;
+  }
+  os << fixed << setprecision(3) << setw(11) << total_ms << defaultfloat << "  (total time)" << endl;
+  if (num_dropped() > 0)
+    os << num_dropped() << " older events were dropped, the profile buffer holds "
+       << events.size() << " events" << endl;
+}
+
+void ProfileScope::begin(ProfileKind kind, const Node* node, const char* name,
+                         const Dim& dim, unsigned batch_size, int sig) {
+  ev.kind = kind;
+  ev.type = node != nullptr ? &typeid(*node) : nullptr;
+  ev.name = name;
+  ev.dim = dim;
+  ev.bytes = node != nullptr ? dim.size() * sizeof(float) + node->aux_storage_size() : 0;
+  ev.sig = sig;
+  ev.batch_size = batch_size;
+  ev.device_id = node != nullptr && node->device != nullptr ? node->device->device_id : -1;
+  ev.thread = this_thread_number();
+  ev.start_ns = profiler.now();
+}
+
+} // namespace dynet
@@ -0,0 +1,209 @@
+#ifndef DYNET_PROFILER_H
+#define DYNET_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "dynet/dim.h"
+#include "dynet/init.h"
+
+namespace dynet {
+
+struct Node;
+
+/**
+ * \ingroup execution
+ * \brief What a profiled event measures
+ */
+enum class ProfileKind : unsigned char {
+  FORWARD,     /**< Forward pass of a node or of a batch of nodes */
+  BACKWARD,    /**< Backward pass of a node or of a batch of nodes */
+  PLAN,        /**< Autobatch planning of a forward call */
+  COPY,        /**< Concatenation of the arguments of a batch (combine_tensors) */
+  ACCUMULATE,  /**< Scattering the gradients of a batch into its arguments */
+  UPDATE       /**< Trainer update of one parameter */
+};
+
+/**
+ * \ingroup execution
+ * \brief A profiled event
+ */
+struct ProfileEvent {
+  uint64_t start_ns; /**< Start, in nanoseconds since the profiler was created */
+  uint64_t end_ns; /**< End, in nanoseconds since the profiler was created */
+  const std::type_info* type; /**< Type of the node, or nullptr */
+  const char* name; /**< Name of events without a node, or nullptr */
+  Dim dim; /**< Dimension of the result */
+  size_t bytes; /**< Size of the result (and auxiliary memory) in bytes */
+  int sig; /**< Autobatch signature, or 0 */
+  unsigned batch_size; /**< Number of nodes involved */
+  int device_id; /**< Device the event ran on, or -1 */
+  unsigned thread; /**< Small number identifying the thread */
+  ProfileKind kind;
+};
+
+/**
+ * \ingroup execution
+ * \brief Records the events of the execution engines and trainers while
+ *        profiling is on (`--dynet-profiling`)
+ * \details Events are fixed-size records written into a ring buffer that is
+ *          allocated once, when profiling is turned on, so recording an event
+ *          neither allocates nor formats strings. When the buffer is full,
+ *          the oldest events are overwritten. Events may be recorded from
+ *          several threads at once, but the buffer must not be read or
+ *          cleared while events are being recorded.
+ *
+ *          The events can be exported as a Chrome trace (viewable in
+ *          `chrome://tracing` or Perfetto) or aggregated per operation.
+ */
+class Profiler {
+ public:
+  static const size_t kDefaultCapacity = 1 << 18;
+
+  Profiler();
+  ~Profiler();
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  /**
+   * \brief Allocate the ring buffer, discarding any events recorded so far
+   *
+   * \param capacity Maximum number of events kept, rounded up to a power of two
+   */
+  void reserve(size_t capacity = kDefaultCapacity);
+  /**
+   * \brief Nanoseconds since the profiler was created
+   */
+  uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+  }
+  /**
+   * \brief Record an event (ignored if no buffer was allocated)
+   */
+  void record(const ProfileEvent& ev) {
+    if (events.empty()) return;
+    const uint64_t i = next.fetch_add(1, std::memory_order_relaxed);
+    events[i & mask] = ev;
+  }
+  /**
+   * \brief Forget all events
+   */
+  void clear() { next = 0; }
+  /**
+   * \brief The events currently in the buffer, oldest first
+   */
+  std::vector<ProfileEvent> get_events() const;
+  /**
+   * \brief Number of events that were overwritten because the buffer was full
+   */
+  uint64_t num_dropped() const;
+  /**
+   * \brief Name of the operation of an event, e.g. "Tanh" or "autobatch"
+   */
+  static std::string event_name(const ProfileEvent& ev);
+  /**
+   * \brief Readable name of a node type, e.g. "Tanh"
+   */
+  static std::string type_name(const std::type_info& type);
+
+  /**
+   * \brief Write the events in the Chrome trace event format
+   */
+  void write_chrome_trace(std::ostream& os) const;
+  /**
+   * \brief Write the events in the Chrome trace event format to a file
+   */
+  void write_chrome_trace(const std::string& filename) const;
+  /**
+   * \brief Write a table of the total time, number of calls and memory of
+   *        each operation, sorted by time
+   * \details The time of nested events, e.g. of the copies made during the
+   *          backward pass of a batch, is not counted again for the
+   *          enclosing event.
+   *
+   * \param by_dim Whether operations on different dimensions are listed
+   *               separately
+   */
+  void write_summary(std::ostream& os, bool by_dim = false) const;
+
+  /**
+   * \brief File the trace is written to at exit, if not empty
+   */
+  std::string trace_file;
+
+ private:
+  std::chrono::steady_clock::time_point epoch;
+  std::vector<ProfileEvent> events;
+  uint64_t mask;
+  std::atomic<uint64_t> next;
+};
+
+/**
+ * \brief The profiler of the execution engines and trainers
+ */
+extern Profiler profiler;
+
+/**
+ * \ingroup execution
+ * \brief Records an event from its construction until stop() is called or it
+ *        goes out of scope, if profiling is on
+ */
+class ProfileScope {
+ public:
+  /**
+   * \brief An event that does not belong to a node
+   *
+   * \param name Static string naming the event
+   */
+  ProfileScope(ProfileKind kind, const char* name) : active(profiling_flag != 0) {
+    if (active) begin(kind, nullptr, name, Dim(), 1, 0);
+  }
+  /**
+   * \brief An operation of a node, or of a batch of nodes of the same type
+   *
+   * \param dim Dimension of the result
+   * \param batch_size Number of nodes
+   * \param sig Autobatch signature of the nodes, or 0
+   */
+  ProfileScope(ProfileKind kind, const Node* node, const Dim& dim,
+               unsigned batch_size = 1, int sig = 0) : active(profiling_flag != 0) {
+    if (active) begin(kind, node, nullptr, dim, batch_size, sig);
+  }
+  ~ProfileScope() { stop(); }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+  /**
+   * \brief End and record the event
+   */
+  void stop() {
+    if (active) {
+      ev.end_ns = profiler.now();
+      profiler.record(ev);
+      active = false;
+    }
+  }
+
+  /**
+   * \brief Whether the event is being recorded
+   */
+  bool active;
+  /**
+   * \brief The event, whose fields may be updated until it is stopped
+   */
+  ProfileEvent ev;
+
+ private:
+  void begin(ProfileKind kind, const Node* node, const char* name,
+             const Dim& dim, unsigned batch_size, int sig);
+};
+
+} // namespace dynet
+
+#endif
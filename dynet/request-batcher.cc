@@ -0,0 +1,97 @@
+#include "dynet/request-batcher.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "dynet/except.h"
+
+using namespace std;
+
+namespace dynet {
+
+RequestBatcher::RequestBatcher(unsigned max_batch_size, unsigned max_wait_ms) :
+    max_batch_size(max_batch_size), max_wait_ms(max_wait_ms), stop(false) {
+  DYNET_ARG_CHECK(max_batch_size > 0, "RequestBatcher requires a batch size of at least one");
+  worker = thread(&RequestBatcher::loop, this);
+}
+
+RequestBatcher::~RequestBatcher() {
+  {
+    lock_guard<mutex> lk(mtx);
+    stop = true;
+  }
+  cv.notify_all();
+  worker.join();
+}
+
+future<RequestBatcher::Result> RequestBatcher::submit(Builder builder) {
+  Request request;
+  request.builder = std::move(builder);
+  future<Result> result = request.result.get_future();
+  {
+    lock_guard<mutex> lk(mtx);
+    pending.push_back(std::move(request));
+  }
+  cv.notify_all();
+  return result;
+}
+
+void RequestBatcher::loop() {
+  vector<Request> batch;
+  while (true) {
+    {
+      unique_lock<mutex> lk(mtx);
+      cv.wait(lk, [this] { return stop || !pending.empty(); });
+      if (pending.empty()) return;  // stopped, and nothing left to do
+      // Give other requests a chance to join the batch
+      auto deadline = chrono::steady_clock::now() + chrono::milliseconds(max_wait_ms);
+      cv.wait_until(lk, deadline, [this] { return stop || pending.size() >= max_batch_size; });
+      size_t n = std::min((size_t)max_batch_size, pending.size());
+      batch.clear();
+      for (size_t i = 0; i < n; ++i)
+        batch.push_back(std::move(pending[i]));
+      pending.erase(pending.begin(), pending.begin() + n);
+    }
+    execute(batch);
+  }
+}
+
+void RequestBatcher::execute(vector<Request>& batch) {
+  ComputationGraph cg(true);
+  vector<vector<Expression>> outputs(batch.size());
+  vector<bool> built(batch.size(), false);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    // The nodes that a failed builder added before throwing are removed, as
+    // the last of them may be one whose dimensions were rejected. The
+    // checkpoints do not evaluate the graph, so all requests stay batched.
+    cg.checkpoint(false);
+    try {
+      outputs[i] = batch[i].builder(cg);
+      built[i] = true;
+    } catch (...) {
+      cg.revert();
+      batch[i].result.set_exception(current_exception());
+    }
+  }
+  try {
+    if (cg.nodes.size() > 0)
+      cg.incremental_forward((VariableIndex)(cg.nodes.size() - 1));
+  } catch (...) {
+    for (size_t i = 0; i < batch.size(); ++i)
+      if (built[i]) batch[i].result.set_exception(current_exception());
+    return;
+  }
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (!built[i]) continue;
+    try {
+      Result values;
+      for (auto & e : outputs[i])
+        values.push_back(as_vector(cg.get_value(e.i)));
+      batch[i].result.set_value(std::move(values));
+    } catch (...) {
+      batch[i].result.set_exception(current_exception());
+    }
+  }
+}
+
+} // namespace dynet
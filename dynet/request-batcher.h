@@ -0,0 +1,84 @@
+#ifndef DYNET_REQUEST_BATCHER_H
+#define DYNET_REQUEST_BATCHER_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dynet/expr.h"
+
+namespace dynet {
+
+/**
+ * \ingroup execution
+ * \brief Batches independent requests, e.g. from the threads of a server,
+ *        into a single autobatched computation
+ * \details Each request is a function that builds its part of a graph and
+ *          returns the expressions whose values it needs. Requests can be
+ *          submitted from any thread. A background thread collects them
+ *          until `max_batch_size` requests are pending or `max_wait_ms`
+ *          milliseconds have passed since the oldest one arrived, builds all
+ *          of them into one ComputationGraph, evaluates it with the batched
+ *          execution engine (so that operations of different requests are
+ *          batched together), and hands every request the values of its own
+ *          expressions.
+ *
+ *          The batches are evaluated in graphs of their own, so the program
+ *          can keep using other graphs while a RequestBatcher is running.
+ *          Builders are run one at a time on the background thread, so they
+ *          may share model objects such as RNN builders. A builder that
+ *          throws only fails its own request; an error during the forward
+ *          pass fails every request of the batch.
+ */
+class RequestBatcher {
+ public:
+  /**
+   * \brief Builds the graph of a request and returns its outputs
+   */
+  typedef std::function<std::vector<Expression>(ComputationGraph&)> Builder;
+  /**
+   * \brief The values of the outputs of a request, in order
+   */
+  typedef std::vector<std::vector<float>> Result;
+
+  explicit RequestBatcher(unsigned max_batch_size = 32, unsigned max_wait_ms = 2);
+  ~RequestBatcher();
+  RequestBatcher(const RequestBatcher&) = delete;
+  RequestBatcher& operator=(const RequestBatcher&) = delete;
+
+  /**
+   * \brief Queue a request
+   * \details Thread-safe.
+   *
+   * \param builder Function adding the request's nodes to the graph
+   * \return Future for the values of the request's outputs
+   */
+  std::future<Result> submit(Builder builder);
+  /**
+   * \brief Queue a request and wait for its result
+   */
+  Result run(Builder builder) { return submit(std::move(builder)).get(); }
+
+ private:
+  struct Request {
+    Builder builder;
+    std::promise<Result> result;
+  };
+
+  void loop();
+  void execute(std::vector<Request>& batch);
+
+  const unsigned max_batch_size, max_wait_ms;
+  std::vector<Request> pending;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool stop;
+  std::thread worker;
+};
+
+} // namespace dynet
+
+#endif
@@ -17,6 +17,10 @@ enum { X2H=0, H2H, HB, L2H };
 
 RNNBuilder::~RNNBuilder() {}
 
+Expression RNNBuilder::add_input_sequence_impl(int prev, const Expression& x, const vector<unsigned>& lengths) {
+  DYNET_RUNTIME_ERR("add_input_sequence is not implemented for this builder");
+}
+
 SimpleRNNBuilder::SimpleRNNBuilder(unsigned layers,
                        unsigned input_dim,
                        unsigned hidden_dim,
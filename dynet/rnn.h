@@ -144,6 +144,31 @@ struct RNNBuilder {
     return add_input_impl(prev, x);
   }
 
+  /**
+   *
+   * \brief Read a whole sequence at once
+   * \details Gives the same states as calling `add_input` on every column of
+   * `x`, but builders implementing it process the sequence in a few large
+   * nodes, which avoids most of the per-timestep overhead. The sequence counts
+   * as one timestep of the builder: afterwards `final_h()` and `final_s()`
+   * return the state at the end of the sequence, and `add_input` continues
+   * from there.
+   *
+   * \param x Inputs, one column per timestep (dimension {input_dim, T})
+   * \param lengths Length of each batch element if they differ (empty if they
+   *                are all T); the state of a batch element is left unchanged
+   *                after its last timestep
+   *
+   * \return The hidden states of the deepest layer, one column per timestep
+   */
+  Expression add_input_sequence(const Expression& x, const std::vector<unsigned>& lengths = {}) {
+    sm.transition(RNNOp::add_input);
+    head.push_back(cur);
+    int rcp = cur;
+    cur = static_cast<int>(head.size()) - 1;
+    return add_input_sequence_impl(rcp, x, lengths);
+  }
+
   /**
    *
    * \brief Rewind the last timestep
@@ -248,6 +273,7 @@ protected:
   virtual void new_graph_impl(ComputationGraph& cg, bool update) = 0;
   virtual void start_new_sequence_impl(const std::vector<Expression>& h_0) = 0;
   virtual Expression add_input_impl(int prev, const Expression& x) = 0;
+  virtual Expression add_input_sequence_impl(int prev, const Expression& x, const std::vector<unsigned>& lengths);
   virtual Expression set_h_impl(int prev, const std::vector<Expression>& h_new) = 0;
   virtual Expression set_s_impl(int prev, const std::vector<Expression>& c_new) = 0;
   RNNPointer cur;
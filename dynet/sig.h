@@ -19,6 +19,7 @@ namespace dynet {
       COMPLEX,
       affine, matmul, transpose,
       vanilla_lstm_gates, vanilla_lstm_h, vanilla_lstm_c,
+      gru_gates, gru_c, gru_h,
       conv2d
     };
   }
@@ -10,6 +10,7 @@
 #include <vector>
 #include <cstring>
 #include <algorithm>
+#include <mutex>
 
 #ifdef __CUDACC__
 #include "dynet/gpu-ops.h"
@@ -25,6 +26,9 @@ namespace dynet {
 
 #ifndef __CUDACC__
 
+// rndeng is shared by all threads, and nodes may be executed concurrently
+static std::mutex rndeng_mutex;
+
 bool Tensor::is_valid() const {
   // TODO : replace this with a custom exception
   if (device->type == DeviceType::CPU) {
@@ -262,6 +266,7 @@ void TensorTools::randomize_bernoulli(Tensor& val, real p, real scale) {
   bernoulli_distribution distribution(p);
   auto b = [&] {return distribution(*rndeng) * scale;};
   if (val.device->type == DeviceType::CPU) {
+    std::lock_guard<std::mutex> lk(rndeng_mutex);
     generate(val.v, val.v + val.d.size(), b);
 #if HAVE_CUDA
   } else if (val.device->type == DeviceType::GPU) {
@@ -278,6 +283,7 @@ void TensorTools::randomize_normal(Tensor& val, real mean, real stddev) {
   normal_distribution<real> distribution(mean, stddev);
   auto b = [&] {return distribution(*rndeng);};
   if (val.device->type == DeviceType::CPU) {
+    std::lock_guard<std::mutex> lk(rndeng_mutex);
     generate(val.v, val.v + val.d.size(), b);
 #if HAVE_CUDA
   } else if (val.device->type == DeviceType::GPU) {
@@ -291,6 +297,7 @@ void TensorTools::randomize_uniform(Tensor& val, real left, real right) {
   uniform_real_distribution<real> distribution(left, right);
   auto b = [&] {return distribution(*rndeng);};
   if (val.device->type == DeviceType::CPU) {
+    std::lock_guard<std::mutex> lk(rndeng_mutex);
     generate(val.v, val.v + val.d.size(), b);
 #if HAVE_CUDA
   } else if (val.device->type == DeviceType::GPU) {
@@ -328,6 +335,7 @@ void TensorTools::randomize_orthonormal(Tensor& val, real scale) {
 
 real rand01() {
   uniform_real_distribution<real> distribution(0, 1);
+  std::lock_guard<std::mutex> lk(rndeng_mutex);
   return distribution(*rndeng);
 }
 
@@ -340,6 +348,7 @@ int rand0n(int n) {
 
 real rand_normal() {
   normal_distribution<real> distribution(0, 1);
+  std::lock_guard<std::mutex> lk(rndeng_mutex);
   return distribution(*rndeng);
 }
 
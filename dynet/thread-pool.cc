@@ -0,0 +1,113 @@
+#include "dynet/thread-pool.h"
+
+#include "dynet/except.h"
+
+using namespace std;
+
+namespace dynet {
+
+// The pool and worker index of the task running on this thread
+static thread_local ThreadPool* tl_pool = nullptr;
+static thread_local int tl_worker = -1;
+
+ThreadPool::ThreadPool(unsigned num_workers) : queued(0), pending(0), stop(false) {
+  DYNET_ARG_CHECK(num_workers > 0, "ThreadPool requires at least one worker");
+  for (unsigned i = 0; i < num_workers; ++i)
+    queues.push_back(new TaskQueue);
+  for (unsigned i = 1; i < num_workers; ++i)
+    threads.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lk(sleep_mtx);
+    stop = true;
+  }
+  sleep_cv.notify_all();
+  for (auto & t : threads) t.join();
+  for (auto q : queues) delete q;
+}
+
+int ThreadPool::current_worker() {
+  return tl_worker;
+}
+
+void ThreadPool::submit(Task task) {
+  unsigned id = (tl_pool == this && tl_worker >= 0) ? (unsigned)tl_worker : 0;
+  pending.fetch_add(1);
+  {
+    lock_guard<mutex> lk(queues[id]->mtx);
+    queues[id]->tasks.push_back(std::move(task));
+  }
+  queued.fetch_add(1);
+  // Taking the lock orders this notification after any sleeper's predicate
+  // check, so the wake-up cannot be lost.
+  { lock_guard<mutex> lk(sleep_mtx); }
+  sleep_cv.notify_one();
+}
+
+bool ThreadPool::try_run_one(unsigned id) {
+  Task task;
+  bool found = false;
+  {
+    TaskQueue* q = queues[id];
+    lock_guard<mutex> lk(q->mtx);
+    if (!q->tasks.empty()) {
+      task = std::move(q->tasks.back());
+      q->tasks.pop_back();
+      found = true;
+    }
+  }
+  for (unsigned k = 1; !found && k < queues.size(); ++k) {
+    TaskQueue* q = queues[(id + k) % queues.size()];
+    lock_guard<mutex> lk(q->mtx);
+    if (!q->tasks.empty()) {
+      task = std::move(q->tasks.front());
+      q->tasks.pop_front();
+      found = true;
+    }
+  }
+  if (!found) return false;
+  queued.fetch_sub(1);
+  ThreadPool* prev_pool = tl_pool;
+  int prev_worker = tl_worker;
+  tl_pool = this; tl_worker = id;
+  try {
+    task(id);
+  } catch (...) {
+    lock_guard<mutex> lk(error_mtx);
+    if (!error) error = current_exception();
+  }
+  tl_pool = prev_pool; tl_worker = prev_worker;
+  if (pending.fetch_sub(1) == 1) {
+    { lock_guard<mutex> lk(sleep_mtx); }
+    sleep_cv.notify_all();
+  }
+  return true;
+}
+
+void ThreadPool::worker_loop(unsigned id) {
+  while (true) {
+    if (try_run_one(id)) continue;
+    unique_lock<mutex> lk(sleep_mtx);
+    sleep_cv.wait(lk, [this] { return stop || queued.load() > 0; });
+    if (stop) return;
+  }
+}
+
+void ThreadPool::wait() {
+  while (true) {
+    if (try_run_one(0)) continue;
+    unique_lock<mutex> lk(sleep_mtx);
+    sleep_cv.wait(lk, [this] { return pending.load() == 0 || queued.load() > 0; });
+    if (pending.load() == 0) break;
+  }
+  exception_ptr e;
+  {
+    lock_guard<mutex> lk(error_mtx);
+    swap(e, error);
+  }
+  if (e) rethrow_exception(e);
+}
+
+} // namespace dynet
@@ -0,0 +1,82 @@
+#ifndef DYNET_THREAD_POOL_H
+#define DYNET_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dynet {
+
+/**
+ * \ingroup execution
+ * \brief A work-stealing pool of threads used by the execution engines
+ * \details The pool has `num_workers()` workers. Worker 0 is the thread that
+ *          calls `wait()`; workers 1..n-1 are background threads. Every
+ *          worker owns a task deque: tasks submitted from inside a task go to
+ *          the back of the current worker's deque and are popped from the
+ *          back (LIFO, for locality), while idle workers steal from the front
+ *          of the other deques.
+ */
+class ThreadPool {
+ public:
+  /**
+   * \brief A unit of work, called with the index of the worker running it
+   */
+  typedef std::function<void(unsigned)> Task;
+
+  explicit ThreadPool(unsigned num_workers);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned num_workers() const { return queues.size(); }
+
+  /**
+   * \brief Schedule a task
+   * \details May be called from inside a running task, in which case the new
+   *          task is placed on the calling worker's deque.
+   */
+  void submit(Task task);
+
+  /**
+   * \brief Run tasks on the calling thread until every submitted task, as well
+   *        as every task they submitted in turn, has finished
+   * \details If a task threw, the first exception is rethrown here once all
+   *          remaining tasks have drained.
+   */
+  void wait();
+
+  /**
+   * \brief Index of the worker executing the current task, or -1 when the
+   *        caller is not running inside a task of any pool
+   */
+  static int current_worker();
+
+ private:
+  struct TaskQueue {
+    std::mutex mtx;
+    std::deque<Task> tasks;
+  };
+
+  void worker_loop(unsigned id);
+  bool try_run_one(unsigned id);
+
+  std::vector<TaskQueue*> queues;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> queued;   // tasks sitting in a deque
+  std::atomic<size_t> pending;  // tasks submitted but not finished
+  std::mutex sleep_mtx;
+  std::condition_variable sleep_cv;
+  std::mutex error_mtx;
+  std::exception_ptr error;
+  bool stop;
+};
+
+} // namespace dynet
+
+#endif
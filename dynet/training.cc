@@ -6,6 +6,7 @@
 #include "dynet/param-nodes.h"
 #include "dynet/weight-decay.h"
 #include "dynet/io.h"
+#include "dynet/profiler.h"
 
 // same as in dynet/io.cc
 static const int FLOAT32_PRECISION = 8;
@@ -208,14 +209,30 @@ void Trainer::update() {
   const float gscale = clip_gradients();
   for(size_t i = 0; i < params.size(); ++i) {
     if(params[i]->updated) {
+      ProfileScope prof(ProfileKind::UPDATE, "update_params");
+      if (prof.active) {
+        prof.ev.dim = params[i]->dim;
+        prof.ev.bytes = params[i]->dim.size() * sizeof(float);
+        prof.ev.device_id = params[i]->device->device_id;
+      }
       update_params(gscale, i);
+      ++params[i]->version;
       params[i]->clear();
     }
   }
   for(size_t i = 0; i < lparams.size(); ++i) {
     auto &p = lparams[i];
     if (p->updated) {
-      if(sparse_updates_enabled && !p->all_updated) {
+      const bool sparse = sparse_updates_enabled && !p->all_updated;
+      ProfileScope prof(ProfileKind::UPDATE, "update_lookup_params");
+      if (prof.active) {
+        // one event for all the updated rows
+        prof.ev.dim = p->dim;
+        prof.ev.batch_size = sparse ? p->non_zero_grads.size() : p->values.size();
+        prof.ev.bytes = prof.ev.batch_size * p->dim.size() * sizeof(float);
+        prof.ev.device_id = p->device->device_id;
+      }
+      if(sparse) {
         for (auto j : p->non_zero_grads)
           update_lookup_params(gscale, i, j);
       } else {
@@ -245,6 +262,7 @@ void Trainer::update() {
         Tensor& weights = params[i]->values;
         Tensor& ma = ma_p[i].h;
         update_ma_rule(&ma, &weights);
+        ++params[i]->version;
     }
     for(size_t i = 0; i < lparams.size(); ++i)
     {
@@ -572,6 +590,7 @@ void Trainer::swap_params_to_moving_average(bool save_weights, bool bias_correct
         Tensor& ma = ma_p[i].h;
 
         swap_params_to_ma_rule(save_weights, bias_correction, &weights, &mem, &ma);
+        ++params[i]->version;
     }
     for(size_t i = 0; i < lparams.size(); ++i)
     {
@@ -603,6 +622,7 @@ void Trainer::swap_params_to_weights()
         Tensor& weights = params[i]->values;
         Tensor& mem = ma_saved_p[i].h;
         swap_params_to_weights_rule(&weights, &mem);
+        ++params[i]->version;
     }
     for(size_t i = 0; i < ma_saved_lp.size(); ++i)
     {
@@ -3,6 +3,7 @@ from libcpp.vector cimport vector
 from libcpp.string cimport string
 from libcpp cimport bool
 from libcpp.pair cimport pair
+from libcpp.map cimport map
 
 ctypedef float real
 
@@ -13,6 +14,16 @@ cdef extern from "dynet/init.h" namespace "dynet":
         float weight_decay
         int autobatch
         int profiling
+        string trace_file
+        int exec_threads
+        int fusion
+        string hugepages_descriptor
+        int numa_node
+        int mem_align
+        int trim_mem
+        int batch_stats
+        int packed_weights
+        int cpu_threads
         bool shared_parameters
         bool ngpus_requested
         bool ids_requested
@@ -198,9 +209,36 @@ cdef extern from "dynet/dynet.h" namespace "dynet":
         void set_immediate_compute(bool ic)
         void set_check_validity(bool cv)
 
+        # inference mode
+        void set_inference_mode(bool im) except +
+        void retain(VariableIndex i) except +
+        void set_remat_mode(bool rm) except +
+        void freeze() except +
+
+        CAutobatchStats autobatch_stats() const
+
         void print_graphviz() const
         void dump(string filename, bool show_values, bool show_gradients, bool nan_check_only) const
 
+cdef extern from "dynet/exec.h" namespace "dynet":
+    cdef cppclass CAutobatchSignatureStats "dynet::AutobatchStats::Signature":
+        string op
+        CDim dim
+        unsigned batches
+        unsigned nodes
+    cdef cppclass CAutobatchStats "dynet::AutobatchStats":
+        unsigned forward_calls
+        unsigned cached_plans
+        double plan_ms
+        unsigned nodes
+        unsigned batches
+        unsigned unbatchable_nodes
+        vector[unsigned] batch_sizes
+        map[int, CAutobatchSignatureStats] signatures
+        size_t combine_bytes
+        size_t accumulate_bytes
+        double mean_batch_size()
+
 cdef extern from "dynet/training.h" namespace "dynet":
     cdef cppclass CTrainer "dynet::Trainer":
         CTrainer(CModel& m, float learning_rate) # TODO removed lam, update docs.
@@ -181,6 +181,88 @@ cdef class DynetParams: # {{{
         """
         self.cparams.profiling = profiling
 
+    cpdef set_trace_file(self, str trace_file):
+        """Write the profiled events to a file in the Chrome trace format at exit
+        
+        Turns profiling on if it is off.
+        
+        Args:
+            trace_file(str): Name of the file
+        """
+        self.cparams.trace_file = trace_file.encode()
+
+    cpdef set_exec_threads(self, int exec_threads):
+        """Set the number of threads used to execute independent nodes
+        
+        Args:
+            exec_threads(int): Number of threads (1 means sequential execution)
+        """
+        self.cparams.exec_threads = exec_threads
+
+    cpdef set_fusion(self, bool fusion):
+        """Fuse chains of elementwise operations
+        
+        Args:
+            fusion(bool): Whether to fuse chains of elementwise operations
+        """
+        self.cparams.fusion = 1 if fusion else 0
+
+    cpdef set_hugepages(self, str hugepages):
+        """Back the CPU memory pools with huge pages
+        
+        Args:
+            hugepages(str): 0 for none, 1 for transparent, 2 for explicit huge pages, or comma separated modes for the forward, backward, parameter and scratch pools
+        """
+        self.cparams.hugepages_descriptor = hugepages.encode()
+
+    cpdef set_numa_node(self, int numa_node):
+        """Allocate the CPU memory pools on a NUMA node
+        
+        Args:
+            numa_node(int): The node, or -1 for no binding
+        """
+        self.cparams.numa_node = numa_node
+
+    cpdef set_align(self, int align):
+        """Set the alignment of CPU memory
+        
+        Args:
+            align(int): Alignment in bytes (a power of two), or 0 for the default
+        """
+        self.cparams.mem_align = align
+
+    cpdef set_trim_mem(self, bool trim_mem):
+        """Let memory pools shrink after unusually large graphs
+        
+        Args:
+            trim_mem(bool): Whether to trim the memory pools
+        """
+        self.cparams.trim_mem = 1 if trim_mem else 0
+
+    cpdef set_batch_stats(self, bool batch_stats):
+        """Print the autobatching statistics of each graph when it is cleared
+        
+        Args:
+            batch_stats(bool): Whether to print the statistics
+        """
+        self.cparams.batch_stats = 1 if batch_stats else 0
+
+    cpdef set_packed_weights(self, bool packed_weights):
+        """Pack parameters multiplied by a few columns on CPU, and reuse them until they change
+
+        Args:
+            packed_weights(bool): Whether to pack the parameters
+        """
+        self.cparams.packed_weights = 1 if packed_weights else 0
+
+    cpdef set_cpu_threads(self, int cpu_threads):
+        """Set the number of threads running each operation on CPU
+
+        Args:
+            cpu_threads(int): Number of threads
+        """
+        self.cparams.cpu_threads = cpu_threads
+
     cpdef set_weight_decay(self, float weight_decay):
         """Set weight decay parameter
         
@@ -1871,6 +1953,7 @@ def renew_cg(immediate_compute=False, check_validity=False, autobatching=None):
     return _cg.renew(immediate_compute, check_validity, autobatching)
 
 def print_text_graphviz(): return _cg.print_graphviz()
+def autobatch_stats(): return _cg.autobatch_stats()
 def dump_cg(filename="", show_values=True, show_gradients=True, nan_check_only=False): return _cg.dump(filename.encode('utf-8'), show_values, show_gradients, nan_check_only)
 
 def cg_checkpoint(): 
@@ -1967,6 +2050,92 @@ cdef class ComputationGraph:
     cpdef void revert(self):
         self.thisptr.revert()
 
+    cpdef set_inference_mode(self, bool im):
+        """Turn inference mode on or off
+
+        In inference mode the graph cannot be differentiated, and the memory of
+        forward values is reused as soon as all their consumers are computed.
+        Changing the mode invalidates all computed values.
+
+        Args:
+            im(bool): Whether to use inference mode
+        """
+        self.thisptr.set_inference_mode(im)
+
+    cpdef set_remat_mode(self, bool rm):
+        """Turn rematerialization (gradient checkpointing) on or off
+
+        Forward values are freed as in inference mode, and recomputed when the
+        backward pass needs them. Retained expressions serve as checkpoints;
+        if there are none, they are picked automatically. Changing the mode
+        invalidates all computed values.
+
+        Args:
+            rm(bool): Whether to rematerialize forward values during backward
+        """
+        self.thisptr.set_remat_mode(rm)
+
+    cpdef autobatch_stats(self):
+        """Counters of how the nodes of the graph were batched
+
+        They cover the forward calls since the graph was renewed, and are all
+        zero if the graph is not autobatched.
+
+        Returns:
+            dict: with the number of forward calls (:code:`forward_calls`),
+            of those that reused a cached schedule (:code:`cached_plans`), the
+            planning time (:code:`plan_ms`), the numbers of :code:`nodes`,
+            :code:`batches` and :code:`unbatchable_nodes` (of signature 0),
+            the :code:`mean_batch_size`, a histogram of batch sizes
+            (:code:`batch_sizes`, size -> count), the bytes copied to
+            concatenate batch arguments (:code:`combine_bytes`) and batch
+            gradients (:code:`accumulate_bytes`), and for each autobatch
+            signature (:code:`signatures`) the operation, the dimension of its
+            first node, and the numbers of batches and nodes.
+        """
+        cdef CAutobatchStats stats = self.thisptr.autobatch_stats()
+        sizes = {n: stats.batch_sizes[n] for n in range(len(stats.batch_sizes)) if stats.batch_sizes[n]}
+        sigs = {}
+        for item in stats.signatures:
+            sigs[item.first] = {"op": item.second.op.decode(),
+                                "dim": c_dim_as_dim(item.second.dim),
+                                "batches": item.second.batches,
+                                "nodes": item.second.nodes}
+        return {"forward_calls": stats.forward_calls,
+                "cached_plans": stats.cached_plans,
+                "plan_ms": stats.plan_ms,
+                "nodes": stats.nodes,
+                "batches": stats.batches,
+                "unbatchable_nodes": stats.unbatchable_nodes,
+                "mean_batch_size": stats.mean_batch_size(),
+                "batch_sizes": sizes,
+                "combine_bytes": stats.combine_bytes,
+                "accumulate_bytes": stats.accumulate_bytes,
+                "signatures": sigs}
+
+    cpdef freeze(self):
+        """Freeze the graph so that it can be evaluated again without being rebuilt
+
+        No expressions can be added to a frozen graph. Once it has been
+        computed, calling forward() on one of its expressions again re-executes
+        the graph in the memory allocated the first time (use
+        :code:`forward(recalculate=True)` on an expression). Inputs that change
+        between evaluations should be created with vecInput() and updated with
+        their set() method.
+        """
+        self.thisptr.freeze()
+
+    cpdef retain(self, Expression e):
+        """Keep the value of an expression in inference or remat mode
+
+        Call this for values that are used again by expressions created after
+        their consumers have been computed.
+
+        Args:
+            e(dynet.Expression): Expression whose value should be kept
+        """
+        self.thisptr.retain(e.vindex)
+
     # DYNET handles changing inputs keeping pointers to memoty locations.
     # Because of python's memory management, objects that wrap such pointers
     # must be registered in a central location. This location would be the
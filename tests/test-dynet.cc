@@ -1,4 +1,5 @@
 #include <dynet/dynet.h>
+#include <dynet/expr.h>
 #define BOOST_TEST_MODULE DYNETBasicTest
 #include <boost/test/unit_test.hpp>
 #include "test.h"
@@ -33,3 +34,51 @@ BOOST_AUTO_TEST_CASE( aligned_allocator ) {
   a.free(mem);
 }
 
+BOOST_AUTO_TEST_CASE( node_arena ) {
+  dynet::NodeArena arena;
+  void* a = arena.allocate(24);
+  BOOST_CHECK_EQUAL(((uintptr_t)(a) % alignof(std::max_align_t)), 0);
+  dynet::NodeArena::Mark m = arena.mark();
+  void* b = arena.allocate(100);
+  BOOST_CHECK_EQUAL(((uintptr_t)(b) % alignof(std::max_align_t)), 0);
+  BOOST_CHECK_NE(a, b);
+  // allocations larger than a chunk get a chunk of their own
+  arena.allocate(1 << 20);
+  size_t capacity = arena.capacity();
+  arena.revert(m);
+  BOOST_CHECK_EQUAL(arena.allocate(100), b);
+  arena.clear();
+  BOOST_CHECK_EQUAL(arena.allocate(8), a);
+  arena.allocate(1 << 20);
+  BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE( node_args ) {
+  dynet::NodeArgs few = {1, 2, 3};
+  std::vector<dynet::VariableIndex> v = {0, 1, 2, 3, 4, 5, 6};
+  dynet::NodeArgs many(v.begin(), v.end()), copy = many;
+  BOOST_CHECK_EQUAL(few.size(), (size_t)3);
+  BOOST_CHECK_EQUAL(few[2], 3u);
+  BOOST_CHECK_EQUAL(copy.size(), v.size());
+  BOOST_CHECK(std::equal(copy.begin(), copy.end(), v.begin()));
+  copy = few;
+  BOOST_CHECK_EQUAL(copy.size(), (size_t)3);
+  BOOST_CHECK_EQUAL(copy.back(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE( graph_node_arena ) {
+  dynet::ComputationGraph cg;
+  for (int rep = 0; rep < 2; ++rep) {
+    std::vector<dynet::Expression> xs;
+    for (int i = 0; i < 6; ++i)
+      xs.push_back(dynet::input(cg, (float)i));
+    dynet::Expression y = dynet::sum(xs);
+    cg.checkpoint();
+    dynet::Expression z = dynet::sum({y, y * 2.f, -y});
+    BOOST_CHECK_EQUAL(dynet::as_scalar(cg.forward(z)), 30.f);
+    cg.revert();
+    BOOST_CHECK_EQUAL(cg.nodes.size(), (size_t)7);
+    BOOST_CHECK_EQUAL(dynet::as_scalar(cg.forward(y)), 15.f);
+    cg.clear();
+  }
+}
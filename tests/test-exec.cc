@@ -8,10 +8,15 @@
 #include <dynet/gru.h>
 #include <dynet/grad-check.h>
 #include <dynet/param-init.h>
+#include <dynet/devices.h>
+#include <dynet/request-batcher.h>
+#include <dynet/profiler.h>
+#include <dynet/training.h>
 #include <boost/test/unit_test.hpp>
 #include "test.h"
 #include <stdexcept>
 #include <fstream>
+#include <thread>
 
 using namespace dynet;
 using namespace std;
@@ -56,7 +61,7 @@ BOOST_AUTO_TEST_CASE( autobatch_lstm_gradient ) {
   dynet::ParameterCollection mod;
   dynet::VanillaLSTMBuilder lstm(2, 3, 10, mod);
   dynet::LookupParameter lp = mod.add_lookup_parameters(10, {3});
-  for(size_t i = 0; i < 3; ++i) {
+  for(size_t i = 0; i < 5; ++i) {
     dynet::autobatch_flag = i;
     dynet::ComputationGraph cg;
     lstm.new_graph(cg);
@@ -78,6 +83,34 @@ BOOST_AUTO_TEST_CASE( autobatch_lstm_gradient ) {
     BOOST_CHECK_CLOSE(results[0], results[i], 0.0001);
 }
 
+BOOST_AUTO_TEST_CASE( autobatch_gru_gradient ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  vector<float> results;
+  dynet::ParameterCollection mod;
+  dynet::GRUBuilder gru(2, 3, 10, mod);
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {3});
+  for(size_t i = 0; i < 5; ++i) {
+    dynet::autobatch_flag = i;
+    dynet::ComputationGraph cg;
+    gru.new_graph(cg);
+    vector<Expression> losses;
+    for(size_t j = 0; j < 3; ++j) {
+      gru.start_new_sequence();
+      for(size_t k = 0; k < 3; ++k) {
+        Expression x = dynet::lookup(cg, lp, j*3 + k);
+        gru.add_input(x);
+      }
+      losses.push_back(squared_norm(gru.final_h()[1]));
+    }
+    Expression z = dynet::sum(losses);
+    results.push_back(as_scalar(z.value()));
+    BOOST_CHECK(check_grad(mod, z, 0));
+  }
+  for(size_t i = 1; i < results.size(); ++i)
+    BOOST_CHECK_CLOSE(results[0], results[i], 0.0001);
+  dynet::autobatch_flag = autobatch_cache;
+}
+
 // TODO: This is commented out because it inexplicably causes problems only when
 //       performing manual install on mac on Travis CI, despite the fact that it
 //       works in my local mac environment. Until it becomes possible to debug
@@ -159,4 +192,628 @@ BOOST_AUTO_TEST_CASE( loss_gradient ) {
   dynet::autobatch_flag = autobatch_cache;
 }
 
+BOOST_AUTO_TEST_CASE( parallel_forward ) {
+  auto threads_cache = dynet::exec_threads_flag;
+  dynet::ParameterCollection mod;
+  dynet::VanillaLSTMBuilder l2r(1, 3, 8, mod), r2l(1, 3, 8, mod);
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {3});
+  dynet::Parameter p_W = mod.add_parameters({10, 16});
+  vector<vector<float>> results;
+  for (int threads : {1, 2, 4}) {
+    dynet::exec_threads_flag = threads;
+    dynet::ComputationGraph cg;
+    l2r.new_graph(cg);
+    r2l.new_graph(cg);
+    Expression W = parameter(cg, p_W);
+    vector<Expression> losses;
+    for (unsigned j = 0; j < 4; ++j) {
+      l2r.start_new_sequence();
+      r2l.start_new_sequence();
+      for (unsigned k = 0; k < 5; ++k) {
+        l2r.add_input(lookup(cg, lp, (j * 5 + k) % 10));
+        r2l.add_input(lookup(cg, lp, (j * 5 + 4 - k) % 10));
+      }
+      Expression h = concatenate({l2r.back(), r2l.back()});
+      losses.push_back(pickneglogsoftmax(W * h, j));
+    }
+    Expression z = sum(losses);
+    cg.forward(z);
+    vector<float> values;
+    for (auto & l : losses) values.push_back(as_scalar(l.value()));
+    values.push_back(as_scalar(z.value()));
+    results.push_back(values);
+  }
+  dynet::exec_threads_flag = threads_cache;
+  for (size_t i = 1; i < results.size(); ++i)
+    for (size_t j = 0; j < results[0].size(); ++j)
+      BOOST_CHECK_CLOSE(results[0][j], results[i][j], 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE( parallel_backward ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  auto threads_cache = dynet::exec_threads_flag;
+  dynet::ParameterCollection mod;
+  dynet::VanillaLSTMBuilder l2r(1, 3, 8, mod), r2l(1, 3, 8, mod);
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {3});
+  dynet::Parameter p_W = mod.add_parameters({10, 16});
+  for (int autobatch : {0, 1}) {
+    vector<vector<float>> results;
+    for (int threads : {1, 4}) {
+      dynet::autobatch_flag = autobatch;
+      dynet::exec_threads_flag = threads;
+      mod.reset_gradient();
+      dynet::ComputationGraph cg;
+      l2r.new_graph(cg);
+      r2l.new_graph(cg);
+      Expression W = parameter(cg, p_W);
+      vector<Expression> losses;
+      for (unsigned j = 0; j < 4; ++j) {
+        l2r.start_new_sequence();
+        r2l.start_new_sequence();
+        for (unsigned k = 0; k < 5; ++k) {
+          l2r.add_input(lookup(cg, lp, (j * 5 + k) % 10));
+          r2l.add_input(lookup(cg, lp, (j * 5 + 4 - k) % 10));
+        }
+        Expression h = concatenate({l2r.back(), r2l.back()});
+        losses.push_back(pickneglogsoftmax(W * h, j));
+      }
+      Expression z = sum(losses);
+      cg.forward(z);
+      cg.backward(z);
+      vector<float> grads;
+      for (auto & p : mod.parameters_list()) {
+        auto g = as_vector(p->g);
+        grads.insert(grads.end(), g.begin(), g.end());
+      }
+      for (auto & p : mod.lookup_parameters_list()) {
+        auto g = as_vector(p->all_grads);
+        grads.insert(grads.end(), g.begin(), g.end());
+      }
+      results.push_back(grads);
+    }
+    for (size_t j = 0; j < results[0].size(); ++j)
+      BOOST_CHECK_SMALL(results[0][j] - results[1][j], 1e-5f);
+  }
+  dynet::autobatch_flag = autobatch_cache;
+  dynet::exec_threads_flag = threads_cache;
+}
+
+BOOST_AUTO_TEST_CASE( autobatch_schedule_cache ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::ParameterCollection mod;
+  dynet::LookupParameter lp1 = mod.add_lookup_parameters(10, {4});
+  dynet::LookupParameter lp2 = mod.add_lookup_parameters(10, {4});
+  dynet::Parameter p_W = mod.add_parameters({4, 4});
+  // The same graph shape, with lookups that can or cannot be batched together
+  for (bool same_params : {false, true, false, true}) {
+    vector<float> results;
+    for (int autobatch : {0, 1, 1}) {
+      dynet::autobatch_flag = autobatch;
+      dynet::ComputationGraph cg;
+      Expression W = parameter(cg, p_W);
+      vector<Expression> hs;
+      for (unsigned j = 0; j < 4; ++j) {
+        Expression x = lookup(cg, lp1, j);
+        Expression y = lookup(cg, (same_params || j % 2) ? lp1 : lp2, j + 4);
+        hs.push_back(tanh(W * (x + y)));
+      }
+      results.push_back(as_scalar(cg.forward(sum_elems(sum(hs)))));
+    }
+    for (size_t i = 1; i < results.size(); ++i)
+      BOOST_CHECK_CLOSE(results[0], results[i], 0.0001);
+  }
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( autobatch_placement ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::ParameterCollection mod;
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {3});
+  dynet::Parameter p_W = mod.add_parameters({3, 3});
+  vector<vector<float>> results;
+  for (int autobatch : {0, 1}) {
+    dynet::autobatch_flag = autobatch;
+    mod.reset_gradient();
+    dynet::ComputationGraph cg;
+    Expression W = parameter(cg, p_W);
+    vector<Expression> hs;
+    for (unsigned j = 0; j < 5; ++j) {
+      // min() is not batched, so its outputs are placed next to each other
+      // for the batched products that consume them in reverse order
+      Expression m = dynet::min(lookup(cg, lp, j), lookup(cg, lp, j + 5));
+      hs.push_back(m);
+    }
+    vector<Expression> outs;
+    for (unsigned j = 0; j < 5; ++j)
+      outs.push_back(tanh(W * hs[4 - j]) * (float)(j + 1));
+    Expression z = sum_elems(sum(outs));
+    vector<float> values(1, as_scalar(cg.forward(z)));
+    cg.backward(z);
+    for (auto & p : mod.parameters_list()) {
+      auto g = as_vector(p->g);
+      values.insert(values.end(), g.begin(), g.end());
+    }
+    auto g = as_vector(lp.get_storage().all_grads);
+    values.insert(values.end(), g.begin(), g.end());
+    results.push_back(values);
+  }
+  for (size_t j = 0; j < results[0].size(); ++j)
+    BOOST_CHECK_SMALL(results[0][j] - results[1][j], 1e-5f);
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( request_batcher ) {
+  dynet::ParameterCollection mod;
+  dynet::VanillaLSTMBuilder lstm(1, 3, 8, mod);
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {3});
+  auto build = [&](unsigned r, ComputationGraph& cg) {
+    lstm.new_graph(cg);
+    lstm.start_new_sequence();
+    for (unsigned k = 0; k <= r % 4; ++k)
+      lstm.add_input(lookup(cg, lp, (r + k) % 10));
+    return vector<Expression>(1, sum_elems(lstm.back()));
+  };
+  // Reference values, one graph per request
+  vector<float> expected;
+  for (unsigned r = 0; r < 8; ++r) {
+    dynet::ComputationGraph cg;
+    expected.push_back(as_scalar(cg.forward(build(r, cg)[0])));
+  }
+  vector<float> results(8);
+  {
+    RequestBatcher batcher(4, 50);
+    vector<std::thread> clients;
+    for (unsigned r = 0; r < 8; ++r) {
+      clients.emplace_back([&, r]() {
+        results[r] = batcher.run([&, r](ComputationGraph& cg) { return build(r, cg); })[0][0];
+      });
+    }
+    for (auto & t : clients) t.join();
+    auto failed = batcher.submit([](ComputationGraph& cg) -> vector<Expression> {
+      throw std::runtime_error("bad request");
+    });
+    BOOST_CHECK_THROW(failed.get(), std::runtime_error);
+  }
+  for (unsigned r = 0; r < 8; ++r)
+    BOOST_CHECK_CLOSE(expected[r], results[r], 0.001);
+  // A builder that throws after adding nodes, the last of them with
+  // mismatched dimensions, fails alone
+  {
+    RequestBatcher batcher(4, 1000);
+    vector<std::future<RequestBatcher::Result>> futures;
+    auto bad = [&](ComputationGraph& cg) {
+      Expression W = lookup(cg, lp, 1u);
+      return vector<Expression>(1, W * input(cg, {4}, vector<float>(4, 1.f)));
+    };
+    futures.push_back(batcher.submit(bad));
+    futures.push_back(batcher.submit([&](ComputationGraph& cg) { return build(0, cg); }));
+    futures.push_back(batcher.submit(bad));
+    futures.push_back(batcher.submit([&](ComputationGraph& cg) { return build(1, cg); }));
+    BOOST_CHECK_THROW(futures[0].get(), std::invalid_argument);
+    BOOST_CHECK_CLOSE(expected[0], futures[1].get()[0][0], 0.001);
+    BOOST_CHECK_THROW(futures[2].get(), std::invalid_argument);
+    BOOST_CHECK_CLOSE(expected[1], futures[3].get()[0][0], 0.001);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( remat_gradient ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({32, 32});
+  dynet::Parameter p_b = mod.add_parameters({32});
+  for (int autobatch : {0, 1}) {
+    dynet::autobatch_flag = autobatch;
+    vector<vector<float>> results;
+    vector<size_t> used;
+    for (bool remat : {false, true}) {
+      mod.reset_gradient();
+      dynet::ComputationGraph cg;
+      cg.set_remat_mode(remat);
+      Expression W = parameter(cg, p_W), b = parameter(cg, p_b);
+      Expression h = input(cg, {32}, vector<float>(32, 0.1f));
+      vector<Expression> losses;
+      for (unsigned t = 0; t < 100; ++t) {
+        h = tanh(W * h + b);
+        if (t % 10 == 9) losses.push_back(dropout(sum_elems(h), 0.f));
+      }
+      Expression z = sum(losses);
+      vector<float> values(1, as_scalar(cg.forward(z)));
+      cg.backward(z);
+      used.push_back(default_device->pools[(int)DeviceMempool::FXS]->used());
+      for (auto & p : mod.parameters_list()) {
+        auto g = as_vector(p->g);
+        values.insert(values.end(), g.begin(), g.end());
+      }
+      results.push_back(values);
+    }
+    for (size_t j = 0; j < results[0].size(); ++j)
+      BOOST_CHECK_SMALL(results[0][j] - results[1][j], 1e-5f);
+    BOOST_CHECK_LT(used[1] * 2, used[0]);
+  }
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+// Values recomputed for the backward pass are freed again, also on a branch
+// that gets no gradient
+BOOST_AUTO_TEST_CASE( remat_no_gradient_branch ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::autobatch_flag = 0;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({32, 32});
+  dynet::Parameter p_b = mod.add_parameters({32});
+  dynet::ComputationGraph cg;
+  cg.set_remat_mode(true);
+  Expression W = parameter(cg, p_W), b = parameter(cg, p_b);
+  Expression c = input(cg, {32}, vector<float>(32, 0.1f));
+  for (unsigned t = 0; t < 20; ++t)
+    c = tanh(c);
+  Expression h = c;
+  for (unsigned t = 0; t < 50; ++t)
+    h = tanh(W * h + b);
+  Expression z = sum_elems(h);
+  cg.forward(z);
+  BOOST_CHECK_THROW(cg.get_value(c), std::runtime_error);
+  cg.backward(z);
+  BOOST_CHECK_THROW(cg.get_value(c), std::runtime_error);
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( frozen_replay ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({8, 4});
+  dynet::Parameter p_b = mod.add_parameters({8});
+  vector<vector<float>> xs(3, vector<float>(4));
+  auto build = [&](dynet::ComputationGraph& cg) {
+    Expression W = parameter(cg, p_W), b = parameter(cg, p_b);
+    vector<Expression> scores;
+    for (auto & x : xs)
+      scores.push_back(sum_elems(tanh(W * input(cg, {4}, &x) + b)));
+    return sum(scores);
+  };
+  auto fill = [&](unsigned trial) {
+    for (unsigned k = 0; k < xs.size(); ++k)
+      for (unsigned j = 0; j < 4; ++j)
+        xs[k][j] = 0.1f * (trial + 1) * (j + 1) - 0.2f * k;
+  };
+  for (int autobatch : {0, 1}) {
+    dynet::autobatch_flag = autobatch;
+    // reference values from a graph built for every example
+    vector<vector<float>> expected;
+    for (unsigned trial = 0; trial < 3; ++trial) {
+      fill(trial);
+      mod.reset_gradient();
+      dynet::ComputationGraph cg;
+      Expression z = build(cg);
+      vector<float> values(1, as_scalar(cg.forward(z)));
+      cg.backward(z);
+      auto g = as_vector(p_W.get_storage().g);
+      values.insert(values.end(), g.begin(), g.end());
+      expected.push_back(values);
+    }
+    dynet::ComputationGraph cg;
+    Expression z = build(cg);
+    cg.freeze();
+    BOOST_CHECK_THROW(input(cg, 1.f), std::runtime_error);
+    size_t used = 0;
+    for (unsigned trial = 0; trial < 3; ++trial) {
+      fill(trial);
+      mod.reset_gradient();
+      vector<float> values(1, as_scalar(cg.forward(z)));
+      if (trial == 0)
+        used = default_device->pools[(int)DeviceMempool::FXS]->used();
+      else
+        BOOST_CHECK_EQUAL(used, default_device->pools[(int)DeviceMempool::FXS]->used());
+      cg.backward(z);
+      auto g = as_vector(p_W.get_storage().g);
+      values.insert(values.end(), g.begin(), g.end());
+      for (size_t j = 0; j < values.size(); ++j)
+        BOOST_CHECK_CLOSE(expected[trial][j], values[j], 0.001);
+    }
+  }
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( frozen_replay_partial ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({8, 4});
+  vector<vector<float>> xs(3, vector<float>(4));
+  auto fill = [&](unsigned trial) {
+    for (unsigned k = 0; k < xs.size(); ++k)
+      for (unsigned j = 0; j < 4; ++j)
+        xs[k][j] = 0.1f * (trial + 1) * (j + 1) - 0.2f * k;
+  };
+  for (int autobatch : {0, 1}) {
+    dynet::autobatch_flag = autobatch;
+    dynet::ComputationGraph cg;
+    Expression W = parameter(cg, p_W);
+    vector<Expression> scores;
+    for (auto & x : xs)
+      scores.push_back(sum_elems(tanh(W * input(cg, {4}, &x))));
+    Expression z = sum(scores);
+    cg.freeze();
+    fill(0);
+    cg.forward(z);
+    for (unsigned trial = 1; trial < 3; ++trial) {
+      fill(trial);
+      // forward to an early node, then read values computed after it
+      cg.forward(scores[0]);
+      float expected = 0.f;
+      for (unsigned k = 0; k < xs.size(); ++k) {
+        dynet::ComputationGraph ref;
+        float score = as_scalar(ref.forward(sum_elems(tanh(parameter(ref, p_W) * input(ref, {4}, xs[k])))));
+        BOOST_CHECK_CLOSE(score, as_scalar(scores[k].value()), 0.001);
+        expected += score;
+      }
+      BOOST_CHECK_CLOSE(expected, as_scalar(z.value()), 0.001);
+    }
+  }
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( concurrent_graphs ) {
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({20, 10});
+  dynet::Parameter p_b = mod.add_parameters({20});
+  auto build = [&](unsigned r, ComputationGraph& cg) {
+    Expression x = input(cg, {10}, vector<float>(10, 0.1f * r));
+    return sum_elems(tanh(parameter(cg, p_W) * x + parameter(cg, p_b)));
+  };
+  vector<float> expected;
+  for (unsigned r = 0; r < 8; ++r) {
+    dynet::ComputationGraph cg;
+    expected.push_back(as_scalar(cg.forward(build(r, cg))));
+  }
+  // Graphs on one thread: the second one uses memory of its own
+  {
+    dynet::ComputationGraph cg1;
+    Expression y1 = build(1, cg1);
+    BOOST_CHECK_CLOSE(as_scalar(y1.value()), expected[1], 0.001);
+    size_t used = default_device->pools[(int)DeviceMempool::FXS]->used();
+    Expression y2;
+    {
+      dynet::ComputationGraph cg2;
+      y2 = build(2, cg2);
+      BOOST_CHECK_CLOSE(as_scalar(y2.value()), expected[2], 0.001);
+      BOOST_CHECK(!y1.is_stale());
+      BOOST_CHECK_EQUAL(get_number_of_active_graphs(), 2);
+    }
+    BOOST_CHECK(y2.is_stale());
+    {
+      // the slot of cg2 is reused by a new graph, with a new id
+      dynet::ComputationGraph cg3;
+      BOOST_CHECK_EQUAL(cg3.get_slot(), y2.graph_slot);
+      BOOST_CHECK(y2.is_stale());
+      BOOST_CHECK(!Expression(&cg3, 0).is_stale());
+    }
+    BOOST_CHECK(Expression().is_stale());
+    BOOST_CHECK_EQUAL(used, default_device->pools[(int)DeviceMempool::FXS]->used());
+    BOOST_CHECK_CLOSE(as_scalar(y1.value()), expected[1], 0.001);
+  }
+  // Graphs built and executed by concurrent threads
+  vector<float> results(8 * 10);
+  vector<std::thread> workers;
+  for (unsigned r = 0; r < 8; ++r) {
+    workers.emplace_back([&, r]() {
+      for (unsigned k = 0; k < 10; ++k) {
+        dynet::ComputationGraph cg;
+        results[r * 10 + k] = as_scalar(cg.forward(build(r, cg)));
+      }
+    });
+  }
+  for (auto & t : workers) t.join();
+  for (unsigned r = 0; r < 8; ++r)
+    for (unsigned k = 0; k < 10; ++k)
+      BOOST_CHECK_CLOSE(expected[r], results[r * 10 + k], 0.001);
+  BOOST_CHECK_EQUAL(get_number_of_active_graphs(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( fusion_gradient ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::autobatch_flag = 0;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({300, 300});
+  dynet::Parameter p_b = mod.add_parameters({300});
+  vector<vector<float>> results;
+  vector<size_t> used;
+  for (int fusion : {0, 1}) {
+    dynet::fusion_flag = fusion;
+    mod.reset_gradient();
+    dynet::ComputationGraph cg;
+    Expression W = parameter(cg, p_W), b = parameter(cg, p_b);
+    Expression x = input(cg, {300}, vector<float>(300, 0.01f));
+    Expression c = x, h;
+    for (unsigned t = 0; t < 5; ++t) {
+      Expression a = W * c, g = logistic(a + b);
+      h = tanh(a);
+      c = cmult(g, h) + cmult(1.f - g, square(c) * 0.5f);
+    }
+    Expression z = sum_elems(rectify(c) + exp(-c));
+    vector<float> values(1, as_scalar(cg.forward(z)));
+    used.push_back(default_device->pools[(int)DeviceMempool::FXS]->used());
+    // values of fused nodes are computed when they are needed
+    values.push_back(as_scalar(cg.get_value(sum_elems(h))));
+    values.push_back(as_vector(cg.get_value(h))[7]);
+    cg.backward(z);
+    // their gradients are not, even once their value was computed
+    if (fusion)
+      BOOST_CHECK_THROW(cg.get_gradient(h), std::runtime_error);
+    for (auto & p : mod.parameters_list()) {
+      auto g = as_vector(p->g);
+      values.insert(values.end(), g.begin(), g.end());
+    }
+    results.push_back(values);
+  }
+  dynet::fusion_flag = 0;
+  for (size_t j = 0; j < results[0].size(); ++j)
+    BOOST_CHECK_SMALL(results[0][j] - results[1][j], 1e-5f);
+  BOOST_CHECK_LT(used[1], used[0]);
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( lazy_gradient_init ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_x = mod.add_parameters({3});
+  vector<float> xv = {-0.5f, 0.3f, 1.2f};
+  p_x.set_value(xv);
+  for (size_t autobatch = 0; autobatch < 2; ++autobatch) {
+    dynet::autobatch_flag = autobatch;
+    // gradient memory is reused between backward passes, so run two of them
+    for (int rep = 0; rep < 2; ++rep) {
+      mod.reset_gradient();
+      dynet::ComputationGraph cg;
+      Expression x = parameter(cg, p_x);
+      Expression unused = tanh(x * 2.f);
+      Expression y = tanh(x) + logistic(x) + rectify(x);
+      Expression z = sum_elems(sum({y, y}));
+      cg.forward(z);
+      cg.backward(z);
+      auto g = as_vector(p_x.get_storage().g);
+      for (size_t j = 0; j < xv.size(); ++j) {
+        float t = std::tanh(xv[j]), s = 1.f / (1.f + std::exp(-xv[j]));
+        BOOST_CHECK_CLOSE(g[j], 2.f * ((1.f - t * t) + s * (1.f - s) + (xv[j] > 0.f ? 1.f : 0.f)), 1e-3f);
+      }
+      for (float v : as_vector(unused.gradient()))
+        BOOST_CHECK_EQUAL(v, 0.f);
+    }
+  }
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( profiler_events ) {
+  auto autobatch_cache = dynet::autobatch_flag;
+  auto profiling_cache = dynet::profiling_flag;
+  dynet::profiling_flag = 1;
+  dynet::profiler.reserve(1024);
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({4, 4});
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {4});
+  dynet::SimpleSGDTrainer trainer(mod);
+  for (int autobatch : {0, 1}) {
+    dynet::autobatch_flag = autobatch;
+    dynet::ComputationGraph cg;
+    Expression W = parameter(cg, p_W);
+    vector<Expression> hs;
+    for (unsigned j = 0; j < 3; ++j)
+      hs.push_back(tanh(W * lookup(cg, lp, j)));
+    Expression z = sum_elems(sum(hs));
+    cg.forward(z);
+    cg.backward(z);
+    trainer.update();
+  }
+  vector<ProfileEvent> evs = dynet::profiler.get_events();
+  map<ProfileKind, unsigned> counts;
+  bool batched_tanh = false;
+  for (auto & ev : evs) {
+    ++counts[ev.kind];
+    BOOST_CHECK(ev.end_ns >= ev.start_ns);
+    if (ev.kind == ProfileKind::FORWARD && Profiler::event_name(ev) == "Tanh")
+      batched_tanh = batched_tanh || (ev.batch_size == 3 && ev.sig != 0);
+  }
+  BOOST_CHECK(counts[ProfileKind::FORWARD] > 0);
+  BOOST_CHECK(counts[ProfileKind::BACKWARD] > 0);
+  BOOST_CHECK_EQUAL(counts[ProfileKind::PLAN], 1u);
+  BOOST_CHECK_EQUAL(counts[ProfileKind::UPDATE], 4u);
+  BOOST_CHECK(batched_tanh);
+  ostringstream trace, summary;
+  dynet::profiler.write_chrome_trace(trace);
+  BOOST_CHECK(trace.str().find("\"name\": \"Tanh\", \"cat\": \"forward\"") != string::npos);
+  dynet::profiler.write_summary(summary);
+  BOOST_CHECK(summary.str().find("update_lookup_params") != string::npos);
+  // the ring buffer keeps the most recent events
+  dynet::profiler.reserve(4);
+  dynet::autobatch_flag = 0;
+  {
+    dynet::ComputationGraph cg;
+    Expression x = input(cg, 1.f);
+    for (unsigned j = 0; j < 10; ++j) x = tanh(x);
+    cg.forward(x);
+  }
+  BOOST_CHECK_EQUAL(dynet::profiler.get_events().size(), 4u);
+  BOOST_CHECK_EQUAL(dynet::profiler.num_dropped(), 7u);
+  dynet::profiler.clear();
+  dynet::profiling_flag = profiling_cache;
+  dynet::autobatch_flag = autobatch_cache;
+}
+
+BOOST_AUTO_TEST_CASE( autobatch_stats ) {
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({4, 4});
+  dynet::LookupParameter lp = mod.add_lookup_parameters(10, {4});
+  dynet::ComputationGraph cg(true);
+  Expression W = parameter(cg, p_W);
+  vector<Expression> hs;
+  for (unsigned j = 0; j < 3; ++j)
+    hs.push_back(tanh(W * lookup(cg, lp, j)));
+  Expression z = sum_elems(sum(hs));
+  cg.forward(z);
+  cg.backward(z);
+  AutobatchStats stats = cg.autobatch_stats();
+  BOOST_CHECK_EQUAL(stats.forward_calls, 1u);
+  BOOST_CHECK_EQUAL(stats.nodes, cg.nodes.size());
+  unsigned batched = 0, total = 0;
+  for (size_t n = 0; n < stats.batch_sizes.size(); ++n) {
+    batched += stats.batch_sizes[n];
+    total += n * stats.batch_sizes[n];
+  }
+  BOOST_CHECK_EQUAL(batched, stats.batches);
+  BOOST_CHECK_EQUAL(total, stats.nodes);
+  BOOST_CHECK(stats.batches < stats.nodes);
+  bool tanh_batched = false;
+  for (auto & item : stats.signatures)
+    if (item.second.op == "Tanh")
+      tanh_batched = item.second.batches == 1 && item.second.nodes == 3;
+  BOOST_CHECK(tanh_batched);
+  // the counters start over when the graph is cleared
+  cg.clear();
+  BOOST_CHECK_EQUAL(cg.autobatch_stats().forward_calls, 0u);
+  dynet::ComputationGraph cg_unbatched(false);
+  cg_unbatched.forward(tanh(input(cg_unbatched, 1.f)));
+  BOOST_CHECK_EQUAL(cg_unbatched.autobatch_stats().nodes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( cpu_threads ) {
+  if (default_device->type != DeviceType::CPU) return;
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({100, 60});
+  dynet::Parameter p_V = mod.add_parameters({60, 100});
+  dynet::Parameter p_F = mod.add_parameters({3, 3, 2, 4});
+  vector<float> x_values(60 * 40 * 2), img_values(12 * 10 * 2);
+  for (size_t i = 0; i < x_values.size(); ++i) x_values[i] = 0.01f * (i % 23) - 0.1f;
+  for (size_t i = 0; i < img_values.size(); ++i) img_values[i] = 0.02f * (i % 17) - 0.15f;
+  Device_CPU* device = static_cast<Device_CPU*>(default_device);
+  vector<vector<float>> softmaxes, results;
+  for (unsigned threads : {1, 3}) {
+    device->set_num_threads(threads);
+    BOOST_CHECK_EQUAL(device->num_threads(), threads);
+    mod.reset_gradient();
+    dynet::ComputationGraph cg;
+    Expression W = parameter(cg, p_W), V = parameter(cg, p_V);
+    Expression x = input(cg, Dim({60, 40}, 2), x_values);
+    Expression h = tanh(W * x);
+    Expression o = V * h;
+    Expression y = softmax(reshape(o, Dim({60 * 40}, 2)));
+    Expression img = input(cg, Dim({12, 10, 2}), img_values);
+    Expression c = conv2d(img, parameter(cg, p_F), {1, 1}, false);
+    Expression z = sum_batches(sum_elems(square(o))) + sum_elems(square(c));
+    cg.forward(z);
+    cg.backward(z);
+    // softmax outputs are positive, so they are compared relatively
+    softmaxes.push_back(as_vector(y.value()));
+    vector<float> values;
+    for (auto p : {p_W, p_V, p_F}) {
+      vector<float> g = as_vector(p.get_storage().g);
+      values.insert(values.end(), g.begin(), g.end());
+    }
+    results.push_back(values);
+  }
+  device->set_num_threads(1);
+  for (size_t j = 0; j < softmaxes[0].size(); ++j)
+    BOOST_CHECK_CLOSE(softmaxes[0][j], softmaxes[1][j], 0.001);
+  for (size_t j = 0; j < results[0].size(); ++j)
+    BOOST_CHECK_SMALL(results[0][j] - results[1][j], 1e-4f);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 #include <dynet/expr.h>
 #include <dynet/training.h>
 #include <dynet/grad-check.h>
+#include <dynet/devices.h>
 #include <boost/test/unit_test.hpp>
 #include "test.h"
 #include <stdexcept>
@@ -47,4 +48,157 @@ BOOST_AUTO_TEST_CASE( expand_test ) {
   }
 }
 
+BOOST_AUTO_TEST_CASE( lazy_commit ) {
+  // the pool is mapped, not written to, and still reads as zeros
+  CPUAllocator a;
+  AlignedMemoryPool pool("test memory", 256 << 20, &a);
+  const size_t n = 1 << 20;
+  float* x = static_cast<float*>(pool.allocate(n * sizeof(float)));
+  for (size_t i = 0; i < n; i += 1000)
+    BOOST_CHECK_EQUAL(x[i], 0.f);
+  for (size_t i = 0; i < n; ++i)
+    x[i] = 1.f;
+  // reused memory is zeroed explicitly
+  pool.free();
+  float* y = static_cast<float*>(pool.allocate(n * sizeof(float)));
+  BOOST_CHECK_EQUAL(x, y);
+  pool.zero_allocated_memory();
+  for (size_t i = 0; i < n; i += 1000)
+    BOOST_CHECK_EQUAL(y[i], 0.f);
+}
+
+BOOST_AUTO_TEST_CASE( huge_page_pools ) {
+  // huge pages fall back to normal ones if the system has none to spare
+  for (auto mode : {HugePages::TRANSPARENT, HugePages::EXPLICIT}) {
+    CPUAllocator a(64, mode);
+    AlignedMemoryPool pool("test memory", 4 << 20, &a);
+    float* x = static_cast<float*>(pool.allocate(10 * sizeof(float)));
+    float* y = static_cast<float*>(pool.allocate(10 * sizeof(float)));
+    BOOST_CHECK_EQUAL((size_t)x % 64, 0);
+    BOOST_CHECK_EQUAL((size_t)y % 64, 0);
+    BOOST_CHECK_EQUAL(y[9], 0.f);
+  }
+  BOOST_CHECK_THROW(CPUMemoryOptions("0,1", -1, 32), std::invalid_argument);
+  BOOST_CHECK_THROW(CPUMemoryOptions("3", -1, 32), std::invalid_argument);
+  BOOST_CHECK_THROW(CPUMemoryOptions("1", -1, 48), std::invalid_argument);
+  CPUMemoryOptions opts("0,1,1,2", -1, 64);
+  BOOST_CHECK(opts.huge_pages[(int)DeviceMempool::DEDFS] == HugePages::TRANSPARENT);
+  BOOST_CHECK(opts.huge_pages[(int)DeviceMempool::SCS] == HugePages::EXPLICIT);
+}
+
+BOOST_AUTO_TEST_CASE( pool_growth_and_trim ) {
+  CPUAllocator a;
+  const size_t mb = 1 << 20;
+  AlignedMemoryPool pool("test memory", 2 * mb, &a, mb);
+  // a large use spreads over sub-pools, which are then merged into one
+  for (int i = 0; i < 10; ++i)
+    pool.allocate(mb);
+  BOOST_CHECK_EQUAL(pool.get_high_water(), 10 * mb);
+  pool.free();
+  BOOST_CHECK_EQUAL(pool.get_cap(), 10 * mb);
+  for (int i = 0; i < 10; ++i)
+    pool.allocate(mb);
+  pool.set_used(pool.used());  // only possible with a single sub-pool
+  pool.free();
+  BOOST_CHECK_EQUAL(pool.get_cap(), 10 * mb);
+  pool.trim();
+  BOOST_CHECK_EQUAL(pool.get_cap(), 2 * mb);
+  BOOST_CHECK_EQUAL(pool.get_high_water(), 10 * mb);
+  // with trimming, the pool shrinks once the large use is no longer recent
+  auto trim_cache = trim_mem_flag;
+  trim_mem_flag = 1;
+  for (int i = 0; i < 10; ++i)
+    pool.allocate(mb);
+  pool.free();
+  pool.end_of_use();
+  BOOST_CHECK_EQUAL(pool.get_cap(), 10 * mb);
+  for (int i = 0; i < 20; ++i) {
+    pool.allocate(mb);
+    pool.free();
+    pool.end_of_use();
+  }
+  BOOST_CHECK_EQUAL(pool.get_cap(), 2 * mb);
+  trim_mem_flag = trim_cache;
+  pool.allocate(mb);
+  BOOST_CHECK_THROW(pool.trim(), std::runtime_error);
+}
+
+// The trimming window counts uses, not calls to free(): a scratch pool freed
+// after every node keeps the memory that one of them needs in every graph
+BOOST_AUTO_TEST_CASE( pool_trim_per_use ) {
+  CPUAllocator a;
+  const size_t mb = 1 << 20;
+  AlignedMemoryPool pool("test memory", 2 * mb, &a, mb);
+  auto trim_cache = trim_mem_flag;
+  trim_mem_flag = 1;
+  for (int graph = 0; graph < 20; ++graph) {
+    for (int i = 0; i < 10; ++i)
+      pool.allocate(mb);
+    pool.free();
+    for (int node = 0; node < 40; ++node) {
+      pool.allocate(mb);
+      pool.free();
+    }
+    pool.end_of_use();
+    BOOST_CHECK_EQUAL(pool.get_cap(), 10 * mb);
+  }
+  // uses that allocate nothing are not counted
+  for (int i = 0; i < 20; ++i)
+    pool.end_of_use();
+  pool.allocate(mb);
+  pool.free();
+  BOOST_CHECK_EQUAL(pool.get_cap(), 10 * mb);
+  trim_mem_flag = trim_cache;
+}
+
+BOOST_AUTO_TEST_CASE( inference_mode_reuse ) {
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({64, 64});
+  dynet::Parameter p_b = mod.add_parameters({64});
+  vector<float> results;
+  vector<size_t> used;
+  for (bool inference : {false, true}) {
+    dynet::ComputationGraph cg(false);
+    cg.set_inference_mode(inference);
+    Expression W = parameter(cg, p_W), b = parameter(cg, p_b);
+    Expression h = input(cg, {64}, vector<float>(64, 0.1f));
+    for (size_t t = 0; t < 100; ++t) {
+      h = tanh(W * h + b);
+      // like a decoder reading a score at every step; the state itself is
+      // used again by the next step
+      cg.retain(h);
+      cg.incremental_forward(sum_elems(h));
+    }
+    Expression z = sum_elems(h);
+    results.push_back(as_scalar(cg.incremental_forward(z)));
+    used.push_back(default_device->pools[(int)DeviceMempool::FXS]->used());
+  }
+  BOOST_CHECK_CLOSE(results[0], results[1], 0.0001);
+  BOOST_CHECK_LT(used[1] * 2, used[0]);
+}
+
+BOOST_AUTO_TEST_CASE( inference_mode_liveness ) {
+  dynet::ParameterCollection mod;
+  dynet::Parameter p_W = mod.add_parameters({8, 8});
+  dynet::ComputationGraph cg(false);
+  cg.set_inference_mode(true);
+  Expression W = parameter(cg, p_W);
+  Expression x = input(cg, {8}, vector<float>(8, 1.f));
+  Expression h1 = W * x;
+  Expression h2 = W * h1;
+  cg.retain(h2);
+  Expression h3 = tanh(h2);
+  Expression y = W * tanh(h3);
+  cg.incremental_forward(y);
+  // h3 was only consumed by an intermediate node, which is itself freed
+  BOOST_CHECK_THROW(h3.value(), std::runtime_error);
+  // retained values and values without consumers are kept
+  BOOST_CHECK_EQUAL(h2.value().d.size(), 8u);
+  Expression z = sum_elems(y + h2);
+  BOOST_CHECK_NO_THROW(cg.incremental_forward(z));
+  Expression bad = h3 + y;
+  BOOST_CHECK_THROW(cg.incremental_forward(bad), std::runtime_error);
+  BOOST_CHECK_THROW(cg.backward(z), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
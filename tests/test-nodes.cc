@@ -1854,6 +1854,147 @@ BOOST_AUTO_TEST_CASE( conv2d_same_gradient ) {
   BOOST_CHECK(check_grad(mod, z, 0));
 }
 
+// Direct computation of conv2d, to check the im2col and Winograd paths
+static vector<float> conv2d_reference(const vector<float>& x, const Dim& xd,
+                                      const vector<float>& f, const Dim& fd,
+                                      const vector<unsigned>& stride, bool is_valid,
+                                      const Dim& yd) {
+  const int h = xd[0], w = xd[1], ci = xd[2], kh = fd[0], kw = fd[1], co = fd[3];
+  const int oh = yd[0], ow = yd[1], sh = stride[0], sw = stride[1];
+  const int ph = is_valid ? 0 : max((oh - 1) * sh + kh - h, 0) / 2;
+  const int pw = is_valid ? 0 : max((ow - 1) * sw + kw - w, 0) / 2;
+  vector<float> y(yd.size(), 0.f);
+  for (unsigned b = 0; b < xd.bd; ++b)
+    for (int o = 0; o < co; ++o)
+      for (int j = 0; j < ow; ++j)
+        for (int i = 0; i < oh; ++i) {
+          float sum = 0.f;
+          for (int c = 0; c < ci; ++c)
+            for (int q = 0; q < kw; ++q)
+              for (int p = 0; p < kh; ++p) {
+                const int ih = i * sh + p - ph, iw = j * sw + q - pw;
+                if (ih >= 0 && ih < h && iw >= 0 && iw < w)
+                  sum += x[ih + h * (iw + w * (c + ci * b))] * f[p + kh * (q + kw * (c + ci * o))];
+              }
+          y[i + oh * (j + ow * (o + co * b))] = sum;
+        }
+  return y;
+}
+
+BOOST_AUTO_TEST_CASE( conv2d_value ) {
+  struct Case { unsigned h, w, ci, n, kh, kw, co, sh, sw; bool is_valid; };
+  const vector<Case> cases = {
+    {29, 31, 32, 2, 3, 3, 32, 1, 1, false}, // Winograd, partial tiles
+    {30, 30, 32, 1, 3, 3, 33, 1, 1, true},  // Winograd
+    {100, 95, 32, 1, 3, 3, 32, 1, 1, false}, // Winograd, by blocks of columns
+    {9, 7, 8, 2, 3, 3, 8, 1, 1, false},
+    {11, 10, 3, 3, 2, 3, 4, 2, 3, false},  // strided
+    {1, 20, 5, 4, 1, 3, 6, 1, 1, true},    // several images at once
+    {7, 5, 4, 2, 1, 1, 3, 1, 1, true},     // 1x1
+    {250, 251, 2, 1, 3, 3, 3, 1, 1, false}, // by blocks of columns
+  };
+  for (const Case& c : cases) {
+    dynet::ComputationGraph cg;
+    ParameterCollection m;
+    const Dim xd({c.h, c.w, c.ci}, c.n), fd({c.kh, c.kw, c.ci, c.co});
+    vector<float> x_vals(xd.size()), f_vals(fd.size()), b_vals(c.co);
+    for (unsigned i = 0; i < x_vals.size(); ++i)
+      x_vals[i] = (int)(i * 37 % 101) / 50.f - 1.f;
+    for (unsigned i = 0; i < f_vals.size(); ++i)
+      f_vals[i] = (int)(i * 53 % 89) / 44.f - 1.f;
+    for (unsigned i = 0; i < b_vals.size(); ++i)
+      b_vals[i] = 0.1f * i;
+    Parameter f = m.add_parameters(fd), b = m.add_parameters({c.co});
+    TensorTools::set_elements(f.get_storage().values, f_vals);
+    TensorTools::set_elements(b.get_storage().values, b_vals);
+    Expression x = input(cg, xd, x_vals);
+    vector<unsigned> stride = {c.sh, c.sw};
+    Expression y = conv2d(x, parameter(cg, f), parameter(cg, b), stride, c.is_valid);
+    vector<float> ref = conv2d_reference(x_vals, xd, f_vals, fd, stride, c.is_valid, y.dim());
+    vector<float> val = as_vector(y.value());
+    BOOST_REQUIRE_EQUAL(val.size(), ref.size());
+    float max_err = 0.f;
+    for (unsigned i = 0; i < ref.size(); ++i) {
+      const float r = ref[i] + b_vals[(i / (y.dim()[0] * y.dim()[1])) % c.co];
+      max_err = max(max_err, std::abs(val[i] - r) / (1.f + std::abs(r)));
+    }
+    BOOST_CHECK_SMALL(max_err, 1e-4f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( conv2d_pointwise_gradient ) {
+  dynet::ComputationGraph cg;
+  Parameter param_kernel = mod.add_parameters({3, 3, 3, 4});
+  std::vector<float> param_kernel_vals(3 * 3 * 3 * 4);
+  for (unsigned i = 0; i < param_kernel_vals.size(); ++i)
+    param_kernel_vals[i] = (int)(i * 53 % 89) * 0.002f - 0.09f;
+  TensorTools::set_elements(param_kernel.get_storage().values, param_kernel_vals);
+  Parameter param_kernel2 = mod.add_parameters({1, 1, 4, 2});
+  std::vector<float> param_kernel2_vals = {.011f, .022f, -.033f, .012f, .122f, -.032f, .013f, .023f};
+  TensorTools::set_elements(param_kernel2.get_storage().values, param_kernel2_vals);
+  std::vector<float> conv2d_vals(6 * 5 * 3);
+  for (unsigned i = 0; i < conv2d_vals.size(); ++i) {
+    conv2d_vals[i] = i * 0.011f + (i + 1) * 0.001f;
+  }
+  Expression x = input(cg, Dim({6, 5, 3}), conv2d_vals);
+  vector<unsigned> stride = {1, 1};
+  Expression y = conv2d(x, parameter(cg, param_kernel), stride, false);
+  Expression y2 = conv2d(y, parameter(cg, param_kernel2), stride, true);
+  Expression z = to_scalar(y2);
+  BOOST_CHECK(check_grad(mod, z, 0));
+}
+
+// 1 x W images, as in character CNNs, where patches and their gradients are
+// copied by rows
+BOOST_AUTO_TEST_CASE( conv2d_row_gradient ) {
+  Parameter param_kernel = mod.add_parameters({1, 3, 3, 4});
+  std::vector<float> param_kernel_vals(1 * 3 * 3 * 4);
+  for (unsigned i = 0; i < param_kernel_vals.size(); ++i)
+    param_kernel_vals[i] = (int)(i * 53 % 89) * 0.002f - 0.09f;
+  TensorTools::set_elements(param_kernel.get_storage().values, param_kernel_vals);
+  Parameter param_kernel2 = mod.add_parameters({1, 2, 4, 2});
+  std::vector<float> param_kernel2_vals = {.011f, .022f, -.033f, .012f, .122f, -.032f, .013f, .023f,
+                                           -.111f, .022f, .133f, -.012f, .022f, .032f, -.113f, .123f};
+  TensorTools::set_elements(param_kernel2.get_storage().values, param_kernel2_vals);
+  std::vector<float> conv2d_batch_vals(1 * 11 * 3 * 3);
+  for (unsigned i = 0; i < conv2d_batch_vals.size(); ++i) {
+    conv2d_batch_vals[i] = i * 0.011f + (i + 1) * 0.001f;
+  }
+  for (bool is_valid : {true, false}) {
+    dynet::ComputationGraph cg;
+    Expression x = input(cg, Dim({1, 11, 3}, 3), conv2d_batch_vals);
+    Expression y = conv2d(x, parameter(cg, param_kernel), {1, 1}, is_valid);
+    Expression y2 = conv2d(y, parameter(cg, param_kernel2), {1, 2}, is_valid);
+    Expression z = sum_batches(to_scalar(y2));
+    BOOST_CHECK(check_grad(mod, z, 0));
+  }
+}
+
+// An image too large for one product, which is computed by blocks of columns
+BOOST_AUTO_TEST_CASE( conv2d_column_blocks_gradient ) {
+  dynet::ComputationGraph cg;
+  Parameter param_kernel = mod.add_parameters({1, 1, 2, 64});
+  std::vector<float> param_kernel_vals(1 * 1 * 2 * 64);
+  for (unsigned i = 0; i < param_kernel_vals.size(); ++i)
+    param_kernel_vals[i] = (int)(i * 53 % 89) * 0.002f - 0.09f;
+  TensorTools::set_elements(param_kernel.get_storage().values, param_kernel_vals);
+  Parameter param_kernel2 = mod.add_parameters({5, 5, 64, 1});
+  std::vector<float> param_kernel2_vals(5 * 5 * 64);
+  for (unsigned i = 0; i < param_kernel2_vals.size(); ++i)
+    param_kernel2_vals[i] = (int)(i * 37 % 61) * 0.001f - 0.03f;
+  TensorTools::set_elements(param_kernel2.get_storage().values, param_kernel2_vals);
+  std::vector<float> conv2d_vals(27 * 27 * 2);
+  for (unsigned i = 0; i < conv2d_vals.size(); ++i) {
+    conv2d_vals[i] = (int)(i * 17 % 23) * 0.01f - 0.1f;
+  }
+  Expression x = input(cg, Dim({27, 27, 2}), conv2d_vals);
+  vector<unsigned> stride = {1, 1};
+  Expression y = conv2d(x, parameter(cg, param_kernel), stride, true);
+  Expression y2 = conv2d(y, parameter(cg, param_kernel2), stride, false);
+  Expression z = to_scalar(y2);
+  BOOST_CHECK(check_grad(mod, z, 0));
+}
+
 BOOST_AUTO_TEST_CASE( maxpooling2d_same_gradient ) {
   dynet::ComputationGraph cg;
   Parameter param_kernel = mod.add_parameters({2, 2, 1, 1});
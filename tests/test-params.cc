@@ -16,6 +16,8 @@
 #include <dynet/gru.h>
 #include <dynet/treelstm.h>
 #include <dynet/io.h>
+#include <dynet/training.h>
+#include <dynet/grad-check.h>
 
 #include "test.h"
 
@@ -197,4 +199,64 @@ BOOST_AUTO_TEST_CASE( set_value ) {
     }
 }
 
+BOOST_AUTO_TEST_CASE( packed_values ) {
+    dynet::ParameterCollection mod;
+    dynet::Parameter W_p = mod.add_parameters({37, 23});
+    dynet::Parameter b_p = mod.add_parameters({37});
+    std::vector<float> x_values(23 * 5);
+    for (unsigned i = 0; i < x_values.size(); ++i)
+      x_values[i] = 0.1f * (i % 7) - 0.3f;
+    // Affine transform and product by W, with and without packed values
+    auto compute = [&](bool packed, std::vector<float> & affine, std::vector<float> & product) {
+      int old_packed_weights_flag = packed_weights_flag;
+      packed_weights_flag = packed;
+      dynet::ComputationGraph cg;
+      dynet::Expression W = dynet::parameter(cg, W_p);
+      dynet::Expression x = dynet::input(cg, Dim({23}, 5), x_values);
+      affine = as_vector(affine_transform({dynet::parameter(cg, b_p), W, x}).value());
+      product = as_vector((W * x).value());
+      packed_weights_flag = old_packed_weights_flag;
+    };
+    auto check = [&]() {
+      std::vector<float> affine, product, packed_affine, packed_product;
+      compute(false, affine, product);
+      compute(true, packed_affine, packed_product);
+      for (unsigned i = 0; i < affine.size(); ++i) {
+        BOOST_CHECK_SMALL(affine[i] - packed_affine[i], 1e-5f);
+        BOOST_CHECK_SMALL(product[i] - packed_product[i], 1e-5f);
+      }
+    };
+    check();
+    // The packed values are refreshed after an update
+    {
+      dynet::SimpleSGDTrainer trainer(mod, 0.5);
+      dynet::ComputationGraph cg;
+      dynet::Expression x = dynet::input(cg, Dim({23}, 5), x_values);
+      dynet::Expression z = sum_batches(sum_elems(square(dynet::parameter(cg, W_p) * x)));
+      cg.forward(z);
+      cg.backward(z);
+      trainer.update();
+    }
+    check();
+    // ... and after setting the values
+    W_p.set_value(std::vector<float>(37 * 23, 0.5f));
+    check();
+}
+
+BOOST_AUTO_TEST_CASE( packed_values_grad ) {
+    dynet::ParameterCollection mod;
+    dynet::Parameter W_p = mod.add_parameters({9, 4});
+    dynet::Parameter b_p = mod.add_parameters({9});
+    std::vector<float> x_values = {-0.5f, 0.3f, 1.f, 0.2f, 0.7f, -0.1f, 0.4f, -0.8f};
+    int old_packed_weights_flag = packed_weights_flag;
+    packed_weights_flag = 1;
+    dynet::ComputationGraph cg;
+    dynet::Expression x = dynet::input(cg, Dim({4, 2}), x_values);
+    dynet::Expression W = dynet::parameter(cg, W_p);
+    dynet::Expression y = tanh(affine_transform({dynet::parameter(cg, b_p), W, x})) + W * x;
+    dynet::Expression z = sum_elems(square(y));
+    BOOST_CHECK(check_grad(mod, z, 0));
+    packed_weights_flag = old_packed_weights_flag;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -629,5 +629,161 @@ BOOST_AUTO_TEST_CASE( lstm_node_dropout_batch_bwd ) {
   BOOST_CHECK(check_grad(mod, z, 0));
 }
 
+BOOST_AUTO_TEST_CASE( gru_node_batched_fwd ) {
+  dynet::ParameterCollection mod;
+  unsigned input_dim = 3;
+  unsigned hidden_dim = 5;
+  unsigned batch_size = 2;
+  dynet::GRUBuilder gru_builder(1, input_dim, hidden_dim, mod);
+  dynet::ComputationGraph cg;
+  gru_builder.new_graph(cg);
+  // the initial state is shared by the batch
+  Expression h_tm1 = dynet::input(cg, Dim({hidden_dim}), {0.f, 0.1f, -0.2f, 0.3f, 0.4f});
+  gru_builder.start_new_sequence({h_tm1});
+  vector<Expression> vars;
+  for (auto & p : gru_builder.params[0])
+    vars.push_back(parameter(cg, p));
+  Expression x = dynet::input(cg, Dim({input_dim}, batch_size), {1.f, -1.f, 0.5f, 0.2f, 0.3f, -0.4f});
+  for (unsigned i = 0; i < 3; i++) {
+    const Tensor& builder_h = gru_builder.add_input(x).value();
+    // GRUBuilder in terms of generic operations
+    Expression z_t = logistic(affine_transform({vars[2], vars[0], x, vars[1], h_tm1}));
+    Expression r_t = logistic(affine_transform({vars[5], vars[3], x, vars[4], h_tm1}));
+    Expression c_t = tanh(affine_transform({vars[8], vars[6], x, vars[7], cmult(r_t, h_tm1)}));
+    Expression h_t = cmult(1.f - z_t, h_tm1) + cmult(z_t, c_t);
+    vector<float> expected = as_vector(h_t.value()), actual = as_vector(builder_h);
+    BOOST_REQUIRE_EQUAL(actual.size(), hidden_dim * batch_size);
+    for (unsigned k = 0; k < expected.size(); k++)
+      BOOST_CHECK_CLOSE(actual[k], expected[k], 0.001);
+    h_tm1 = h_t;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( gru_node_bwd ) {
+  dynet::ParameterCollection mod;
+  unsigned input_dim = 3;
+  unsigned hidden_dim = 4;
+  unsigned batch_size = 2;
+  dynet::GRUBuilder gru_builder(1, input_dim, hidden_dim, mod);
+  dynet::Parameter p_x = mod.add_parameters({input_dim * batch_size});
+  dynet::Parameter p_h0 = mod.add_parameters({hidden_dim});
+  dynet::ComputationGraph cg;
+  vector<Expression> vars;
+  for (auto & p : gru_builder.params[0])
+    vars.push_back(parameter(cg, p));
+  Expression x = reshape(parameter(cg, p_x), Dim({input_dim}, batch_size));
+  // the initial state is broadcast over the batch
+  Expression h_tm1 = parameter(cg, p_h0);
+  for (unsigned i = 0; i < 3; i++) {
+    Expression gates_t = dynet::gru_gates(x, h_tm1, vars[0], vars[1], vars[2], vars[3], vars[4], vars[5]);
+    Expression c_t = dynet::gru_c(x, h_tm1, gates_t, vars[6], vars[7], vars[8]);
+    h_tm1 = dynet::gru_h(h_tm1, gates_t, c_t);
+  }
+  Expression z = squared_norm(sum_batches(h_tm1));
+  BOOST_CHECK(check_grad(mod, z, 0));
+}
+
+// The states of add_input_sequence are those of add_input, for every batch
+// element up to its length
+template <class Builder>
+void check_lstm_sequence_fwd() {
+  dynet::ParameterCollection mod;
+  const unsigned input_dim = 3, hidden_dim = 4, seq_len = 5, batch_size = 2;
+  const vector<unsigned> lengths = {5, 3};
+  Builder seq_builder(2, input_dim, hidden_dim, mod), step_builder(2, input_dim, hidden_dim, mod);
+  step_builder.copy(seq_builder);
+  vector<float> x_vals(input_dim * seq_len * batch_size);
+  for (size_t i = 0; i < x_vals.size(); ++i)
+    x_vals[i] = 0.1f * (i % 7) - 0.3f;
+  dynet::ComputationGraph cg;
+  seq_builder.new_graph(cg);
+  seq_builder.start_new_sequence();
+  Expression x = input(cg, Dim({input_dim, seq_len}, batch_size), x_vals);
+  Expression hs = seq_builder.add_input_sequence(x, lengths);
+  vector<Expression> final_s = seq_builder.final_s();
+  for (unsigned b = 0; b < batch_size; ++b) {
+    step_builder.new_graph(cg);
+    step_builder.start_new_sequence();
+    for (unsigned t = 0; t < lengths[b]; ++t) {
+      Expression h_t = step_builder.add_input(pick(pick_batch_elem(x, b), t, 1));
+      vector<float> expected = as_vector(h_t.value());
+      vector<float> actual = as_vector(pick(pick_batch_elem(hs, b), t, 1).value());
+      for (unsigned k = 0; k < hidden_dim; ++k)
+        BOOST_CHECK_CLOSE(actual[k], expected[k], 0.01);
+    }
+    vector<Expression> step_s = step_builder.final_s();
+    BOOST_REQUIRE_EQUAL(step_s.size(), final_s.size());
+    for (size_t i = 0; i < step_s.size(); ++i) {
+      vector<float> expected = as_vector(step_s[i].value());
+      vector<float> actual = as_vector(pick_batch_elem(final_s[i], b).value());
+      for (unsigned k = 0; k < hidden_dim; ++k)
+        BOOST_CHECK_CLOSE(actual[k], expected[k], 0.01);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( vanilla_lstm_sequence_fwd ) {
+  check_lstm_sequence_fwd<dynet::VanillaLSTMBuilder>();
+}
+
+BOOST_AUTO_TEST_CASE( compact_vanilla_lstm_sequence_fwd ) {
+  check_lstm_sequence_fwd<dynet::CompactVanillaLSTMBuilder>();
+}
+
+BOOST_AUTO_TEST_CASE( vanilla_lstm_sequence_gradient ) {
+  dynet::ParameterCollection mod;
+  dynet::VanillaLSTMBuilder rnn(2, 3, 4, mod);
+  dynet::ComputationGraph cg;
+  rnn.new_graph(cg);
+  rnn.start_new_sequence();
+  Expression x = input(cg, Dim({3, 4}, 2), param_24_vals);
+  rnn.add_input_sequence(x, {4, 2});
+  rnn.add_input(input(cg, Dim({3}, 2), param_6_vals));
+  Expression z = squared_norm(sum_batches(rnn.final_h()[1] + rnn.final_s()[0]));
+  BOOST_CHECK(check_grad(mod, z, 0));
+}
+
+BOOST_AUTO_TEST_CASE( lstm_sequence_node_dropout_bwd ) {
+  dynet::ParameterCollection mod;
+  const unsigned input_dim = 3, hidden_dim = 5, seq_len = 4, batch_size = 2;
+  dynet::VanillaLSTMBuilder vanilla_lstm_builder(1, input_dim, hidden_dim, mod, false);
+  dynet::Parameter p_x = mod.add_parameters({input_dim * seq_len * batch_size});
+  dynet::Parameter p_h0 = mod.add_parameters({hidden_dim});
+  dynet::Parameter p_c0 = mod.add_parameters({hidden_dim * batch_size});
+  dynet::ComputationGraph cg;
+  Expression Wx = parameter(cg, vanilla_lstm_builder.params[0][0]);
+  Expression Wh = parameter(cg, vanilla_lstm_builder.params[0][1]);
+  Expression b = parameter(cg, vanilla_lstm_builder.params[0][2]);
+  Expression x = reshape(parameter(cg, p_x), Dim({input_dim, seq_len}, batch_size));
+  Expression h0 = parameter(cg, p_h0);
+  Expression c0 = reshape(parameter(cg, p_c0), Dim({hidden_dim}, batch_size));
+  Expression mask = input(cg, Dim({seq_len}, batch_size), {1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 0.f, 0.f});
+  Expression mask_x = parameter(cg, param_3_mask) * 0.9;
+  Expression mask_h = reshape(parameter(cg, param_10_mask), Dim({hidden_dim}, batch_size)) * 0.8;
+  Expression y = vanilla_lstm_sequence_dropout(x, h0, c0, Wx, Wh, b, mask_x, mask_h, mask);
+  Expression z = squared_norm(sum_batches(reshape(y, Dim({hidden_dim * seq_len * 2}, batch_size))));
+  BOOST_CHECK(check_grad(mod, z, 0));
+}
+
+// Only the initial hidden state needs a gradient, after the backward pass of
+// another objective
+BOOST_AUTO_TEST_CASE( lstm_sequence_node_h0_bwd ) {
+  dynet::ParameterCollection mod, weights;
+  const unsigned input_dim = 3, hidden_dim = 5, seq_len = 4, batch_size = 2;
+  dynet::VanillaLSTMBuilder vanilla_lstm_builder(1, input_dim, hidden_dim, weights, false);
+  dynet::Parameter p_h0 = mod.add_parameters({hidden_dim});
+  dynet::ComputationGraph cg;
+  Expression Wx = const_parameter(cg, vanilla_lstm_builder.params[0][0]);
+  Expression Wh = const_parameter(cg, vanilla_lstm_builder.params[0][1]);
+  Expression b = const_parameter(cg, vanilla_lstm_builder.params[0][2]);
+  Expression x = input(cg, Dim({input_dim, seq_len}, batch_size), param_24_vals);
+  Expression h0 = parameter(cg, p_h0);
+  Expression c0 = input(cg, Dim({hidden_dim}, batch_size), param_10_vals);
+  Expression y = reshape(vanilla_lstm_sequence(x, h0, c0, Wx, Wh, b), Dim({hidden_dim * seq_len * 2}, batch_size));
+  cg.backward(sum_elems(sum_batches(y)));
+  Expression z = squared_norm(sum_batches(y));
+  BOOST_CHECK(check_grad(mod, z, 0));
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()